@@ -0,0 +1,632 @@
+#include "AffixDictionary.h"
+#include "LevenshteinAutomaton.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const uint32_t kAllSymbols = (1u << Lexicon::kSymbols) - 1;
+	const size_t kMaxDerivedAdd = 4;
+
+	string lowercase(string s) {
+		for (char& ch : s)
+			ch = (char)tolower((unsigned char)ch);
+		return s;
+	}
+
+	// Whether s is made of Lexicon symbols only (after lowercasing).
+	bool symbolic(const string& s) {
+		for (char ch : s) {
+			if (Lexicon::symbolOf(ch) < 0)
+				return false;
+		}
+		return true;
+	}
+
+	// A Hunspell condition as a bit mask of the symbols allowed at each position.
+	vector<uint32_t> parseCondition(const string& condition) {
+		vector<uint32_t> allowed;
+		if (condition == ".")
+			return allowed;
+		for (size_t i = 0; i < condition.size(); i++) {
+			if (condition[i] == '.')
+				allowed.push_back(kAllSymbols);
+			else if (condition[i] == '[') {
+				bool negated = i + 1 < condition.size() && condition[i + 1] == '^';
+				uint32_t mask = 0;
+				for (i += negated ? 2 : 1; i < condition.size() && condition[i] != ']'; i++) {
+					int symbol = Lexicon::symbolOf(condition[i]);
+					if (symbol >= 0)
+						mask |= 1u << symbol;
+				}
+				allowed.push_back(negated ? kAllSymbols & ~mask : mask);
+			}
+			else {
+				int symbol = Lexicon::symbolOf(condition[i]);
+				allowed.push_back(symbol < 0 ? 0 : 1u << symbol);
+			}
+		}
+		return allowed;
+	}
+
+	// The flag characters a derived dictionary hands out, most used rule first.
+	string derivedFlags() {
+		string flags;
+		for (char ch = 'A'; ch <= 'Z'; ch++)
+			flags += ch;
+		for (char ch = 'a'; ch <= 'z'; ch++)
+			flags += ch;
+		for (char ch = '0'; ch <= '9'; ch++)
+			flags += ch;
+		for (char ch = '!'; ch <= '~'; ch++) {
+			if (!isalnum((unsigned char)ch) && ch != '/' && ch != '#')
+				flags += ch;
+		}
+		return flags;
+	}
+}
+
+AffixDictionary::AffixDictionary() : stems_(*this, false), allStems_(*this, true) {
+	clear();
+}
+
+void AffixDictionary::clear() {
+	graph_.clear();
+	stemCount_ = 0;
+	rules_.clear();
+	flags_.clear();
+	tagLength_ = 1;
+	suffixes_.assign(1, IndexNode());
+	prefixes_.assign(1, IndexNode());
+	needAffix_ = 0;
+}
+
+bool AffixDictionary::read(const std::string& affFile, const std::string& dicFile) {
+	clear();
+	ifstream aff(affFile), dic(dicFile);
+	if (!aff || !dic)
+		return false;
+	map<char, bool> cross; // from each flag's header line
+	string line;
+	while (getline(aff, line)) {
+		istringstream in(line);
+		vector<string> fields;
+		for (string field; in >> field;)
+			fields.push_back(field);
+		if (fields.empty() || fields[0][0] == '#')
+			continue;
+		if (fields[0] == "FLAG") {
+			clear(); // only single-character flags are supported
+			return false;
+		}
+		if (fields[0] == "NEEDAFFIX" && fields.size() > 1)
+			needAffix_ = fields[1][0];
+		if ((fields[0] != "PFX" && fields[0] != "SFX") || fields.size() < 4 || fields[1].size() != 1)
+			continue;
+		bool prefix = fields[0] == "PFX";
+		char flag = fields[1][0];
+		if ((fields[2] == "Y" || fields[2] == "N") && all_of(fields[3].begin(), fields[3].end(), ::isdigit)) {
+			cross[flag] = fields[2] == "Y"; // the header: PFX flag cross-product count
+			continue;
+		}
+		string strip = fields[2] == "0" ? "" : lowercase(fields[2]);
+		string add = lowercase(fields[3].substr(0, fields[3].find('/'))); // continuation classes are dropped
+		if (add == "0")
+			add.clear();
+		string condition = fields.size() > 4 ? lowercase(fields[4]) : ".";
+		if (!addRule(prefix, flag, cross[flag], strip, add, condition)) {
+			clear();
+			return false;
+		}
+	}
+	vector<Entry> entries;
+	bool first = true;
+	while (getline(dic, line)) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (first && !line.empty() && all_of(line.begin(), line.end(), ::isdigit)) {
+			first = false; // the stem count
+			continue;
+		}
+		first = false;
+		size_t end = line.find_first_of(" \t");
+		line = line.substr(0, end);
+		size_t slash = line.find('/');
+		string stem = lowercase(line.substr(0, slash));
+		string flags = slash == string::npos ? "" : line.substr(slash + 1);
+		if (stem.empty() || stem.size() > kMaxWordLength || !symbolic(stem))
+			continue;
+		entries.push_back({ stem, flags, needAffix_ == 0 || flags.find(needAffix_) == string::npos });
+	}
+	index();
+	return build(entries);
+}
+
+// One rule of flag, which gets the next tag if it has none. Returns false if there are more
+// flags than tags; a rule that can't apply to a word of Lexicon symbols is left out.
+bool AffixDictionary::addRule(bool prefix, char flag, bool cross, const std::string& strip, const std::string& add,
+	const std::string& condition) {
+	size_t i = flags_.find(flag);
+	if (i == string::npos) {
+		i = flags_.size();
+		if (i >= 26 * Lexicon::kSymbols)
+			return false;
+		flags_ += flag;
+	}
+	if (!symbolic(strip) || !symbolic(add) || strip.size() > kMaxAffixLength || add.size() > kMaxAffixLength)
+		return true;
+	Rule rule;
+	rule.prefix = prefix;
+	rule.cross = cross;
+	rule.flag = flag;
+	rule.strip = strip;
+	rule.add = add;
+	rule.condition = condition;
+	rule.allowed = parseCondition(condition);
+	rules_.push_back(move(rule));
+	return true;
+}
+
+void AffixDictionary::index() {
+	suffixes_.assign(1, IndexNode());
+	prefixes_.assign(1, IndexNode());
+	for (uint32_t r = 0; r < rules_.size(); r++) {
+		const Rule& rule = rules_[r];
+		vector<IndexNode>& nodes = rule.prefix ? prefixes_ : suffixes_;
+		size_t at = 0;
+		for (size_t i = 0; i < rule.add.size(); i++) {
+			int symbol = Lexicon::symbolOf(rule.prefix ? rule.add[i] : rule.add[rule.add.size() - 1 - i]);
+			if (nodes[at].next[symbol] == 0) {
+				nodes[at].next[symbol] = (int32_t)nodes.size();
+				nodes.emplace_back();
+			}
+			at = nodes[at].next[symbol];
+		}
+		nodes[at].rules.push_back(r);
+	}
+}
+
+// The graph of entries' stems and tags; entries are sorted and merged on the way.
+bool AffixDictionary::build(std::vector<Entry>& entries) {
+	sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.stem < b.stem; });
+	size_t kept = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (kept > 0 && entries[kept - 1].stem == entries[i].stem) { // a stem listed twice takes both lines' flags
+			entries[kept - 1].flags += entries[i].flags;
+			entries[kept - 1].word = entries[kept - 1].word || entries[i].word;
+		}
+		else if (kept++ != i)
+			entries[kept - 1] = move(entries[i]);
+	}
+	entries.resize(kept);
+	tagLength_ = flags_.size() < Lexicon::kSymbols ? 1 : 2;
+	for (Rule& rule : rules_)
+		tagOf(flags_.find(rule.flag), rule.tag);
+	vector<string> words;
+	for (const Entry& e : entries) {
+		if (e.word)
+			words.push_back(e.stem + '\'' + string(tagLength_, '\''));
+		for (char flag : e.flags) {
+			size_t i = flags_.find(flag);
+			if (i == string::npos)
+				continue;
+			uint8_t tag[2];
+			tagOf(i, tag);
+			words.push_back(e.stem + '\'');
+			for (size_t j = 0; j < tagLength_; j++)
+				words.back() += Lexicon::charOf(tag[j]);
+		}
+	}
+	sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+	if (!graph_.build(words)) {
+		clear();
+		return false;
+	}
+	stemCount_ = entries.size();
+	return true;
+}
+
+bool AffixDictionary::derive(const std::vector<std::string>& words, size_t maxRules) {
+	clear();
+	unordered_set<string_view> known(words.begin(), words.end());
+	// How many words each candidate rule would make of another word: "S" or "P", the strip, a
+	// slash and the add.
+	unordered_map<string, size_t> uses;
+	string probe;
+	for (const string& w : words) {
+		size_t n = w.size();
+		for (size_t k = 1; k <= kMaxDerivedAdd && k + 2 <= n; k++) {
+			string add = w.substr(n - k);
+			probe.assign(w, 0, n - k);
+			if (known.count(probe))
+				uses["S/" + add]++;
+			for (char ch = 'a'; k >= 2 && ch <= 'z'; ch++) {
+				if (ch == add[0])
+					continue; // the same as a shorter rule
+				probe += ch;
+				if (known.count(probe))
+					uses[string("S") + ch + '/' + add]++;
+				probe.pop_back();
+			}
+			if (k + 3 <= n && known.count(string_view(w).substr(k)))
+				uses["P/" + w.substr(0, k)]++;
+		}
+	}
+	vector<pair<size_t, string>> ranked;
+	for (const auto& u : uses) {
+		if (u.second > 1)
+			ranked.push_back({ u.second, u.first });
+	}
+	sort(ranked.begin(), ranked.end(), [](const pair<size_t, string>& a, const pair<size_t, string>& b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second; });
+	string flags = derivedFlags();
+	if (ranked.size() > min(maxRules, flags.size()))
+		ranked.resize(min(maxRules, flags.size()));
+	for (size_t i = 0; i < ranked.size(); i++) {
+		const string& key = ranked[i].second;
+		size_t slash = key.find('/');
+		string strip = key.substr(1, slash - 1);
+		addRule(key[0] == 'P', flags[i], false, strip, key.substr(slash + 1), strip.empty() ? "." : strip);
+	}
+	index();
+
+	// Shortest words first, so every word whose stem is shorter meets the stem's decision: a word
+	// that a rule makes of a stem is that stem's flag, and any other word is a stem.
+	vector<const string*> order;
+	for (const string& w : words)
+		order.push_back(&w);
+	stable_sort(order.begin(), order.end(), [](const string* a, const string* b) { return a->size() < b->size(); });
+	unordered_map<string, size_t> stemAt;
+	vector<Entry> entries;
+	for (const string* w : order) {
+		size_t n = w->size();
+		bool derived = false;
+		for (size_t k = 1; k <= kMaxDerivedAdd && k < n && !derived; k++) {
+			for (const Rule& rule : rules_) {
+				if (rule.add.size() != k)
+					continue;
+				bool fits = rule.prefix ? w->compare(0, k, rule.add) == 0 : w->compare(n - k, k, rule.add) == 0;
+				if (!fits)
+					continue;
+				string stem = rule.prefix ? rule.strip + w->substr(k) : w->substr(0, n - k) + rule.strip;
+				auto found = stemAt.find(stem);
+				if (found != stemAt.end()) {
+					entries[found->second].flags += rule.flag;
+					derived = true;
+					break;
+				}
+			}
+		}
+		if (!derived) {
+			stemAt[*w] = entries.size();
+			entries.push_back({ *w, "", true });
+		}
+	}
+	return build(entries);
+}
+
+bool AffixDictionary::write(const std::string& affFile, const std::string& dicFile) const {
+	ofstream aff(affFile), dic(dicFile);
+	if (!aff || !dic)
+		return false;
+	vector<Entry> stems;
+	entries(stems);
+	bool needed = any_of(stems.begin(), stems.end(), [](const Entry& e) { return !e.word; });
+	char needAffix = needAffix_;
+	for (char ch = '!'; needed && needAffix == 0 && ch <= '~'; ch++) {
+		if (flags_.find(ch) == string::npos && ch != '/' && ch != '#')
+			needAffix = ch;
+	}
+	if (needed)
+		aff << "NEEDAFFIX " << needAffix << "\n\n";
+	for (char flag : flags_) {
+		vector<const Rule*> rules;
+		for (const Rule& rule : rules_) {
+			if (rule.flag == flag)
+				rules.push_back(&rule);
+		}
+		if (rules.empty())
+			continue;
+		const char* kind = rules[0]->prefix ? "PFX" : "SFX";
+		aff << kind << ' ' << flag << ' ' << (rules[0]->cross ? 'Y' : 'N') << ' ' << rules.size() << '\n';
+		for (const Rule* rule : rules) {
+			aff << kind << ' ' << flag << ' ' << (rule->strip.empty() ? "0" : rule->strip) << ' '
+				<< (rule->add.empty() ? "0" : rule->add) << ' ' << rule->condition << '\n';
+		}
+		aff << '\n';
+	}
+	dic << stems.size() << '\n';
+	for (const Entry& e : stems) {
+		string flags = e.flags;
+		if (!e.word)
+			flags += needAffix;
+		dic << e.stem << (flags.empty() ? "" : "/") << flags << '\n';
+	}
+	return (bool)aff && (bool)dic;
+}
+
+// Every stem and its flags, read back out of the graph.
+void AffixDictionary::entries(std::vector<Entry>& out) const {
+	string text;
+	vector<uint32_t> offsets;
+	graph_.collectWords(text, offsets);
+	map<string, Entry> stems;
+	for (size_t i = 0; i + 1 < offsets.size(); i++) {
+		string w = text.substr(offsets[i], offsets[i + 1] - offsets[i]);
+		string stem = w.substr(0, w.size() - 1 - tagLength_);
+		size_t flag = 0;
+		for (size_t j = w.size() - tagLength_; j < w.size(); j++)
+			flag = flag * Lexicon::kSymbols + Lexicon::symbolOf(w[j]);
+		Entry& e = stems.emplace(stem, Entry{ stem, "", false }).first->second;
+		if (w.compare(stem.size(), string::npos, string(1 + tagLength_, '\'')) == 0)
+			e.word = true;
+		else
+			e.flags += flags_[flag];
+	}
+	out.clear();
+	for (auto& s : stems)
+		out.push_back(move(s.second));
+}
+
+void AffixDictionary::expand(std::vector<std::string>& words) const {
+	words.clear();
+	vector<Entry> stems;
+	entries(stems);
+	string form, both;
+	for (const Entry& e : stems) {
+		if (e.word)
+			words.push_back(e.stem);
+		vector<uint8_t> symbols;
+		for (char ch : e.stem)
+			symbols.push_back((uint8_t)Lexicon::symbolOf(ch));
+		for (const Rule& rule : rules_) {
+			if (e.flags.find(rule.flag) == string::npos || !matches(rule, symbols.data(), symbols.size()) ||
+				!apply(rule, e.stem, form))
+				continue;
+			words.push_back(form);
+			if (rule.prefix || !rule.cross)
+				continue;
+			for (const Rule& prefix : rules_) {
+				if (prefix.prefix && prefix.cross && e.flags.find(prefix.flag) != string::npos &&
+					matches(prefix, symbols.data(), symbols.size()) && apply(prefix, form, both))
+					words.push_back(both);
+			}
+		}
+	}
+	sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+}
+
+// rule's form of stem, if stem has the strip string to take off.
+bool AffixDictionary::apply(const Rule& rule, const std::string& stem, std::string& form) {
+	size_t n = stem.size(), k = rule.strip.size();
+	if (k >= n)
+		return false; // something of the stem must stay
+	if (rule.prefix) {
+		if (stem.compare(0, k, rule.strip) != 0)
+			return false;
+		form = rule.add + stem.substr(k);
+	}
+	else {
+		if (stem.compare(n - k, k, rule.strip) != 0)
+			return false;
+		form = stem.substr(0, n - k) + rule.add;
+	}
+	return true;
+}
+
+bool AffixDictionary::matches(const Rule& rule, const uint8_t* stem, size_t length) {
+	size_t k = rule.allowed.size();
+	if (k > length)
+		return false;
+	const uint8_t* at = rule.prefix ? stem : stem + length - k;
+	for (size_t i = 0; i < k; i++) {
+		if ((rule.allowed[i] >> at[i] & 1) == 0)
+			return false;
+	}
+	return true;
+}
+
+// Flag i's tag: one symbol while there are fewer flags than symbols, else two.
+void AffixDictionary::tagOf(size_t i, uint8_t* tag) const {
+	if (tagLength_ == 1)
+		tag[0] = (uint8_t)i;
+	else {
+		tag[0] = (uint8_t)(i / Lexicon::kSymbols);
+		tag[1] = (uint8_t)(i % Lexicon::kSymbols);
+	}
+}
+
+// Whether the tag follows node, i.e. the stem that node ends takes the tag's flag.
+bool AffixDictionary::tagged(Lexicon::Node node, const uint8_t* tag) const {
+	if (!graph_.child(node, 26, node))
+		return false;
+	for (size_t j = 0; j < tagLength_; j++) {
+		if (!graph_.child(node, tag[j], node))
+			return false;
+	}
+	return graph_.isWord(node);
+}
+
+bool AffixDictionary::hasTag(const uint8_t* stem, size_t length, const uint8_t* tag) const {
+	Lexicon::Node node = graph_.root();
+	for (size_t i = 0; i < length; i++) {
+		if (!graph_.child(node, stem[i], node))
+			return false;
+	}
+	return tagged(node, tag);
+}
+
+bool AffixDictionary::contains(const char* word, size_t length) const {
+	if (length == 0 || length > kMaxWordLength || empty())
+		return false;
+	uint8_t w[kMaxWordLength];
+	for (size_t i = 0; i < length; i++) {
+		int symbol = Lexicon::foldedSymbolOf(word[i]);
+		if (symbol < 0)
+			return false;
+		w[i] = (uint8_t)symbol;
+	}
+	// path[i] is the node after the word's first i symbols, as far as the graph has them: a
+	// suffix's stem shares that much of the walk with the word.
+	Lexicon::Node path[kMaxWordLength + 1];
+	path[0] = graph_.root();
+	size_t depth = 0;
+	while (depth < length && graph_.child(path[depth], w[depth], path[depth + 1]))
+		depth++;
+	if (depth == length && tagged(path[length], kWordTag))
+		return true;
+	uint8_t stem[kMaxWordLength + kMaxAffixLength];
+	size_t at = 0;
+	for (size_t d = 0;; d++) { // the rules at suffixes_[at] add the word's last d symbols
+		for (uint32_t r : suffixes_[at].rules) {
+			const Rule& rule = rules_[r];
+			size_t base = length - d;
+			if (base == 0)
+				continue;
+			if (base <= depth) {
+				Lexicon::Node node = path[base];
+				bool walked = true;
+				for (size_t i = 0; i < rule.strip.size() && walked; i++)
+					walked = graph_.child(node, Lexicon::symbolOf(rule.strip[i]), node);
+				if (walked && tagged(node, rule.tag)) {
+					copy(w, w + base, stem);
+					for (size_t i = 0; i < rule.strip.size(); i++)
+						stem[base + i] = (uint8_t)Lexicon::symbolOf(rule.strip[i]);
+					if (matches(rule, stem, base + rule.strip.size()))
+						return true;
+				}
+			}
+			if (rule.cross) {
+				copy(w, w + base, stem);
+				for (size_t i = 0; i < rule.strip.size(); i++)
+					stem[base + i] = (uint8_t)Lexicon::symbolOf(rule.strip[i]);
+				if (matches(rule, stem, base + rule.strip.size()) &&
+					containsWithPrefix(stem, base + rule.strip.size(), &rule))
+					return true;
+			}
+		}
+		if (d == length || suffixes_[at].next[w[length - 1 - d]] == 0)
+			break;
+		at = suffixes_[at].next[w[length - 1 - d]];
+	}
+	return containsWithPrefix(w, length, nullptr);
+}
+
+// Whether word is a stem with one of its prefixes, and also (when given) with suffix, which has
+// already been taken off word.
+bool AffixDictionary::containsWithPrefix(const uint8_t* word, size_t length, const Rule* suffix) const {
+	uint8_t stem[kMaxWordLength + 2 * kMaxAffixLength];
+	size_t at = 0;
+	for (size_t d = 0;; d++) {
+		for (uint32_t r : prefixes_[at].rules) {
+			const Rule& rule = rules_[r];
+			if (d == length || (suffix && !rule.cross))
+				continue;
+			size_t k = rule.strip.size();
+			for (size_t i = 0; i < k; i++)
+				stem[i] = (uint8_t)Lexicon::symbolOf(rule.strip[i]);
+			copy(word + d, word + length, stem + k);
+			size_t n = k + length - d;
+			if (matches(rule, stem, n) && hasTag(stem, n, rule.tag) && (!suffix || hasTag(stem, n, suffix->tag)))
+				return true;
+		}
+		if (d == length || prefixes_[at].next[word[d]] == 0)
+			break;
+		at = prefixes_[at].next[word[d]];
+	}
+	return false;
+}
+
+void AffixDictionary::suggest(const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies) const {
+	out.clear();
+	string w = lowercase(word);
+	vector<Suggestion> candidates;
+	suggestByAutomaton(stems_, w, maxDistance, maxResults, candidates, frequencies);
+	size_t n = w.size();
+	vector<uint8_t> symbols;
+	for (char ch : w) {
+		int symbol = Lexicon::symbolOf(ch);
+		if (symbol >= 0)
+			symbols.push_back((uint8_t)symbol);
+	}
+	if (n > 0 && n <= kMaxWordLength && symbols.size() == n && !empty()) {
+		size_t at = 0;
+		for (size_t d = 0; d + 1 < n && suffixes_[at].next[symbols[n - 1 - d]] != 0; d++) { // suffixes the word ends with
+			at = suffixes_[at].next[symbols[n - 1 - d]];
+			for (uint32_t r : suffixes_[at].rules)
+				suggestForms(rules_[r], w.substr(0, n - d - 1) + rules_[r].strip, w, maxDistance, maxResults, candidates,
+					frequencies);
+		}
+		at = 0;
+		for (size_t d = 0; d + 1 < n && prefixes_[at].next[symbols[d]] != 0; d++) { // and prefixes it starts with
+			at = prefixes_[at].next[symbols[d]];
+			for (uint32_t r : prefixes_[at].rules)
+				suggestForms(rules_[r], rules_[r].strip + w.substr(d + 1), w, maxDistance, maxResults, candidates,
+					frequencies);
+		}
+	}
+	SuggestionList list(maxDistance, maxResults, frequencies);
+	unordered_set<string> offered;
+	for (const Suggestion& s : candidates) {
+		if (offered.insert(s.word).second)
+			list.offer(s.word.data(), s.word.size(), s.distance);
+	}
+	list.take(out);
+}
+
+// rule's forms of the stems near guess, as far from word as they turn out to be.
+void AffixDictionary::suggestForms(const Rule& rule, const std::string& guess, const std::string& word,
+	int maxDistance, size_t maxResults, std::vector<Suggestion>& out, const WordFrequencies* frequencies) const {
+	vector<Suggestion> near;
+	suggestByAutomaton(allStems_, guess, maxDistance, maxResults, near, frequencies);
+	string form;
+	vector<uint8_t> symbols;
+	for (const Suggestion& s : near) {
+		symbols.clear();
+		for (char ch : s.word)
+			symbols.push_back((uint8_t)Lexicon::symbolOf(ch));
+		if (!matches(rule, symbols.data(), symbols.size()) || !hasTag(symbols.data(), symbols.size(), rule.tag) ||
+			!apply(rule, s.word, form))
+			continue;
+		int distance = editDistance(form, word);
+		if (distance <= maxDistance)
+			out.push_back({ form, distance });
+	}
+}
+
+size_t AffixDictionary::bytes() const {
+	size_t bytes = graph_.bytes() + rules_.capacity() * sizeof(Rule) +
+		(suffixes_.capacity() + prefixes_.capacity()) * sizeof(IndexNode);
+	for (const Rule& rule : rules_)
+		bytes += rule.allowed.capacity() * sizeof(uint32_t);
+	return bytes;
+}
+
+bool AffixDictionary::StemLexicon::isWord(Node node) const {
+	if (!anyTag_)
+		return owner_.tagged(node, kWordTag);
+	if (!owner_.graph_.child(node, 26, node))
+		return false;
+	Edge first[kSymbols], second[kSymbols];
+	for (int i = 0, n = owner_.graph_.children(node, first); i < n; i++) {
+		if (owner_.tagLength_ == 1 && owner_.graph_.isWord(first[i].target))
+			return true;
+		for (int j = 0, m = owner_.tagLength_ == 1 ? 0 : owner_.graph_.children(first[i].target, second); j < m; j++) {
+			if (owner_.graph_.isWord(second[j].target))
+				return true;
+		}
+	}
+	return false;
+}
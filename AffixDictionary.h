@@ -0,0 +1,133 @@
+#ifndef AFFIXDICTIONARY_H_
+#define AFFIXDICTIONARY_H_
+
+// A dictionary kept as stems and affix rules, in the Hunspell format: an .aff file lists the
+// rules ("SFX D y ied y" makes "tried" of "try"), a .dic file the stems, each with the flags of
+// the rules it takes ("try/D"). A word is checked by taking off each affix it could have been
+// given and looking the stem up with that rule's flag, so "tried" is found through "try" and
+// never stored.
+//
+// Stems and flags live in one Dawg, each stem once per flag it takes with a three-symbol tag
+// after it: an apostrophe, then two symbols naming the flag, or two more apostrophes for a stem
+// that is a word by itself. So "is try flagged D" is one walk of "try" plus the tag, and stems
+// with the same flags share the tags' subtree the way words with the same endings do in a Dawg of
+// the word list. Finding the stem of a suffixed word reuses the walk of the word itself.
+//
+// Supported: PFX and SFX rules with single-character flags, strip and add strings, conditions
+// of letters, '.', [...] and [^...], one prefix combined with one suffix where both allow it, and
+// NEEDAFFIX. Not supported: other FLAG types, affixes on affixes,
+// compounding, and characters outside a-z and apostrophe; words holding those are skipped.
+
+#include "Dawg.h"
+#include "Suggest.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AffixDictionary {
+public:
+	static const size_t kMaxWordLength = 256; // as StudentSpellCheck::kMaxWordLength
+
+	AffixDictionary();
+
+	// Read an .aff and .dic pair. Returns false, leaving the dictionary empty, if either can't be
+	// read or uses something unsupported (another FLAG type, too many flags).
+	bool read(const std::string& affFile, const std::string& dicFile);
+	bool write(const std::string& affFile, const std::string& dicFile) const;
+	// Stems and rules for words (sorted, as StudentSpellCheck::readWords() gives them) that
+	// expand to exactly those words. Each rule adds up to four letters, possibly in place of one;
+	// the maxRules that could make the most words of others are kept. Up to 26 rules need a
+	// one-symbol tag each; more make the tags longer and the graph bigger than they save.
+	bool derive(const std::vector<std::string>& sortedWords, size_t maxRules = 26);
+	void clear();
+	bool empty() const { return stemCount_ == 0; }
+
+	// Whether word, its letters in either case, is a stem or a stem with its affixes.
+	bool contains(const char* word, size_t length) const;
+	// Every word the dictionary holds, sorted.
+	void expand(std::vector<std::string>& words) const;
+	// The best maxResults words within maxDistance edits of word: stems near it, and forms of the
+	// stems near what is left when an affix the word ends (or starts) with is taken off. A
+	// misspelling inside the affix itself is only found among the stems.
+	void suggest(const std::string& word, int maxDistance, size_t maxResults, std::vector<Suggestion>& out,
+		const WordFrequencies* frequencies = nullptr) const;
+
+	// The stems that are words by themselves, for suggestion searches.
+	const Lexicon& stems() const { return stems_; }
+	size_t stemCount() const { return stemCount_; }
+	size_t ruleCount() const { return rules_.size(); }
+	size_t nodeCount() const { return graph_.nodeCount(); }
+	size_t bytes() const;
+
+private:
+	struct Rule {
+		bool prefix;
+		bool cross;              // may go with an affix of the other kind
+		char flag;               // as written in the files
+		uint8_t tag[2];          // the flag's symbols in the graph
+		std::string strip, add;
+		std::string condition;   // as written, "." for any stem
+		std::vector<uint32_t> allowed; // per condition position, a bit per symbol
+	};
+
+	// Rules by their add string, read from the end of a word for suffixes and from the start for
+	// prefixes: a word's candidate rules are found in one walk of at most its longest affix.
+	struct IndexNode {
+		int32_t next[Lexicon::kSymbols];
+		std::vector<uint32_t> rules;
+	};
+
+	// The stems that are words by themselves (or, with anyTag, all of them) as a Lexicon over the
+	// graph: a node is a word if the right tag follows it.
+	class StemLexicon : public Lexicon {
+	public:
+		StemLexicon(const AffixDictionary& owner, bool anyTag) : owner_(owner), anyTag_(anyTag) { }
+		Node root() const { return owner_.graph_.root(); }
+		bool child(Node node, int symbol, Node& next) const { return owner_.graph_.child(node, symbol, next); }
+		int children(Node node, Edge* edges) const { return owner_.graph_.children(node, edges); }
+		bool isWord(Node node) const;
+		size_t nodeCount() const { return owner_.graph_.nodeCount(); }
+		size_t bytes() const { return owner_.bytes(); }
+
+	private:
+		const AffixDictionary& owner_;
+		bool anyTag_;
+	};
+
+	AffixDictionary(const AffixDictionary&) = delete;
+	AffixDictionary& operator=(const AffixDictionary&) = delete;
+
+	// A stem and the flags it takes, as written.
+	struct Entry {
+		std::string stem;
+		std::string flags;
+		bool word; // a word by itself
+	};
+	bool build(std::vector<Entry>& entries);
+	bool addRule(bool prefix, char flag, bool cross, const std::string& strip, const std::string& add,
+		const std::string& condition);
+	void index();
+	void tagOf(size_t flag, uint8_t* tag) const;
+	bool tagged(Lexicon::Node node, const uint8_t* tag) const;
+	bool hasTag(const uint8_t* stem, size_t length, const uint8_t* tag) const;
+	static bool matches(const Rule& rule, const uint8_t* stem, size_t length);
+	static bool apply(const Rule& rule, const std::string& stem, std::string& form);
+	bool containsWithPrefix(const uint8_t* word, size_t length, const Rule* suffix) const;
+	void entries(std::vector<Entry>& out) const;
+	void suggestForms(const Rule& rule, const std::string& guess, const std::string& word, int maxDistance,
+		size_t maxResults, std::vector<Suggestion>& out, const WordFrequencies* frequencies) const;
+
+	static constexpr uint8_t kWordTag[2] = { 26, 26 }; // as long as the tags are
+	static const size_t kMaxAffixLength = 32;
+
+	Dawg graph_;
+	StemLexicon stems_, allStems_;
+	size_t stemCount_;
+	std::vector<Rule> rules_;
+	std::string flags_; // in the order the rules gave them
+	size_t tagLength_;
+	std::vector<IndexNode> suffixes_, prefixes_; // node 0 is the root
+	char needAffix_; // the flag of stems that aren't words by themselves, or 0
+};
+
+#endif // AFFIXDICTIONARY_H_
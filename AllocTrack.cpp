@@ -0,0 +1,171 @@
+#include "AllocTrack.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+	struct Counters {
+		atomic<uint64_t> allocations;
+		atomic<uint64_t> frees;
+		atomic<uint64_t> bytes;
+		atomic<int64_t> liveBytes;
+		atomic<int64_t> peakBytes;
+	};
+
+	Counters g_counters[AllocTrack::NUM_SUBSYSTEMS]; // zero-initialized before any allocation
+
+#ifdef WURD_ALLOC_TRACK
+	// Every block carries its size and subsystem so that frees are charged to the allocator.
+	// 16 bytes keeps the user pointer aligned like malloc's.
+	struct alignas(16) Header {
+		size_t size;
+		uint32_t subsystem;
+		uint32_t magic;
+	};
+	const uint32_t kMagic = 0x57524441; // "WRDA"
+
+	void* trackedAlloc(size_t size) {
+		Header* h = (Header*)malloc(sizeof(Header) + size);
+		if (h == nullptr)
+			return nullptr;
+		AllocTrack::Subsystem s = AllocTrack::current();
+		h->size = size;
+		h->subsystem = s;
+		h->magic = kMagic;
+		Counters& c = g_counters[s];
+		c.allocations.fetch_add(1, memory_order_relaxed);
+		c.bytes.fetch_add(size, memory_order_relaxed);
+		int64_t live = c.liveBytes.fetch_add((int64_t)size, memory_order_relaxed) + (int64_t)size;
+		int64_t peak = c.peakBytes.load(memory_order_relaxed);
+		while (live > peak && !c.peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed))
+			;
+		return h + 1;
+	}
+
+	void trackedFree(void* p) {
+		if (p == nullptr)
+			return;
+		Header* h = (Header*)p - 1;
+		Counters& c = g_counters[h->subsystem < AllocTrack::NUM_SUBSYSTEMS ? h->subsystem : 0];
+		c.frees.fetch_add(1, memory_order_relaxed);
+		c.liveBytes.fetch_sub((int64_t)h->size, memory_order_relaxed);
+		h->magic = 0;
+		free(h);
+	}
+
+	struct ReportAtExit {
+		~ReportAtExit() {
+			AllocTrack::report(stderr);
+		}
+	} g_reportAtExit;
+#endif
+}
+
+thread_local AllocTrack::Subsystem AllocTrack::current_ = AllocTrack::OTHER;
+
+bool AllocTrack::enabled() {
+#ifdef WURD_ALLOC_TRACK
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char* AllocTrack::subsystemName(Subsystem s) {
+	static const char* const kNames[NUM_SUBSYSTEMS] = { "other", "editor", "undo", "spell check", "gui" };
+	if (s < 0 || s >= NUM_SUBSYSTEMS)
+		return "unknown";
+	return kNames[s];
+}
+
+AllocTrack::Counts AllocTrack::counts(Subsystem s) {
+	Counts out;
+	const Counters& c = g_counters[s];
+	out.allocations = c.allocations.load(memory_order_relaxed);
+	out.frees = c.frees.load(memory_order_relaxed);
+	out.bytes = c.bytes.load(memory_order_relaxed);
+	out.liveBytes = c.liveBytes.load(memory_order_relaxed);
+	out.peakBytes = c.peakBytes.load(memory_order_relaxed);
+	return out;
+}
+
+AllocTrack::Counts AllocTrack::total() {
+	Counts out;
+	for (int s = 0; s < NUM_SUBSYSTEMS; s++) {
+		Counts c = counts((Subsystem)s);
+		out.allocations += c.allocations;
+		out.frees += c.frees;
+		out.bytes += c.bytes;
+		out.liveBytes += c.liveBytes;
+		out.peakBytes += c.peakBytes;
+	}
+	return out;
+}
+
+void AllocTrack::resetPeaks() {
+	for (int s = 0; s < NUM_SUBSYSTEMS; s++)
+		g_counters[s].peakBytes.store(g_counters[s].liveBytes.load(memory_order_relaxed), memory_order_relaxed);
+}
+
+void AllocTrack::report(FILE* out) {
+	if (!enabled())
+		return;
+	fprintf(out, "%-12s %12s %12s %14s %14s %14s\n", "subsystem", "allocations", "frees", "bytes", "live bytes", "peak bytes");
+	for (int s = 0; s < NUM_SUBSYSTEMS; s++) {
+		Counts c = counts((Subsystem)s);
+		fprintf(out, "%-12s %12llu %12llu %14llu %14lld %14lld\n", subsystemName((Subsystem)s),
+			(unsigned long long)c.allocations, (unsigned long long)c.frees, (unsigned long long)c.bytes,
+			(long long)c.liveBytes, (long long)c.peakBytes);
+	}
+}
+
+#ifdef WURD_ALLOC_TRACK
+void* operator new(size_t size) {
+	void* p = trackedAlloc(size);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	void* p = trackedAlloc(size);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	return trackedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return trackedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	trackedFree(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+	trackedFree(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+	trackedFree(p);
+}
+#endif
@@ -0,0 +1,62 @@
+#ifndef ALLOCTRACK_H_
+#define ALLOCTRACK_H_
+
+// Allocation accounting. When the program is built with WURD_ALLOC_TRACK defined, the global
+// operator new/delete are replaced and every allocation is attributed to the subsystem whose
+// ALLOC_SCOPE is innermost on the allocating thread: number of allocations, bytes, live bytes and
+// peak live bytes. A report is printed to stderr at exit, and the benchmarks add per-operation
+// figures to their results. Without WURD_ALLOC_TRACK the scopes compile to nothing.
+
+#include <cstdint>
+#include <cstdio>
+
+class AllocTrack {
+public:
+	enum Subsystem {
+		OTHER = 0,
+		EDITOR,
+		UNDO,
+		SPELL_CHECK,
+		GUI,
+		NUM_SUBSYSTEMS
+	};
+
+	struct Counts {
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t bytes = 0;     // total bytes requested
+		int64_t liveBytes = 0;  // allocated and not yet freed
+		int64_t peakBytes = 0;  // high-water mark of liveBytes
+	};
+
+	static bool enabled(); // true if built with WURD_ALLOC_TRACK
+	static const char* subsystemName(Subsystem s);
+	static Counts counts(Subsystem s);
+	static Counts total(); // all subsystems; peakBytes is the sum of the per-subsystem peaks
+	static void resetPeaks(); // start a new high-water mark from the current live bytes
+	static void report(FILE* out);
+
+	static Subsystem current() { return current_; }
+
+	// RAII helper used by ALLOC_SCOPE.
+	class Scope {
+	public:
+		Scope(Subsystem s) : saved_(current_) { current_ = s; }
+		~Scope() { current_ = saved_; }
+	private:
+		Subsystem saved_;
+	};
+
+private:
+	static thread_local Subsystem current_;
+};
+
+#ifdef WURD_ALLOC_TRACK
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#define ALLOC_SCOPE(subsystem) AllocTrack::Scope ALLOC_CONCAT(allocScope_, __LINE__)(AllocTrack::subsystem)
+#else
+#define ALLOC_SCOPE(subsystem)
+#endif
+
+#endif // ALLOCTRACK_H_
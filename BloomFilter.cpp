@@ -0,0 +1,91 @@
+#include "BloomFilter.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const int kProbes = 7; // bits per word, about the best for ten bits per word
+
+	size_t blockOf(uint64_t hash, size_t blockCount) {
+		return (size_t)(((hash >> 32) * (uint64_t)blockCount) >> 32);
+	}
+
+	// The i-th bit within the block: nine bits at a time from the top of a second hash.
+	unsigned bitOf(uint64_t probes, int i) {
+		return (unsigned)(probes >> (64 - 9 * (i + 1))) & 511;
+	}
+}
+
+BloomFilter::BloomFilter() {
+	clear();
+}
+
+void BloomFilter::clear() {
+	store_ = vector<uint64_t>();
+	blocks_ = store_.data();
+	blockCount_ = 0;
+}
+
+void BloomFilter::build(const Lexicon& lexicon) {
+	build(vector<const Lexicon*>(1, &lexicon));
+}
+
+void BloomFilter::build(const std::vector<const Lexicon*>& lexicons) {
+	clear();
+	string text;
+	vector<uint32_t> offsets(1, 0);
+	for (const Lexicon* lexicon : lexicons) {
+		string more;
+		vector<uint32_t> moreOffsets;
+		lexicon->collectWords(more, moreOffsets);
+		for (size_t i = 1; i < moreOffsets.size(); i++)
+			offsets.push_back((uint32_t)text.size() + moreOffsets[i]);
+		text += more;
+	}
+	size_t words = offsets.size() - 1; // a word in several lexicons is counted, and set, once for each
+	if (words == 0)
+		return;
+	size_t blockCount = (words * kBitsPerWord + 511) / 512;
+	vector<uint64_t> store(blockCount * kWordsPerBlock + kWordsPerBlock - 1, 0);
+	uint64_t* blocks = store.data();
+	while ((uintptr_t)blocks % 64 != 0)
+		blocks++;
+	for (size_t w = 0; w < words; w++) {
+		uint64_t h;
+		if (!Lexicon::foldedHash(&text[offsets[w]], offsets[w + 1] - offsets[w], h))
+			continue;
+		uint64_t* block = blocks + blockOf(h, blockCount) * kWordsPerBlock;
+		uint64_t probes = h * 0x9e3779b97f4a7c15ULL;
+		for (int i = 0; i < kProbes; i++) {
+			unsigned bit = bitOf(probes, i);
+			block[bit >> 6] |= 1ULL << (bit & 63);
+		}
+	}
+	store_.swap(store); // moves the buffer, so blocks stays valid
+	blocks_ = blocks;
+	blockCount_ = blockCount;
+}
+
+bool BloomFilter::mayContain(const char* word, size_t length) const {
+	if (blockCount_ == 0)
+		return true;
+	uint64_t h;
+	if (!Lexicon::foldedHash(word, length, h))
+		return false;
+	const uint64_t* block = blocks_ + blockOf(h, blockCount_) * kWordsPerBlock;
+	uint64_t probes = h * 0x9e3779b97f4a7c15ULL;
+	for (int i = 0; i < kProbes; i++) {
+		unsigned bit = bitOf(probes, i);
+		if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0)
+			return false;
+	}
+	return true;
+}
+
+void BloomFilter::attach(const uint64_t* blocks, size_t blockCount) {
+	store_ = vector<uint64_t>();
+	blocks_ = blocks;
+	blockCount_ = blockCount;
+}
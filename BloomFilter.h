@@ -0,0 +1,49 @@
+#ifndef BLOOMFILTER_H_
+#define BLOOMFILTER_H_
+
+// A blocked Bloom filter over the dictionary's words, asked before the dictionary structure so
+// that most misspellings are turned away without a walk. All of a word's bits fall in one
+// 64-byte block (a cache line), so a query costs one hash and at most one cache miss; at ten
+// bits per word about 1% of non-words get through to the exact check, and no dictionary word
+// is ever turned away.
+//
+// Storage is one flat array of blocks, eight 64-bit words each, so a compiled dictionary can
+// carry the filter and attach() can use it in place.
+
+#include "Lexicon.h"
+#include <cstdint>
+#include <vector>
+
+class BloomFilter {
+public:
+	static const int kBitsPerWord = 10;
+	static const size_t kWordsPerBlock = 8; // 64-bit words: 512 bits, one cache line
+
+	BloomFilter();
+
+	void build(const Lexicon& lexicon);
+	// One filter for the union of several lexicons' words.
+	void build(const std::vector<const Lexicon*>& lexicons);
+	void clear();
+	bool empty() const { return blockCount_ == 0; }
+
+	// False only if word (letters in either case) is certainly not in the lexicon.
+	bool mayContain(const char* word, size_t length) const;
+
+	// blockCount() * kWordsPerBlock 64-bit words.
+	const uint64_t* blockArray() const { return blocks_; }
+	size_t blockCount() const { return blockCount_; }
+	// Use blocks saved from another filter without copying them; they must outlive this object.
+	void attach(const uint64_t* blocks, size_t blockCount);
+	size_t bytes() const { return blockCount_ * kWordsPerBlock * sizeof(uint64_t); }
+
+private:
+	BloomFilter(const BloomFilter&) = delete;
+	BloomFilter& operator=(const BloomFilter&) = delete;
+
+	const uint64_t* blocks_;
+	size_t blockCount_;
+	std::vector<uint64_t> store_; // the blocks, unless attached, with room to start on a cache line
+};
+
+#endif // BLOOMFILTER_H_
@@ -0,0 +1,213 @@
+#include "Completion.h"
+#include "WordFrequencies.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	// Follow prefix down from the root, spelling it in lowercase into folded. Returns false if no
+	// word starts with it.
+	bool walkPrefix(const Lexicon& lexicon, const char* prefix, size_t length, Lexicon::Node& node, string& folded) {
+		node = lexicon.root();
+		for (size_t i = 0; i < length; i++) {
+			int symbol = Lexicon::foldedSymbolOf(prefix[i]);
+			if (symbol < 0 || !lexicon.child(node, symbol, node))
+				return false;
+			folded.push_back(Lexicon::charOf(symbol));
+		}
+		return true;
+	}
+
+	// A node reached below the prefix, linked to its parent so that a word is spelled out only
+	// when it is handed out.
+	struct Step {
+		uint32_t parent;
+		Lexicon::Node node;
+		int symbol;
+	};
+}
+
+void completeByWalk(const Lexicon& lexicon, const char* prefix, size_t length, size_t maxResults,
+	std::vector<std::string>& out) {
+	Lexicon::Node node;
+	string folded;
+	if (maxResults == 0 || !walkPrefix(lexicon, prefix, length, node, folded))
+		return;
+	vector<Step> steps(1, { 0, node, -1 }); // also the queue: steps[i] is expanded in turn
+	size_t found = 0;
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	for (uint32_t i = 0; i < steps.size() && found < maxResults; i++) {
+		if (lexicon.isWord(steps[i].node)) {
+			string word;
+			for (uint32_t s = i; s != 0; s = steps[s].parent)
+				word.push_back(Lexicon::charOf(steps[s].symbol));
+			reverse(word.begin(), word.end());
+			out.push_back(folded + word);
+			found++;
+		}
+		int count = lexicon.children(steps[i].node, edges);
+		for (int e = 0; e < count; e++)
+			steps.push_back({ i, edges[e].target, edges[e].symbol });
+	}
+}
+
+void CompletionIndex::build(const Lexicon& lexicon, const WordFrequencies& frequencies) {
+	clear();
+	counts_.reserve(lexicon.nodeCount());
+	uint32_t words = count(lexicon, lexicon.root());
+	leaves_ = 1;
+	while (leaves_ < words)
+		leaves_ *= 2;
+	tree_.assign(2 * (size_t)leaves_, 0);
+	string word;
+	uint32_t index = 0;
+	rank(lexicon, frequencies, lexicon.root(), word, index);
+	for (uint32_t i = leaves_ - 1; i > 0; i--)
+		tree_[i] = max(tree_[2 * i], tree_[2 * i + 1]);
+	counts_.shrink_to_fit();
+}
+
+void CompletionIndex::clear() {
+	vector<uint32_t>().swap(counts_);
+	vector<uint8_t>().swap(tree_);
+	leaves_ = 0;
+}
+
+// The words at or below node, each node counted once however many paths reach it.
+uint32_t CompletionIndex::count(const Lexicon& lexicon, Lexicon::Node node) {
+	if (node >= counts_.size())
+		counts_.resize(node + 1, UINT32_MAX);
+	if (counts_[node] != UINT32_MAX)
+		return counts_[node];
+	uint32_t total = lexicon.isWord(node) ? 1 : 0;
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	int n = lexicon.children(node, edges);
+	for (int e = 0; e < n; e++)
+		total += count(lexicon, edges[e].target);
+	counts_[node] = total;
+	return total;
+}
+
+// Every word below node in alphabetical order, numbered from index, with its rank as a leaf.
+void CompletionIndex::rank(const Lexicon& lexicon, const WordFrequencies& frequencies, Lexicon::Node node,
+	std::string& word, uint32_t& index) {
+	if (lexicon.isWord(node))
+		tree_[leaves_ + index++] = (uint8_t)frequencies.rank(word.data(), word.size());
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	int n = lexicon.children(node, edges);
+	for (int e = 0; e < n; e++) {
+		word.push_back(Lexicon::charOf(edges[e].symbol));
+		rank(lexicon, frequencies, edges[e].target, word, index);
+		word.pop_back();
+	}
+}
+
+// The first of the most common words numbered first..last - 1, and its rank.
+uint32_t CompletionIndex::best(uint32_t first, uint32_t last, int& rank) const {
+	// The subtrees that cover the run, left to right: the first holding the highest rank wins.
+	uint32_t top = 0;
+	rank = -1;
+	uint32_t lo = first + leaves_, hi = last + leaves_;
+	uint32_t right[64];
+	int rights = 0;
+	for (; lo < hi; lo /= 2, hi /= 2) {
+		if (lo & 1) {
+			if (tree_[lo] > rank) {
+				rank = tree_[lo];
+				top = lo;
+			}
+			lo++;
+		}
+		if (hi & 1)
+			right[rights++] = --hi; // taken right to left, so looked at after the left-hand ones
+	}
+	while (rights > 0) {
+		uint32_t node = right[--rights];
+		if (tree_[node] > rank) {
+			rank = tree_[node];
+			top = node;
+		}
+	}
+	while (top < leaves_)
+		top = tree_[2 * top] == rank ? 2 * top : 2 * top + 1;
+	return top - leaves_;
+}
+
+// Append to word the letters of word index among those at or below node.
+void CompletionIndex::spell(const Lexicon& lexicon, Lexicon::Node node, uint32_t index, std::string& word) const {
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	for (;;) {
+		if (lexicon.isWord(node)) {
+			if (index == 0)
+				return;
+			index--;
+		}
+		int n = lexicon.children(node, edges);
+		for (int e = 0; e < n; e++) {
+			uint32_t below = counts_[edges[e].target];
+			if (index < below) {
+				word.push_back(Lexicon::charOf(edges[e].symbol));
+				node = edges[e].target;
+				break;
+			}
+			index -= below;
+		}
+	}
+}
+
+void CompletionIndex::complete(const Lexicon& lexicon, const char* prefix, size_t length, size_t maxResults,
+	std::vector<std::string>& out) const {
+	if (maxResults == 0 || leaves_ == 0)
+		return;
+	// Number the prefix's first word by counting the words before it on the way down: the
+	// prefixes of it that are words, and the subtrees of the siblings before each letter.
+	Lexicon::Node node = lexicon.root();
+	string folded;
+	uint32_t first = 0;
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	for (size_t i = 0; i < length; i++) {
+		int symbol = Lexicon::foldedSymbolOf(prefix[i]);
+		if (symbol < 0)
+			return;
+		if (lexicon.isWord(node))
+			first++;
+		int n = lexicon.children(node, edges), e = 0;
+		for (; e < n && edges[e].symbol < symbol; e++)
+			first += counts_[edges[e].target];
+		if (e == n || edges[e].symbol != symbol)
+			return;
+		node = edges[e].target;
+		folded.push_back(Lexicon::charOf(symbol));
+	}
+	if (node >= counts_.size())
+		return; // not the lexicon the index was built from
+
+	// Runs of word numbers, each with its best word; the best of them all is the next completion.
+	struct Run {
+		int rank;
+		uint32_t at; // the best word
+		uint32_t first, last;
+	};
+	auto after = [](const Run& a, const Run& b) { return a.rank != b.rank ? a.rank < b.rank : a.at > b.at; };
+	vector<Run> heap;
+	auto push = [&](uint32_t from, uint32_t to) {
+		if (from == to)
+			return;
+		Run run = { 0, 0, from, to };
+		run.at = best(from, to, run.rank);
+		heap.push_back(run);
+		push_heap(heap.begin(), heap.end(), after);
+	};
+	push(first, first + counts_[node]);
+	for (size_t found = 0; found < maxResults && !heap.empty(); found++) {
+		pop_heap(heap.begin(), heap.end(), after);
+		Run run = heap.back();
+		heap.pop_back();
+		out.push_back(folded);
+		spell(lexicon, node, run.at - first, out.back());
+		push(run.first, run.at);
+		push(run.at + 1, run.last);
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef COMPLETION_H_
+#define COMPLETION_H_
+
+// Prefix completion over a Lexicon: the dictionary words that begin with what has been typed so
+// far, found without listing every word below the prefix.
+//
+// Unranked, completeByWalk() goes down the prefix and then breadth first, which meets the
+// shortest words first and words of one length in alphabetical order, and stops at the
+// maxResults-th word.
+//
+// Ranked by WordFrequencies, CompletionIndex numbers the words in alphabetical order, which a
+// count of the words below each node gives on the way down: the words with a prefix are then
+// one run of numbers, and a max tree of the words' ranks finds the most common word of any run
+// in O(log n). The top k of a run are found by taking its best word and splitting the run around
+// it, k times, so a ranked completion costs O(prefix * 27 + k log n) however many words share the
+// prefix. This works on a Dawg as well as on a trie: the words below a Dawg node are the same
+// whichever prefix reaches it, so one count per node serves every path.
+
+#include "Lexicon.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class WordFrequencies;
+
+// Up to maxResults words of lexicon that begin with prefix[0, length), its letters in either case,
+// appended to out, shortest first and then alphabetically. The prefix itself counts if it is a word.
+void completeByWalk(const Lexicon& lexicon, const char* prefix, size_t length, size_t maxResults,
+	std::vector<std::string>& out);
+
+// Ranked completions over one lexicon: four bytes a node for the counts, two bytes a word for the
+// max tree.
+class CompletionIndex {
+public:
+	CompletionIndex() : leaves_(0) { }
+
+	// Takes about as long as listing the words once.
+	void build(const Lexicon& lexicon, const WordFrequencies& frequencies);
+	void clear();
+	// As completeByWalk(), but most common first and then alphabetically. lexicon must be the one
+	// the index was built from.
+	void complete(const Lexicon& lexicon, const char* prefix, size_t length, size_t maxResults,
+		std::vector<std::string>& out) const;
+	size_t bytes() const { return counts_.capacity() * sizeof(uint32_t) + tree_.capacity(); }
+
+private:
+	uint32_t count(const Lexicon& lexicon, Lexicon::Node node);
+	void rank(const Lexicon& lexicon, const WordFrequencies& frequencies, Lexicon::Node node, std::string& word,
+		uint32_t& index);
+	uint32_t best(uint32_t first, uint32_t last, int& rank) const;
+	void spell(const Lexicon& lexicon, Lexicon::Node node, uint32_t index, std::string& word) const;
+
+	std::vector<uint32_t> counts_; // the words at or below each node
+	std::vector<uint8_t> tree_;    // leaves_ ranks in word order from tree_[leaves_], maxima above them
+	uint32_t leaves_;              // a power of two
+};
+
+#endif // COMPLETION_H_
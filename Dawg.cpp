@@ -0,0 +1,252 @@
+#include "Dawg.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	// A node while the graph is being built. Edges are appended in input order.
+	struct BuildNode {
+		bool final = false;
+		vector<pair<int, uint32_t>> edges; // symbol, child
+	};
+
+	struct Unchecked {
+		uint32_t parent;
+		uint32_t child;
+	};
+
+	class Builder {
+	public:
+		Builder() { root_ = newNode(); }
+
+		bool add(const string& word, const string& previous) {
+			size_t common = 0;
+			while (common < word.size() && common < previous.size() && word[common] == previous[common])
+				common++;
+			minimize(common);
+			uint32_t node = unchecked_.empty() ? root_ : unchecked_.back().child;
+			for (size_t i = common; i < word.size(); i++) {
+				int symbol = Lexicon::symbolOf(word[i]);
+				if (symbol < 0)
+					return false;
+				uint32_t next = newNode();
+				nodes_[node].edges.push_back(make_pair(symbol, next));
+				unchecked_.push_back({ node, next });
+				node = next;
+			}
+			nodes_[node].final = true;
+			return true;
+		}
+
+		void finish() { minimize(0); }
+
+		// Renumber the reachable nodes breadth first from the root and lay them out flat.
+		void flatten(vector<uint32_t>& first, vector<uint32_t>& edges, int symbolShift) {
+			vector<uint32_t> id(nodes_.size(), UINT32_MAX);
+			vector<uint32_t> order;
+			id[root_] = 0;
+			order.push_back(root_);
+			for (size_t i = 0; i < order.size(); i++) {
+				for (const pair<int, uint32_t>& e : nodes_[order[i]].edges) {
+					if (id[e.second] == UINT32_MAX) {
+						id[e.second] = (uint32_t)order.size();
+						order.push_back(e.second);
+					}
+				}
+			}
+			first.clear();
+			edges.clear();
+			first.reserve(order.size() + 1);
+			for (uint32_t n : order) {
+				BuildNode& b = nodes_[n];
+				sort(b.edges.begin(), b.edges.end());
+				first.push_back((uint32_t)edges.size() | (b.final ? 0x80000000u : 0));
+				for (const pair<int, uint32_t>& e : b.edges)
+					edges.push_back((uint32_t)e.first << symbolShift | id[e.second]);
+			}
+			first.push_back((uint32_t)edges.size());
+		}
+
+	private:
+		uint32_t newNode() {
+			if (!free_.empty()) {
+				uint32_t n = free_.back();
+				free_.pop_back();
+				return n;
+			}
+			nodes_.push_back(BuildNode());
+			return (uint32_t)nodes_.size() - 1;
+		}
+
+		// Every node's children are already unique, so a node is identified by its finality
+		// and its (symbol, child) list.
+		uint64_t hashOf(uint32_t n) const {
+			const BuildNode& b = nodes_[n];
+			uint64_t h = b.final ? 0x9e3779b97f4a7c15ULL : 0x7f4a7c159e3779b9ULL;
+			for (const pair<int, uint32_t>& e : b.edges)
+				h = (h ^ ((uint64_t)e.first << 32 | e.second)) * 0xff51afd7ed558ccdULL;
+			return h ^ (h >> 31);
+		}
+
+		bool equivalent(uint32_t a, uint32_t b) const {
+			return nodes_[a].final == nodes_[b].final && nodes_[a].edges == nodes_[b].edges;
+		}
+
+		// The registered node equivalent to n, registering n itself if there is none. The
+		// register is an open-addressing table of node ids.
+		uint32_t registered(uint32_t n) {
+			if ((registerCount_ + 1) * 2 > register_.size())
+				growRegister();
+			size_t mask = register_.size() - 1;
+			for (size_t i = hashOf(n) & mask;; i = (i + 1) & mask) {
+				if (register_[i] == UINT32_MAX) {
+					register_[i] = n;
+					registerCount_++;
+					return n;
+				}
+				if (equivalent(register_[i], n))
+					return register_[i];
+			}
+		}
+
+		void growRegister() {
+			vector<uint32_t> old(register_.size() < 1024 ? 2048 : register_.size() * 2, UINT32_MAX);
+			old.swap(register_);
+			size_t mask = register_.size() - 1;
+			for (uint32_t n : old) {
+				if (n == UINT32_MAX)
+					continue;
+				size_t i = hashOf(n) & mask;
+				while (register_[i] != UINT32_MAX)
+					i = (i + 1) & mask;
+				register_[i] = n;
+			}
+		}
+
+		// Merge the unchecked nodes below depth `down` into equivalent registered ones.
+		void minimize(size_t down) {
+			while (unchecked_.size() > down) {
+				Unchecked u = unchecked_.back();
+				unchecked_.pop_back();
+				uint32_t same = registered(u.child);
+				if (same != u.child) {
+					nodes_[u.parent].edges.back().second = same;
+					nodes_[u.child].final = false;
+					nodes_[u.child].edges.clear(); // keeps its capacity for the next word
+					free_.push_back(u.child);
+				}
+			}
+		}
+
+		vector<BuildNode> nodes_;
+		vector<uint32_t> free_;
+		vector<Unchecked> unchecked_; // the path of the last word added, not yet minimized
+		vector<uint32_t> register_;   // minimized nodes, UINT32_MAX for empty slots
+		size_t registerCount_ = 0;
+		uint32_t root_;
+	};
+}
+
+Dawg::Dawg() {
+	clear();
+}
+
+void Dawg::clear() {
+	firstStore_.assign(2, 0); // a lone, non-final root
+	firstStore_.shrink_to_fit();
+	edgeStore_ = vector<uint32_t>();
+	first_ = firstStore_.data();
+	edges_ = edgeStore_.data();
+	nodes_ = 1;
+	edgeCount_ = 0;
+}
+
+bool Dawg::build(const std::vector<std::string>& sortedWords) {
+	clear();
+	Builder builder;
+	const string none;
+	for (size_t i = 0; i < sortedWords.size(); i++) {
+		const string& previous = i > 0 ? sortedWords[i - 1] : none;
+		if ((i > 0 && previous >= sortedWords[i]) || !builder.add(sortedWords[i], previous))
+			return false;
+	}
+	builder.finish();
+	builder.flatten(firstStore_, edgeStore_, kSymbolShift);
+	if (firstStore_.size() - 1 > kTargetMask) { // too big to address with the bits left in an edge
+		clear();
+		return false;
+	}
+	firstStore_.shrink_to_fit();
+	edgeStore_.shrink_to_fit();
+	first_ = firstStore_.data();
+	edges_ = edgeStore_.data();
+	nodes_ = firstStore_.size() - 1;
+	edgeCount_ = edgeStore_.size();
+	return true;
+}
+
+bool Dawg::attach(const uint32_t* nodes, size_t nodeCount, const uint32_t* edges, size_t edgeCount) {
+	// One pass over both arrays so that a damaged or hostile file can't send a lookup out of bounds.
+	if (nodeCount == 0 || nodeCount > kTargetMask || (nodes[0] & kIndexMask) != 0 ||
+		nodes[nodeCount] != edgeCount)
+		return false;
+	for (size_t n = 0; n < nodeCount; n++) {
+		uint32_t begin = nodes[n] & kIndexMask, end = nodes[n + 1] & kIndexMask;
+		if (begin > end || end > edgeCount)
+			return false;
+		for (uint32_t i = begin; i < end; i++) {
+			if ((edges[i] & kTargetMask) >= nodeCount || (edges[i] >> kSymbolShift) >= (uint32_t)kSymbols)
+				return false;
+			if (i > begin && edges[i] >> kSymbolShift <= edges[i - 1] >> kSymbolShift)
+				return false;
+		}
+	}
+	firstStore_ = vector<uint32_t>();
+	edgeStore_ = vector<uint32_t>();
+	first_ = nodes;
+	edges_ = edges;
+	nodes_ = nodeCount;
+	edgeCount_ = edgeCount;
+	return true;
+}
+
+bool Dawg::child(Node node, int symbol, Node& next) const {
+	uint32_t end = first_[node + 1] & kIndexMask;
+	for (uint32_t i = first_[node] & kIndexMask; i < end; i++) {
+		int s = (int)(edges_[i] >> kSymbolShift);
+		if (s == symbol) {
+			next = edges_[i] & kTargetMask;
+			return true;
+		}
+		if (s > symbol)
+			break; // edges are sorted
+	}
+	return false;
+}
+
+int Dawg::children(Node node, Edge* edges) const {
+	uint32_t begin = first_[node] & kIndexMask, end = first_[node + 1] & kIndexMask;
+	for (uint32_t i = begin; i < end; i++) {
+		edges[i - begin].symbol = (int)(edges_[i] >> kSymbolShift);
+		edges[i - begin].target = edges_[i] & kTargetMask;
+	}
+	return (int)(end - begin);
+}
+
+bool Dawg::contains(const char* word, size_t length) const {
+	Node node = 0;
+	for (size_t i = 0; i < length; i++) {
+		int symbol = foldedSymbolOf(word[i]);
+		if (symbol < 0 || !child(node, symbol, node))
+			return false;
+	}
+	return isWord(node);
+}
+
+size_t Dawg::bytes() const {
+	return (nodes_ + 1 + edgeCount_) * sizeof(uint32_t);
+}
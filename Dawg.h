@@ -0,0 +1,57 @@
+#ifndef DAWG_H_
+#define DAWG_H_
+
+// A minimized deterministic acyclic word graph: a trie in which identical subtrees (common
+// suffixes such as "-ing" or "-ness") are stored once. It is built in a single pass over a sorted
+// word list (Daciuk et al., "Incremental construction of minimal acyclic finite-state automata")
+// and then flattened into two arrays, so a lookup touches one 4-byte word per node and a few
+// 4-byte edges per character. The arrays hold no pointers, so a compiled dictionary file can
+// store them and attach() can use them in place.
+
+#include "Lexicon.h"
+#include <string>
+#include <vector>
+
+class Dawg : public Lexicon {
+public:
+	Dawg();
+
+	// Build from words in strictly increasing byte order, each made of Lexicon symbols only.
+	// Returns false, leaving the graph empty, if the list is not sorted or has other characters.
+	bool build(const std::vector<std::string>& sortedWords);
+	void clear();
+
+	// The flat arrays: nodeCount() + 1 node entries and edgeCount() edges.
+	const uint32_t* nodeArray() const { return first_; }
+	const uint32_t* edgeArray() const { return edges_; }
+	// Use arrays saved from another Dawg without copying them; they must outlive this object.
+	// Returns false, leaving the graph unchanged, if they don't describe a valid graph.
+	bool attach(const uint32_t* nodes, size_t nodeCount, const uint32_t* edges, size_t edgeCount);
+
+	Node root() const { return 0; }
+	bool child(Node node, int symbol, Node& next) const;
+	int children(Node node, Edge* edges) const;
+	bool isWord(Node node) const { return (first_[node] & kFinal) != 0; }
+	size_t nodeCount() const { return nodes_; }
+	size_t edgeCount() const { return edgeCount_; }
+	size_t bytes() const;
+	bool contains(const char* word, size_t length) const;
+
+private:
+	static const uint32_t kFinal = 0x80000000u;
+	static const uint32_t kIndexMask = 0x7fffffffu;
+	static const int kSymbolShift = 27;
+	static const uint32_t kTargetMask = (1u << kSymbolShift) - 1;
+
+	Dawg(const Dawg&) = delete;
+	Dawg& operator=(const Dawg&) = delete;
+
+	// Node n's edges are edges_[first_[n] & kIndexMask .. first_[n + 1] & kIndexMask), sorted by
+	// symbol; the top bit of first_[n] marks n as the end of a word. The last entry is a sentinel.
+	const uint32_t* first_;
+	const uint32_t* edges_; // symbol << kSymbolShift | target node
+	size_t nodes_, edgeCount_;
+	std::vector<uint32_t> firstStore_, edgeStore_; // the arrays, unless attached
+};
+
+#endif // DAWG_H_
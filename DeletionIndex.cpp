@@ -0,0 +1,199 @@
+#include "DeletionIndex.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const int kIdBits = 24;
+	const uint32_t kIdMask = (1u << kIdBits) - 1;
+
+	// FNV-1a, then a finalizer so that the low bits (the bucket) mix too.
+	const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+	uint64_t hashStep(uint64_t h, char c) {
+		return (h ^ (unsigned char)c) * 0x100000001b3ULL;
+	}
+	uint64_t hashFinish(uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		return h ^ (h >> 33);
+	}
+
+	// Hash every string left after deleting up to `remaining` of s[pos, n), given the hash h of
+	// what is kept before pos. Each set of deleted positions is visited once and kept prefixes
+	// are hashed once; repeated letters can still give equal strings, which the caller removes.
+	void addDeletions(const char* s, size_t n, size_t pos, uint64_t h, int remaining, vector<uint64_t>& hashes) {
+		for (; pos < n; pos++) {
+			if (remaining > 0)
+				addDeletions(s, n, pos + 1, h, remaining - 1, hashes); // delete s[pos]
+			h = hashStep(h, s[pos]);
+		}
+		hashes.push_back(hashFinish(h));
+	}
+
+	void deletionHashes(const char* word, size_t length, int maxDistance, vector<uint64_t>& hashes) {
+		hashes.clear();
+		addDeletions(word, length, 0, kHashSeed, maxDistance, hashes);
+		sort(hashes.begin(), hashes.end());
+		hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+	}
+
+	uint32_t posting(uint64_t hash, uint32_t id) {
+		return (uint32_t)(hash >> 56) << kIdBits | id;
+	}
+}
+
+DeletionIndex::DeletionIndex() {
+	clear();
+}
+
+void DeletionIndex::clear() {
+	bucketStore_.assign(2, 0); // one empty bucket
+	bucketStore_.shrink_to_fit();
+	postingStore_ = vector<uint32_t>();
+	offsetStore_.assign(1, 0);
+	offsetStore_.shrink_to_fit();
+	textStore_ = string();
+	maxDistance_ = 0;
+	buckets_ = bucketStore_.data();
+	bucketMask_ = 0;
+	postings_ = postingStore_.data();
+	postingCount_ = 0;
+	offsets_ = offsetStore_.data();
+	wordCount_ = 0;
+	text_ = textStore_.data();
+	textSize_ = 0;
+}
+
+bool DeletionIndex::build(const Lexicon& lexicon, int maxDistance) {
+	clear();
+	if (maxDistance < 0)
+		return false;
+	string text;
+	vector<uint32_t> offsets;
+	lexicon.collectWords(text, offsets); // in symbol order, the order a trie walk offers them in
+	size_t words = offsets.size() - 1;
+	if (words > kIdMask)
+		return false;
+
+	// About one bucket per variant: a word of length n has at most sum C(n, k), k <= maxDistance.
+	size_t estimate = 0;
+	for (size_t w = 0; w < words; w++) {
+		size_t n = offsets[w + 1] - offsets[w], choose = 1;
+		for (int k = 0; k <= maxDistance && (size_t)k <= n; k++) {
+			estimate += choose;
+			choose = choose * (n - k) / (k + 1);
+		}
+	}
+	size_t bucketCount = 1;
+	while (bucketCount * 2 <= estimate)
+		bucketCount *= 2;
+	// Count each bucket's postings, then fill them in place.
+	vector<uint64_t> hashes;
+	vector<uint32_t> buckets(bucketCount + 1, 0);
+	size_t total = 0;
+	for (size_t w = 0; w < words; w++) {
+		deletionHashes(&text[offsets[w]], offsets[w + 1] - offsets[w], maxDistance, hashes);
+		for (uint64_t h : hashes)
+			buckets[(h & (bucketCount - 1)) + 1]++;
+		total += hashes.size();
+	}
+	if (total > UINT32_MAX)
+		return false;
+	for (size_t b = 0; b < bucketCount; b++)
+		buckets[b + 1] += buckets[b];
+	vector<uint32_t> postings(total);
+	vector<uint32_t> next(buckets.begin(), buckets.end() - 1);
+	for (size_t w = 0; w < words; w++) {
+		deletionHashes(&text[offsets[w]], offsets[w + 1] - offsets[w], maxDistance, hashes);
+		for (uint64_t h : hashes)
+			postings[next[h & (bucketCount - 1)]++] = posting(h, (uint32_t)w); // ids ascend within a bucket
+	}
+
+	bucketStore_.swap(buckets);
+	postingStore_.swap(postings);
+	offsetStore_.swap(offsets);
+	textStore_.swap(text);
+	maxDistance_ = (uint32_t)maxDistance;
+	buckets_ = bucketStore_.data();
+	bucketMask_ = bucketCount - 1;
+	postings_ = postingStore_.data();
+	postingCount_ = postingStore_.size();
+	offsets_ = offsetStore_.data();
+	wordCount_ = words;
+	text_ = textStore_.data();
+	textSize_ = textStore_.size();
+	return true;
+}
+
+DeletionIndex::Arrays DeletionIndex::arrays() const {
+	return { maxDistance_, buckets_, bucketMask_ + 1, postings_, postingCount_, offsets_, wordCount_, text_, textSize_ };
+}
+
+bool DeletionIndex::attach(const Arrays& a) {
+	if (a.bucketCount == 0 || (a.bucketCount & (a.bucketCount - 1)) != 0 || a.wordCount > kIdMask ||
+		a.buckets[0] != 0 || a.buckets[a.bucketCount] != a.postingCount ||
+		a.offsets[0] != 0 || a.offsets[a.wordCount] != a.textSize)
+		return false;
+	bucketStore_ = vector<uint32_t>();
+	postingStore_ = vector<uint32_t>();
+	offsetStore_ = vector<uint32_t>();
+	textStore_ = string();
+	maxDistance_ = a.maxDistance;
+	buckets_ = a.buckets;
+	bucketMask_ = a.bucketCount - 1;
+	postings_ = a.postings;
+	postingCount_ = a.postingCount;
+	offsets_ = a.offsets;
+	wordCount_ = a.wordCount;
+	text_ = a.text;
+	textSize_ = a.textSize;
+	return true;
+}
+
+size_t DeletionIndex::bytes() const {
+	return (bucketMask_ + 2 + postingCount_ + wordCount_ + 1) * sizeof(uint32_t) + textSize_;
+}
+
+void DeletionIndex::suggest(const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies) const {
+	SuggestionList results(min(maxDistance, (int)maxDistance_), maxResults, frequencies);
+	if (results.bound() < 0 || wordCount_ == 0)
+		return;
+	vector<uint64_t> hashes;
+	deletionHashes(word.data(), word.size(), results.bound(), hashes);
+	vector<uint32_t> candidates;
+	for (uint64_t h : hashes) {
+		size_t b = h & bucketMask_;
+		uint32_t begin = buckets_[b], end = buckets_[b + 1];
+		uint32_t tag = posting(h, 0);
+		for (uint32_t p = begin; p < end && p < postingCount_; p++) {
+			if ((postings_[p] & ~kIdMask) == tag)
+				candidates.push_back(postings_[p] & kIdMask);
+		}
+	}
+	// Word ids follow symbol order, so scoring them in id order offers ties the way the trie
+	// walk does.
+	sort(candidates.begin(), candidates.end());
+	candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+	vector<int> rows;
+	for (uint32_t id : candidates) {
+		int bound = results.bound();
+		if (bound < 0)
+			break;
+		if (id >= wordCount_)
+			continue;
+		uint32_t begin = offsets_[id], end = offsets_[id + 1];
+		if (begin > end || end > textSize_)
+			continue;
+		size_t length = end - begin;
+		if ((length > word.size() ? length - word.size() : word.size() - length) > (size_t)bound)
+			continue;
+		int d = boundedEditDistance(word, text_ + begin, length, bound, rows);
+		if (d <= bound)
+			results.offer(text_ + begin, length, d);
+	}
+	results.take(out);
+}
@@ -0,0 +1,80 @@
+#ifndef DELETIONINDEX_H_
+#define DELETIONINDEX_H_
+
+// A symmetric-delete suggestion index (Garbe's SymSpell). Every string obtained by deleting up
+// to maxDistance characters from a dictionary word is hashed into a bucket that lists the word.
+// Two words are within d edits only if deleting at most d characters from each leaves the same
+// string, so the candidates for a misspelling are the words in the buckets of its own deletion
+// variants: a few dozen hash lookups instead of a walk over the dictionary. Candidates are then
+// scored exactly, so hash collisions cost time but never change the answer.
+//
+// Storage is flat 32-bit arrays, like Dawg's, so a compiled dictionary can carry the index and
+// attach() can use it in place:
+//
+//     buckets   bucketCount + 1 offsets into postings (bucketCount is a power of two)
+//     postings  8 bits of the variant's hash above 24 bits of word id, grouped by bucket
+//     offsets   wordCount + 1 offsets into text
+//     text      the words, concatenated in symbol order
+//
+// The variant strings themselves are never stored.
+
+#include "Lexicon.h"
+#include "Suggest.h"
+#include <string>
+#include <vector>
+
+class DeletionIndex {
+public:
+	struct Arrays {
+		uint32_t maxDistance;
+		const uint32_t* buckets;
+		size_t bucketCount;
+		const uint32_t* postings;
+		size_t postingCount;
+		const uint32_t* offsets;
+		size_t wordCount;
+		const char* text;
+		size_t textSize;
+	};
+
+	DeletionIndex();
+
+	// Index the words of lexicon for suggestions up to maxDistance edits away. Returns false,
+	// leaving the index empty, if there are too many words to number in a posting.
+	bool build(const Lexicon& lexicon, int maxDistance);
+	void clear();
+	bool empty() const { return wordCount_ == 0; }
+
+	Arrays arrays() const;
+	// Use arrays saved from another index without copying them; they must outlive this object.
+	// Returns false, leaving the index unchanged, if their sizes don't fit together. Offsets read
+	// from the arrays are bounds-checked as they are used.
+	bool attach(const Arrays& arrays);
+
+	int maxDistance() const { return (int)maxDistance_; }
+	size_t wordCount() const { return wordCount_; }
+	size_t bytes() const;
+
+	// The best maxResults dictionary words within min(maxDistance, maxDistance()) edits of word,
+	// in the same order suggestByTrieWalk() gives them.
+	void suggest(const std::string& word, int maxDistance, size_t maxResults, std::vector<Suggestion>& out,
+		const WordFrequencies* frequencies = nullptr) const;
+
+private:
+	DeletionIndex(const DeletionIndex&) = delete;
+	DeletionIndex& operator=(const DeletionIndex&) = delete;
+
+	uint32_t maxDistance_;
+	const uint32_t* buckets_;
+	size_t bucketMask_;
+	const uint32_t* postings_;
+	size_t postingCount_;
+	const uint32_t* offsets_;
+	size_t wordCount_;
+	const char* text_;
+	size_t textSize_;
+	std::vector<uint32_t> bucketStore_, postingStore_, offsetStore_; // the arrays, unless attached
+	std::string textStore_;
+};
+
+#endif // DELETIONINDEX_H_
@@ -0,0 +1,219 @@
+#include "DictionaryFile.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const char kMagic[8] = { 'W', 'U', 'R', 'D', 'D', 'I', 'C', 'T' };
+	const uint32_t kByteOrderMark = 0x01020304;
+	const int kMaxSections = 14;
+
+	struct SectionEntry {
+		uint32_t id;
+		uint32_t reserved;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t wordCount;
+		uint64_t checksum; // of every byte after the header
+		uint32_t sectionCount;
+		uint32_t reserved;
+		SectionEntry sections[kMaxSections];
+	};
+
+	// 64-bit multiply-xor hash over 8-byte words, fast enough to verify a file on every load.
+	uint64_t checksum(const unsigned char* p, size_t n) {
+		uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+		size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			uint64_t w;
+			memcpy(&w, p + i, 8);
+			h = (h ^ w) * 0xff51afd7ed558ccdULL;
+			h ^= h >> 32;
+		}
+		for (; i < n; i++)
+			h = (h ^ p[i]) * 0x100000001b3ULL;
+		return h ^ (h >> 29);
+	}
+
+	uint64_t align64(uint64_t n) {
+		return (n + 63) & ~(uint64_t)63;
+	}
+}
+
+bool MappedFile::open(const std::string& file) {
+	close();
+#ifdef _WIN32
+	HANDLE f = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(f, &size) || size.QuadPart == 0) {
+		CloseHandle(f);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(f);
+	if (mapping == nullptr)
+		return false;
+	void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (p == nullptr) {
+		CloseHandle(mapping);
+		return false;
+	}
+	handle_ = mapping;
+	size_ = (size_t)size.QuadPart;
+#else
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // the mapping keeps the file open
+	if (p == MAP_FAILED)
+		return false;
+	size_ = (size_t)st.st_size;
+#endif
+	data_ = (const unsigned char*)p;
+	return true;
+}
+
+void MappedFile::close() {
+	if (data_ == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data_);
+	CloseHandle((HANDLE)handle_);
+#else
+	munmap((void*)data_, size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+	handle_ = nullptr;
+}
+
+void MappedFile::swap(MappedFile& other) {
+	std::swap(data_, other.data_);
+	std::swap(size_, other.size_);
+	std::swap(handle_, other.handle_);
+}
+
+bool DictionaryFile::isCompiled(const std::string& file) {
+	FILE* f = fopen(file.c_str(), "rb");
+	if (f == nullptr)
+		return false;
+	char magic[sizeof(kMagic)];
+	bool compiled = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, kMagic, sizeof(magic)) == 0;
+	fclose(f);
+	return compiled;
+}
+
+bool DictionaryFile::write(const std::string& file, uint64_t wordCount, const std::vector<Section>& sections) {
+	if (sections.size() > (size_t)kMaxSections)
+		return false;
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.byteOrder = kByteOrderMark;
+	header.wordCount = wordCount;
+	header.sectionCount = (uint32_t)sections.size();
+
+	vector<unsigned char> body;
+	for (size_t i = 0; i < sections.size(); i++) {
+		body.resize(align64(sizeof(Header) + body.size()) - sizeof(Header), 0); // a cache line, for BloomFilter's blocks
+		header.sections[i].id = sections[i].id;
+		header.sections[i].offset = sizeof(Header) + body.size();
+		header.sections[i].size = sections[i].size;
+		const unsigned char* p = (const unsigned char*)sections[i].data;
+		body.insert(body.end(), p, p + sections[i].size);
+	}
+	header.checksum = checksum(body.data(), body.size());
+
+	// Written beside file and renamed over it, so that a process with file mapped keeps the old
+	// image instead of seeing it truncated under it.
+	string temp = file + ".tmp";
+	FILE* f = fopen(temp.c_str(), "wb");
+	if (f == nullptr)
+		return false;
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		(body.empty() || fwrite(body.data(), body.size(), 1, f) == 1);
+	ok = fclose(f) == 0 && ok;
+#ifdef _WIN32
+	ok = ok && MoveFileExA(temp.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	ok = ok && rename(temp.c_str(), file.c_str()) == 0;
+#endif
+	if (!ok)
+		remove(temp.c_str());
+	return ok;
+}
+
+bool DictionaryFile::open(const std::string& file) {
+	MappedFile mapped;
+	if (!mapped.open(file) || mapped.size() < sizeof(Header))
+		return false;
+	const Header* h = (const Header*)mapped.data();
+	if (memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+		h->byteOrder != kByteOrderMark || h->sectionCount > (uint32_t)kMaxSections)
+		return false;
+	for (uint32_t i = 0; i < h->sectionCount; i++) {
+		const SectionEntry& s = h->sections[i];
+		if (s.offset % 8 != 0 || s.offset < sizeof(Header) || s.offset > mapped.size() ||
+			s.size > mapped.size() - s.offset)
+			return false;
+	}
+	if (checksum(mapped.data() + sizeof(Header), mapped.size() - sizeof(Header)) != h->checksum)
+		return false;
+	file_.swap(mapped); // the previous mapping, if any, is released with `mapped`
+	return true;
+}
+
+void DictionaryFile::close() {
+	file_.close();
+}
+
+void DictionaryFile::swap(DictionaryFile& other) {
+	file_.swap(other.file_);
+}
+
+const void* DictionaryFile::section(uint32_t id, size_t& size) const {
+	size = 0;
+	if (!isOpen())
+		return nullptr;
+	const Header* h = (const Header*)file_.data();
+	for (uint32_t i = 0; i < h->sectionCount; i++) {
+		if (h->sections[i].id == id) {
+			size = (size_t)h->sections[i].size;
+			return file_.data() + h->sections[i].offset;
+		}
+	}
+	return nullptr;
+}
+
+uint64_t DictionaryFile::wordCount() const {
+	return isOpen() ? ((const Header*)file_.data())->wordCount : 0;
+}
@@ -0,0 +1,91 @@
+#ifndef DICTIONARYFILE_H_
+#define DICTIONARYFILE_H_
+
+// Compiled dictionaries. A compiled dictionary is the flat arrays of a Dawg or DoubleArrayTrie
+// written to a file that is memory-mapped and used in place, so loading it costs a checksum pass
+// instead of parsing and building. Layout (all integers in the writer's byte order, which is
+// recorded and must match the reader's):
+//
+//     header    magic "WURDDICT", version, byte-order mark, word count, section table,
+//               checksum of everything after the header
+//     sections  each 64-byte aligned (8 in older files), located by the (id, offset, size)
+//               entries of the table
+//
+// Offsets are relative to the start of the file, so the image is position-independent.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+public:
+	MappedFile() : data_(nullptr), size_(0), handle_(nullptr) { }
+	~MappedFile() { close(); }
+
+	bool open(const std::string& file);
+	void close();
+	void swap(MappedFile& other);
+
+	const unsigned char* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* data_;
+	size_t size_;
+	void* handle_; // the Windows mapping object; unused elsewhere
+};
+
+class DictionaryFile {
+public:
+	static const uint32_t kVersion = 1;
+
+	enum SectionId {
+		DAWG_NODES = 1,
+		DAWG_EDGES = 2,
+		DOUBLE_ARRAY_UNITS = 3,
+		DELETION_PARAMS = 4,   // uint32 maxDistance, reserved
+		DELETION_BUCKETS = 5,
+		DELETION_POSTINGS = 6,
+		DELETION_OFFSETS = 7,
+		DELETION_TEXT = 8,
+		FREQUENCY_HASHES = 9,
+		FREQUENCY_RANKS = 10,
+		BLOOM_BLOCKS = 11,
+		PERFECT_HASH_SEEDS = 12,
+		PERFECT_HASH_OFFSETS = 13,
+		PERFECT_HASH_TEXT = 14,
+	};
+
+	struct Section {
+		uint32_t id;
+		const void* data;
+		size_t size; // bytes
+	};
+
+	// Whether file starts with the compiled dictionary magic (so it isn't a word list).
+	static bool isCompiled(const std::string& file);
+	// Write a compiled dictionary holding the given sections. file is replaced, not overwritten,
+	// so mappings of the old one stay valid.
+	static bool write(const std::string& file, uint64_t wordCount, const std::vector<Section>& sections);
+
+	// Map file and verify its header and checksum. Returns false if it is not a compiled
+	// dictionary of this version and byte order, or is damaged.
+	bool open(const std::string& file);
+	void close();
+	void swap(DictionaryFile& other);
+
+	// The section with the given id, or nullptr (and size 0) if there isn't one.
+	const void* section(uint32_t id, size_t& size) const;
+	uint64_t wordCount() const;
+	bool isOpen() const { return file_.data() != nullptr; }
+
+private:
+	MappedFile file_;
+};
+
+#endif // DICTIONARYFILE_H_
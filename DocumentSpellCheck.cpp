@@ -0,0 +1,415 @@
+#include "DocumentSpellCheck.h"
+#include "LineCache.h"
+#include "Lexicon.h"
+#include "AllocTrack.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const size_t kBatch = 256; // lines the worker takes per visit to the index
+	const size_t kChunk = 512; // lines per chunk of the index when it is built; chunks split at twice that
+}
+
+DocumentSpellCheck::DocumentSpellCheck(SpellCheck* spellCheck) : spellCheck_(spellCheck) {
+}
+
+DocumentSpellCheck::~DocumentSpellCheck() {
+	stop();
+}
+
+void DocumentSpellCheck::start(std::vector<std::string> lines) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	stop();
+	lock_guard<mutex> lock(mutex_);
+	retired_.swap(chunks_); // a million lines take a while to free; the worker does it
+	retiredTexts_.swap(texts_);
+	texts_ = move(lines);
+	lines_ = texts_.size();
+	chunks_.clear();
+	chunkStart_.clear();
+	for (size_t first = 0; first < lines_; first += kChunk) {
+		chunks_.emplace_back(min(kChunk, lines_ - first));
+		chunkStart_.push_back(first);
+		vector<Line>& chunk = chunks_.back();
+		for (size_t i = 0; i < chunk.size(); i++) {
+			chunk[i].state = UNCHECKED;
+			chunk[i].text = (int32_t)(first + i);
+		}
+	}
+	rebuildCounts();
+	unchecked_ = lines_;
+	misspellings_ = 0;
+	scan_ = 0;
+	shifts_.clear();
+	accepted_.clear();
+	busy_ = true;
+	stopping_ = false;
+	worker_ = thread(&DocumentSpellCheck::run, this);
+}
+
+void DocumentSpellCheck::stop() {
+	{
+		lock_guard<mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	if (worker_.joinable())
+		worker_.join();
+}
+
+void DocumentSpellCheck::wait() {
+	unique_lock<mutex> lock(mutex_);
+	idle_.wait(lock, [this] { return !busy_; });
+}
+
+void DocumentSpellCheck::locate(size_t row, size_t& chunk, size_t& offset) const {
+	chunk = upper_bound(chunkStart_.begin(), chunkStart_.end(), row) - chunkStart_.begin() - 1;
+	offset = row - chunkStart_[chunk];
+}
+
+DocumentSpellCheck::Line& DocumentSpellCheck::line(size_t row) {
+	size_t c, i;
+	locate(row, c, i);
+	return chunks_[c][i];
+}
+
+const DocumentSpellCheck::Line& DocumentSpellCheck::line(size_t row) const {
+	size_t c, i;
+	locate(row, c, i);
+	return chunks_[c][i];
+}
+
+void DocumentSpellCheck::insertLine(size_t row) {
+	if (chunks_.empty()) {
+		chunks_.emplace_back();
+		chunkStart_.push_back(0);
+		rebuildCounts();
+	}
+	size_t c, i;
+	if (row == lines_) {
+		c = chunks_.size() - 1;
+		i = chunks_[c].size();
+	}
+	else
+		locate(row, c, i);
+	chunks_[c].insert(chunks_[c].begin() + i, Line());
+	for (size_t k = c + 1; k < chunks_.size(); k++)
+		chunkStart_[k]++;
+	lines_++;
+	if (chunks_[c].size() >= 2 * kChunk) {
+		vector<Line> back(make_move_iterator(chunks_[c].begin() + kChunk), make_move_iterator(chunks_[c].end()));
+		chunks_[c].resize(kChunk);
+		chunks_.insert(chunks_.begin() + c + 1, move(back));
+		chunkStart_.insert(chunkStart_.begin() + c + 1, chunkStart_[c] + kChunk);
+		rebuildCounts();
+	}
+}
+
+void DocumentSpellCheck::eraseLine(size_t row) {
+	size_t c, i;
+	locate(row, c, i);
+	chunks_[c].erase(chunks_[c].begin() + i);
+	for (size_t k = c + 1; k < chunks_.size(); k++)
+		chunkStart_[k]--;
+	lines_--;
+	if (chunks_[c].empty()) {
+		chunks_.erase(chunks_.begin() + c);
+		chunkStart_.erase(chunkStart_.begin() + c);
+		rebuildCounts();
+	}
+}
+
+void DocumentSpellCheck::rebuildCounts() {
+	chunkProblems_.assign(chunks_.size(), 0);
+	for (size_t c = 0; c < chunks_.size(); c++) {
+		for (const Line& l : chunks_[c])
+			chunkProblems_[c] += l.problems.size();
+	}
+	fenwick_ = chunkProblems_;
+	for (size_t i = 1; i <= fenwick_.size(); i++) {
+		size_t parent = i + (i & (0 - i));
+		if (parent <= fenwick_.size())
+			fenwick_[parent - 1] += fenwick_[i - 1];
+	}
+}
+
+void DocumentSpellCheck::count(size_t chunk, long problems) {
+	misspellings_ += problems;
+	chunkProblems_[chunk] += problems;
+	for (size_t i = chunk + 1; i <= fenwick_.size(); i += i & (0 - i))
+		fenwick_[i - 1] += problems;
+}
+
+size_t DocumentSpellCheck::problemsBefore(size_t chunk) const {
+	size_t sum = 0;
+	for (size_t i = chunk; i > 0; i -= i & (0 - i))
+		sum += fenwick_[i - 1];
+	return sum;
+}
+
+size_t DocumentSpellCheck::chunkHolding(size_t problem) const {
+	size_t chunk = 0, step = 1;
+	while (step * 2 <= fenwick_.size())
+		step *= 2;
+	for (; step > 0; step /= 2) {
+		if (chunk + step <= fenwick_.size() && fenwick_[chunk + step - 1] < problem) {
+			chunk += step;
+			problem -= fenwick_[chunk - 1];
+		}
+	}
+	return chunk;
+}
+
+void DocumentSpellCheck::run() {
+	ALLOC_SCOPE(SPELL_CHECK);
+	vector<vector<Line>>().swap(retired_); // only this thread touches them until the next start()
+	vector<string>().swap(retiredTexts_);
+	// The batch: each line's row when it was taken, its text and hash, and (see
+	// SpellCheck::spellCheckLines()) the problems on all of them.
+	vector<int> rows;
+	vector<string> texts;
+	vector<uint64_t> hashes;
+	vector<SpellCheck::Position> problems;
+	vector<size_t> offsets;
+	for (;;) {
+		{
+			lock_guard<mutex> lock(mutex_);
+			// Store the last batch's results, following the rows through any splits and joins.
+			for (size_t j = 0; j < rows.size(); j++) {
+				int row = rows[j];
+				for (const Shift& s : shifts_) {
+					if (s.delta < 0 && row == s.row)
+						row = -1; // the line is gone
+					else if (row >= s.row)
+						row += s.delta;
+					if (row < 0)
+						break;
+				}
+				if (row >= 0 && row < (int)lines_ && line(row).state == UNCHECKED)
+					finish(row, hashes[j], texts[j], problems.data() + offsets[j], problems.data() + offsets[j + 1]);
+			}
+			rows.clear();
+			texts.clear();
+			shifts_.clear();
+			accepted_.clear();
+			while (!stopping_ && scan_ < lines_ && rows.size() < kBatch) {
+				Line& l = line(scan_);
+				if (l.state == UNCHECKED) {
+					rows.push_back((int)scan_);
+					texts.push_back(move(texts_[l.text]));
+				}
+				scan_++;
+			}
+			if (rows.empty()) {
+				if (scan_ >= lines_)
+					vector<string>().swap(texts_); // every line has been taken
+				busy_ = false;
+				idle_.notify_all();
+				return;
+			}
+		}
+		hashes.clear();
+		for (const string& text : texts)
+			hashes.push_back(LineCache::hash(text));
+		spellCheck_->spellCheckLines(texts.data(), texts.size(), problems, offsets);
+	}
+}
+
+void DocumentSpellCheck::finish(size_t row, uint64_t hash, const std::string& text,
+	const SpellCheck::Position* first, const SpellCheck::Position* last) {
+	size_t c, i;
+	locate(row, c, i);
+	Line& line = chunks_[c][i];
+	if (line.state != CHECKED)
+		unchecked_--;
+	long before = (long)line.problems.size();
+	line.state = CHECKED;
+	line.hash = hash;
+	line.text = -1;
+	line.problems.clear();
+	line.words.clear();
+	for (const SpellCheck::Position* p = first; p != last; p++) {
+		uint64_t word = 0;
+		if (p->start >= 0 && p->end < (int)text.size())
+			Lexicon::foldedHash(text.data() + p->start, p->end - p->start + 1, word);
+		if (std::find(accepted_.begin(), accepted_.end(), word) != accepted_.end())
+			continue; // checked before the word was accepted
+		line.problems.push_back(*p);
+		line.words.push_back(word);
+	}
+	count(c, (long)line.problems.size() - before);
+}
+
+void DocumentSpellCheck::accept(const std::string& word) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	uint64_t hash;
+	if (!Lexicon::foldedHash(word.data(), word.size(), hash))
+		return;
+	lock_guard<mutex> lock(mutex_);
+	if (busy_)
+		accepted_.push_back(hash); // for the batch the worker has out
+	for (size_t c = 0; c < chunks_.size(); c++) {
+		long removed = 0;
+		for (Line& line : chunks_[c]) {
+			if (line.state != CHECKED || std::find(line.words.begin(), line.words.end(), hash) == line.words.end())
+				continue;
+			size_t kept = 0;
+			for (size_t k = 0; k < line.words.size(); k++) {
+				if (line.words[k] == hash)
+					continue;
+				line.problems[kept] = line.problems[k];
+				line.words[kept++] = line.words[k];
+			}
+			removed += (long)(line.problems.size() - kept);
+			line.problems.resize(kept);
+			line.words.resize(kept);
+		}
+		if (removed > 0)
+			count(c, -removed);
+	}
+}
+
+void DocumentSpellCheck::invalidate(size_t row) {
+	size_t c, i;
+	locate(row, c, i);
+	Line& line = chunks_[c][i];
+	if (line.state == CHECKED) {
+		count(c, -(long)line.problems.size());
+		unchecked_++;
+		vector<SpellCheck::Position>().swap(line.problems);
+		vector<uint64_t>().swap(line.words);
+	}
+	line.state = STALE;
+	line.text = -1;
+}
+
+void DocumentSpellCheck::edited(Undo::Action action, int row) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	lock_guard<mutex> lock(mutex_);
+	if (row < 0 || row >= (int)lines_)
+		return;
+	switch (action) {
+	case Undo::INSERT:
+	case Undo::DELETE:
+		invalidate(row);
+		break;
+	case Undo::SPLIT: // the rest of the line moves to a new line below
+		invalidate(row);
+		insertLine(row + 1);
+		unchecked_++;
+		if (scan_ > (size_t)row)
+			scan_++;
+		if (busy_)
+			shifts_.push_back({ row + 1, +1 });
+		break;
+	case Undo::JOIN: // the line below is appended to this one
+		invalidate(row);
+		if (row + 1 < (int)lines_) {
+			invalidate(row + 1);
+			unchecked_--;
+			eraseLine(row + 1);
+			if (scan_ > (size_t)row + 1)
+				scan_--;
+			if (busy_)
+				shifts_.push_back({ row + 1, -1 });
+		}
+		break;
+	case Undo::ERROR:
+		break;
+	}
+}
+
+bool DocumentSpellCheck::find(int row, const std::string& text, std::vector<SpellCheck::Position>& problems) const {
+	uint64_t hash = LineCache::hash(text);
+	lock_guard<mutex> lock(mutex_);
+	if (row < 0 || row >= (int)lines_)
+		return false;
+	const Line& l = line(row);
+	if (l.state != CHECKED || l.hash != hash)
+		return false;
+	problems.insert(problems.end(), l.problems.begin(), l.problems.end());
+	return true;
+}
+
+void DocumentSpellCheck::store(int row, const std::string& text, const std::vector<SpellCheck::Position>& problems) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	uint64_t hash = LineCache::hash(text);
+	lock_guard<mutex> lock(mutex_);
+	if (row >= 0 && row < (int)lines_)
+		finish(row, hash, text, problems.data(), problems.data() + problems.size());
+}
+
+DocumentSpellCheck::Stats DocumentSpellCheck::stats() const {
+	lock_guard<mutex> lock(mutex_);
+	return { lines_, unchecked_, misspellings_ };
+}
+
+bool DocumentSpellCheck::nextMisspelling(int row, int col, int& foundRow, SpellCheck::Position& found) const {
+	lock_guard<mutex> lock(mutex_);
+	if (misspellings_ == 0)
+		return false;
+	size_t c = 0, i = 0;
+	if (row >= (int)lines_)
+		c = chunks_.size(); // past the end: wrap to the first
+	else if (row >= 0) {
+		locate(row, c, i);
+		for (const SpellCheck::Position& p : chunks_[c][i].problems) {
+			if (p.start > col) {
+				foundRow = row;
+				found = p;
+				return true;
+			}
+		}
+		i++;
+	}
+	if (c < chunks_.size() && chunkProblems_[c] == 0)
+		i = chunks_[c].size(); // nothing to scan in this chunk
+	for (;;) {
+		for (; c < chunks_.size() && i < chunks_[c].size(); i++) {
+			if (!chunks_[c][i].problems.empty()) {
+				foundRow = (int)(chunkStart_[c] + i);
+				found = chunks_[c][i].problems.front();
+				return true;
+			}
+		}
+		size_t before = c < chunks_.size() ? problemsBefore(c + 1) : misspellings_;
+		c = chunkHolding(before < misspellings_ ? before + 1 : 1); // wrapping around at the end
+		i = 0;
+	}
+}
+
+bool DocumentSpellCheck::previousMisspelling(int row, int col, int& foundRow, SpellCheck::Position& found) const {
+	lock_guard<mutex> lock(mutex_);
+	if (misspellings_ == 0)
+		return false;
+	size_t c = chunks_.size(), i = 0; // i counts down: the lines before i in chunk c
+	if (row >= 0 && row < (int)lines_) {
+		locate(row, c, i);
+		const vector<SpellCheck::Position>& problems = chunks_[c][i].problems;
+		for (size_t k = problems.size(); k > 0; k--) {
+			if (problems[k - 1].start < col) {
+				foundRow = row;
+				found = problems[k - 1];
+				return true;
+			}
+		}
+	}
+	else if (row < 0)
+		c = 0, i = 0; // before the start: wrap to the last
+	if (c < chunks_.size() && chunkProblems_[c] == 0)
+		i = 0;
+	for (;;) {
+		for (; c < chunks_.size() && i > 0; i--) {
+			if (!chunks_[c][i - 1].problems.empty()) {
+				foundRow = (int)(chunkStart_[c] + i - 1);
+				found = chunks_[c][i - 1].problems.back();
+				return true;
+			}
+		}
+		size_t before = c < chunks_.size() ? problemsBefore(c) : misspellings_ + 1;
+		c = chunkHolding(before > 0 && before <= misspellings_ ? before : misspellings_); // wrapping around at the start
+		i = chunks_[c].size();
+	}
+}
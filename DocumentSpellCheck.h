@@ -0,0 +1,155 @@
+#ifndef DOCUMENTSPELLCHECK_H_
+#define DOCUMENTSPELLCHECK_H_
+
+// Spell checking for a whole document, kept up to date as it is edited. The index holds one
+// entry per line of the document: a hash of the line's text and its misspelled spans. After
+// start(), a worker thread checks every line in the background, so the document-wide count of
+// misspellings is known without the lines ever being displayed, and the GUI reads the spans of
+// the lines it draws from the index instead of checking them itself.
+//
+// Edits arrive as the INSERT/DELETE/SPLIT/JOIN events the editor reports to its Undo (see
+// DocumentUndo below), and undone edits as the actions Undo::get() hands back. An edit marks the
+// lines it touched stale and, for a split or join, inserts or removes an entry so the lines below
+// keep their results. The line an edit touched is on the screen by the next redraw, which checks
+// it (one line, with whatever else changed) and stores the result with store(); nothing else is
+// ever checked twice. find() only answers when the stored hash matches the text it is shown, so
+// an event that doesn't match what the editor really did costs a re-check, never a wrong answer.
+
+#include "SpellCheck.h"
+#include "Undo.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DocumentSpellCheck {
+public:
+	struct Stats {
+		size_t lines;
+		size_t unchecked;     // lines not yet checked, or changed since
+		size_t misspellings;  // problems on the checked lines
+	};
+
+	// spellCheck must allow spellCheckLines() from the worker alongside calls from other threads
+	// (StudentSpellCheck does), and must stay loaded until stop() returns.
+	explicit DocumentSpellCheck(SpellCheck* spellCheck);
+	~DocumentSpellCheck();
+
+	// Index the document's lines, none of them checked yet, and start checking them in the
+	// background.
+	void start(std::vector<std::string> lines);
+	// Stop the worker, e.g. before the dictionary is replaced; the results so far are kept.
+	void stop();
+	// Block until the worker has checked every line it was given, or was stopped.
+	void wait();
+
+	// The editor changed the document at row, as Undo::submit() or Undo::get() describe it.
+	void edited(Undo::Action action, int row);
+
+	// The problems on the line at row, if it has been checked and still reads text.
+	bool find(int row, const std::string& text, std::vector<SpellCheck::Position>& problems) const;
+	// Record the problems on the line at row, which reads text, as checked by the caller.
+	void store(int row, const std::string& text, const std::vector<SpellCheck::Position>& problems);
+
+	// word (in any case) is no longer a misspelling, e.g. it was added to the dictionary: drop it
+	// from the lines checked so far and from the batch the worker has out. No line is checked again.
+	void accept(const std::string& word);
+
+	Stats stats() const;
+
+	// The first misspelling that starts after column col of row, or failing that the first one
+	// in the document, among the lines checked so far. Returns false if there are none. It takes
+	// a binary search over the index's chunks and a scan of at most two of them.
+	bool nextMisspelling(int row, int col, int& foundRow, SpellCheck::Position& found) const;
+	// Likewise the last misspelling that starts before column col of row, or the document's last.
+	bool previousMisspelling(int row, int col, int& foundRow, SpellCheck::Position& found) const;
+
+private:
+	enum State { STALE, UNCHECKED, CHECKED };
+
+	struct Line {
+		uint64_t hash = 0; // of the text, once CHECKED
+		int32_t text = -1; // index into texts_ while UNCHECKED
+		State state = STALE;
+		std::vector<SpellCheck::Position> problems; // once CHECKED
+		std::vector<uint64_t> words; // Lexicon::foldedHash() of each problem's word, for accept()
+	};
+
+	struct Shift {
+		int row;   // the first row it moved
+		int delta; // +1 for a line inserted at row, -1 for the line at row removed
+	};
+
+	DocumentSpellCheck(const DocumentSpellCheck&) = delete;
+	DocumentSpellCheck& operator=(const DocumentSpellCheck&) = delete;
+
+	// With mutex_ held:
+	void locate(size_t row, size_t& chunk, size_t& offset) const;
+	Line& line(size_t row);
+	const Line& line(size_t row) const;
+	void insertLine(size_t row);
+	void eraseLine(size_t row);
+	void invalidate(size_t row);
+	void finish(size_t row, uint64_t hash, const std::string& text, const SpellCheck::Position* first,
+		const SpellCheck::Position* last);
+	void count(size_t chunk, long problems);
+	void rebuildCounts();
+	size_t problemsBefore(size_t chunk) const; // in chunks [0, chunk)
+	size_t chunkHolding(size_t problem) const; // the chunk with the problem-th (from 1) problem
+
+	void run();
+
+	SpellCheck* spellCheck_;
+	// The index is cut into chunks of a few hundred lines, so a split or join in a long document
+	// moves one chunk's entries and a row is found by a binary search over the chunks' first rows.
+	std::vector<std::vector<Line>> chunks_;
+	std::vector<size_t> chunkStart_; // row of each chunk's first line
+	std::vector<size_t> chunkProblems_; // misspellings on each chunk's checked lines
+	std::vector<size_t> fenwick_; // a Fenwick tree over chunkProblems_, for next/previousMisspelling()
+	size_t lines_ = 0;
+	std::vector<std::string> texts_; // as given to start(), until the worker has been through them
+	// The previous document's index and unchecked text, for the worker to free.
+	std::vector<std::vector<Line>> retired_;
+	std::vector<std::string> retiredTexts_;
+	size_t unchecked_ = 0, misspellings_ = 0;
+	size_t scan_ = 0; // the worker's next row
+	std::vector<Shift> shifts_; // rows inserted and removed while a batch is out
+	std::vector<uint64_t> accepted_; // words accept()ed while a batch is out
+	bool busy_ = false; // the worker has lines left to check
+	bool stopping_ = false;
+	std::thread worker_;
+	mutable std::mutex mutex_;
+	std::condition_variable idle_;
+};
+
+// An Undo that passes everything on to another and tells a DocumentSpellCheck which lines each
+// edit, and each undone edit, touched.
+class DocumentUndo : public Undo {
+public:
+	// Takes ownership of undo.
+	DocumentUndo(Undo* undo, DocumentSpellCheck* document) : undo_(undo), document_(document) { }
+	~DocumentUndo() { delete undo_; }
+
+	void submit(const Action action, int row, int col, char ch = 0) {
+		undo_->submit(action, row, col, ch);
+		document_->edited(action, row);
+	}
+	Action get(int& row, int& col, int& count, std::string& text) {
+		Action action = undo_->get(row, col, count, text);
+		if (action != Undo::ERROR)
+			document_->edited(action, row); // the editor is about to apply it
+		return action;
+	}
+	void clear() { undo_->clear(); }
+
+private:
+	DocumentUndo(const DocumentUndo&) = delete;
+	DocumentUndo& operator=(const DocumentUndo&) = delete;
+
+	Undo* undo_;
+	DocumentSpellCheck* document_;
+};
+
+#endif // DOCUMENTSPELLCHECK_H_
@@ -0,0 +1,155 @@
+#include "DoubleArrayTrie.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+DoubleArrayTrie::DoubleArrayTrie() {
+	clear();
+}
+
+void DoubleArrayTrie::clear() {
+	store_.assign(1, Unit{ 0, 0 }); // the root, which is its own parent
+	store_.shrink_to_fit();
+	units_ = store_.data();
+	size_ = store_.size();
+	nodes_ = 1;
+	nextCheck_ = 1;
+}
+
+bool DoubleArrayTrie::build(const std::vector<std::string>& sortedWords) {
+	clear();
+	for (size_t i = 1; i < sortedWords.size(); i++) {
+		if (sortedWords[i - 1] >= sortedWords[i]) {
+			clear();
+			return false;
+		}
+	}
+	store_.assign(1024, Unit{ 0, kFree });
+	store_[0].check = 0;
+	if (!insertChildren(sortedWords, 0, sortedWords.size(), 0, 0)) {
+		clear();
+		return false;
+	}
+	size_t used = store_.size();
+	while (used > 1 && store_[used - 1].check == kFree)
+		used--;
+	store_.resize(used);
+	store_.shrink_to_fit();
+	units_ = store_.data();
+	size_ = store_.size();
+	return true;
+}
+
+bool DoubleArrayTrie::attach(const Unit* units, size_t count) {
+	// Lookups bounds-check child slots against count, so only the parents need checking.
+	if (count == 0 || count > kBaseMask || units[0].check != 0)
+		return false;
+	size_t nodes = 1;
+	for (size_t i = 1; i < count; i++) {
+		if (units[i].check == kFree)
+			continue;
+		if (units[i].check >= count || (units[units[i].check].base & kBaseMask) >= i)
+			return false;
+		nodes++;
+	}
+	store_ = vector<Unit>();
+	units_ = units;
+	size_ = count;
+	nodes_ = nodes;
+	return true;
+}
+
+// Place the children of node, which spells the first depth characters of words[begin, end),
+// then recurse into each child. Words sharing a prefix are contiguous because the list is sorted.
+bool DoubleArrayTrie::insertChildren(const std::vector<std::string>& words, size_t begin, size_t end,
+	size_t depth, uint32_t node) {
+	int symbols[kSymbols];
+	size_t starts[kSymbols + 1];
+	int count = 0;
+	if (begin < end && words[begin].size() == depth) {
+		store_[node].base |= kFinal; // only the first word of the range can end here
+		begin++;
+	}
+	for (size_t i = begin; i < end; i++) {
+		int symbol = symbolOf(words[i][depth]);
+		if (symbol < 0)
+			return false;
+		if (count == 0 || symbols[count - 1] != symbol) {
+			if (count == kSymbols)
+				return false; // byte order put a symbol out of place; can't happen for valid input
+			symbols[count] = symbol;
+			starts[count++] = i;
+		}
+	}
+	if (count == 0)
+		return true;
+	starts[count] = end;
+
+	uint32_t base = findBase(symbols, count);
+	if (base > kBaseMask)
+		return false;
+	store_[node].base = (store_[node].base & kFinal) | base;
+	for (int i = 0; i < count; i++)
+		store_[base + symbols[i] + 1].check = node;
+	nodes_ += count;
+	for (int i = 0; i < count; i++) {
+		if (!insertChildren(words, starts[i], starts[i + 1], depth + 1, base + symbols[i] + 1))
+			return false;
+	}
+	return true;
+}
+
+// The smallest base at which every child slot is free, growing the array as needed.
+uint32_t DoubleArrayTrie::findBase(const int* symbols, int count) {
+	size_t pos = nextCheck_ > (size_t)symbols[0] + 1 ? nextCheck_ : (size_t)symbols[0] + 1;
+	size_t firstFree = 0, busy = 0;
+	for (;; pos++) {
+		if (pos + kSymbols + 1 >= store_.size())
+			store_.resize(store_.size() * 2, Unit{ 0, kFree });
+		if (store_[pos].check != kFree) {
+			busy++;
+			continue;
+		}
+		if (firstFree == 0)
+			firstFree = pos;
+		size_t base = pos - symbols[0] - 1;
+		bool fits = true;
+		for (int i = 1; i < count && fits; i++)
+			fits = store_[base + symbols[i] + 1].check == kFree;
+		if (fits) {
+			// Stop rescanning the start of the array once it is almost full.
+			if (firstFree && (double)busy / (pos - nextCheck_ + 1) >= 0.95)
+				nextCheck_ = firstFree;
+			return (uint32_t)base;
+		}
+	}
+}
+
+int DoubleArrayTrie::children(Node node, Edge* edges) const {
+	int count = 0;
+	for (int symbol = 0; symbol < kSymbols; symbol++) {
+		Node next;
+		if (child(node, symbol, next)) {
+			edges[count].symbol = symbol;
+			edges[count++].target = next;
+		}
+	}
+	return count;
+}
+
+bool DoubleArrayTrie::contains(const char* word, size_t length) const {
+	const Unit* units = units_;
+	const size_t size = size_;
+	uint32_t node = 0;
+	for (size_t i = 0; i < length; i++) {
+		int symbol = foldedSymbolOf(word[i]);
+		if (symbol < 0)
+			return false;
+		uint32_t t = (units[node].base & kBaseMask) + symbol + 1;
+		if (t >= size || units[t].check != node)
+			return false;
+		node = t;
+	}
+	return (units[node].base & kFinal) != 0;
+}
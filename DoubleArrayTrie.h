@@ -0,0 +1,66 @@
+#ifndef DOUBLEARRAYTRIE_H_
+#define DOUBLEARRAYTRIE_H_
+
+// A double-array trie (Aoe, "An efficient digital search algorithm by using a double-array
+// structure"). Every trie node is a slot in one array; the child of node s on symbol c is slot
+// base[s] + c + 1, and it belongs to s only if check[] of that slot is s. base and check sit
+// side by side, so following a character costs one 8-byte read and no pointer chasing. Like
+// Dawg, the array can be saved to a compiled dictionary file and attached in place.
+
+#include "Lexicon.h"
+#include <string>
+#include <vector>
+
+class DoubleArrayTrie : public Lexicon {
+public:
+	struct Unit {
+		uint32_t base;  // top bit marks the end of a word
+		uint32_t check; // parent slot, or kFree
+	};
+	static const uint32_t kFree = 0xffffffffu; // check of an unused slot
+
+	DoubleArrayTrie();
+
+	// Build from words in strictly increasing byte order, each made of Lexicon symbols only.
+	// Returns false, leaving the trie empty, if the list is not sorted or has other characters.
+	bool build(const std::vector<std::string>& sortedWords);
+	void clear();
+
+	const Unit* unitArray() const { return units_; }
+	size_t unitCount() const { return size_; }
+	// Use units saved from another trie without copying them; they must outlive this object.
+	// Returns false, leaving the trie unchanged, if they don't describe a valid trie.
+	bool attach(const Unit* units, size_t count);
+
+	Node root() const { return 0; }
+	bool child(Node node, int symbol, Node& next) const {
+		Node t = (units_[node].base & kBaseMask) + symbol + 1;
+		if (t >= size_ || units_[t].check != node)
+			return false;
+		next = t;
+		return true;
+	}
+	int children(Node node, Edge* edges) const;
+	bool isWord(Node node) const { return (units_[node].base & kFinal) != 0; }
+	size_t nodeCount() const { return nodes_; }
+	size_t bytes() const { return size_ * sizeof(Unit); }
+	bool contains(const char* word, size_t length) const;
+
+private:
+	static const uint32_t kFinal = 0x80000000u;
+	static const uint32_t kBaseMask = 0x7fffffffu;
+
+	DoubleArrayTrie(const DoubleArrayTrie&) = delete;
+	DoubleArrayTrie& operator=(const DoubleArrayTrie&) = delete;
+
+	bool insertChildren(const std::vector<std::string>& words, size_t begin, size_t end, size_t depth, uint32_t node);
+	uint32_t findBase(const int* symbols, int count);
+
+	const Unit* units_;
+	size_t size_;
+	size_t nodes_;
+	std::vector<Unit> store_; // the units, unless attached; grows while building
+	size_t nextCheck_; // slots below this are (nearly) all in use; only used while building
+};
+
+#endif // DOUBLEARRAYTRIE_H_
@@ -10,7 +10,20 @@
 #include "Undo.h"
 #include "TextEditor.h"
 #include "SpellCheck.h"
+#include "DocumentSpellCheck.h"
+#include "WordTokenizer.h"
 #include "TextIO.h"
+#include "Trace.h"
+#include "AllocTrack.h"
+#include "KeyScript.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
 
 class EditorGui {
 public:
@@ -19,20 +32,30 @@ public:
 	// cols: # of columns in the tetx editor window
 	// filename: A path/filename used to load up a file upon initialization.
 	EditorGui(int rows, int cols) {
-		undo_ = createUndo();
-		te_ = createTextEditor(undo_);
 		spell_check_ = createSpellCheck();
+		document_ = new DocumentSpellCheck(spell_check_);
+		undo_ = new DocumentUndo(createUndo(), document_); // edits also reach the document's spell check
+		te_ = createTextEditor(undo_);
 		rows_ = rows - 1; // leave the last row for status/loading files.
 		cols_ = cols;
 		top_ = 0;
 		left_ = 0;
 		loaded_dictionary_ = false;
+		// Words added with Ctrl-A are kept here, and are correct in every dictionary.
+		const std::string user = userDictionaryFile();
+		if (!user.empty())
+			spell_check_->loadUserDictionary(user);
+		if (const char* record = getenv("WURD_RECORD"))
+			recordSession(record);
 	}
 
 	// EditorGui destructor.
 	~EditorGui() {
+		if (loader_.joinable())
+			loader_.join(); // a dictionary still loading
 		delete te_;
 		delete undo_;
+		delete document_; // stops the background spell check before the dictionary goes away
 		delete spell_check_;
 	}
 
@@ -40,26 +63,61 @@ public:
 	// dictionary: The fill path and filename of the dictionary.txt file, e.g., c:\cs32\proj4\dictionary.txt
 	// Returns true if the dictionary was successfully loaded.
 	bool loadDictionary(const std::string& dictionary) {
+		if (record_.is_open())
+			record_ << "# dictionary " << dictionary << '\n';
+		finishLoadingDictionary(true); // one load at a time
+		if (!spell_check_->loadsConcurrently())
+			document_->stop(); // the spell checker can't be used while it loads
 		if (spell_check_->load(dictionary))
 			loaded_dictionary_ = true;
+		spellCheckDocument();
 
 		return loaded_dictionary_;
 	}
 
+	// Ask for a dictionary and load it. If the spell checker can load alongside checking, that
+	// happens on a thread of its own, and editing (checked against the old dictionary) goes on
+	// meanwhile with the load's progress on the status line.
 	void promptAndLoadDictionary() {
 		std::string dictionary;
-		if (getInput("Enter dictionary path/filename: ", dictionary)) {
-			if (loadDictionary(dictionary)) {
-				writeStatus("Loaded dictionary successfully!");
-			}
-			else
-				writeStatus("Unable to load dictionary.");
+		if (!getInput("Enter dictionary path/filename: ", dictionary))
+			writeStatus("No dictionary entered.");
+		else if (spell_check_->loadsConcurrently()) {
+			finishLoadingDictionary(true);
+			if (record_.is_open())
+				record_ << "# dictionary " << dictionary << '\n';
+			loader_done_ = false;
+			loader_ = std::thread([this, dictionary] {
+				loader_loaded_ = spell_check_->load(dictionary);
+				loader_done_ = true;
+			});
+		}
+		else if (loadDictionary(dictionary)) {
+			writeStatus("Loaded dictionary successfully!");
 		}
 		else
-			writeStatus("No dictionary entered.");
+			writeStatus("Unable to load dictionary.");
 		redisplayTheEditorWindowAndPositionCursor(false);
 	}
 
+	// If a dictionary loading in the background has finished, say how it went and check the document
+	// against it; with wait, first block until it has. run() calls this while a load is running and
+	// the headless driver after each key. Returns true if a load was finished.
+	bool finishLoadingDictionary(bool wait) {
+		if (!loader_.joinable() || (!wait && !loader_done_))
+			return false;
+		loader_.join();
+		if (loader_loaded_) {
+			loaded_dictionary_ = true;
+			spellCheckDocument();
+			writeStatus("Loaded dictionary successfully!");
+		}
+		else
+			writeStatus("Unable to load dictionary.");
+		redisplayTheEditorWindowAndPositionCursor(false);
+		return true;
+	}
+
 	// Used to load a text file into your text editor.
 	// file_to_load: The name of the file to load.
 	void loadFileToEdit(const std::string& file_to_load = "") {
@@ -67,6 +125,9 @@ public:
 		te_->getPos(cur_row, cur_col);
 		std::string filename = file_to_load;
 
+		if (!filename.empty() && record_.is_open())
+			record_ << "# file " << filename << '\n';
+
 		// If the user didn't pass in a filename, then we're going to prompt them on the screen
 		// for a valid path/filename to load.
 		if (filename.empty()) {
@@ -80,6 +141,8 @@ public:
 		// Load the file and display the appropriate status (success/fail) on the screen's status line.
 		const bool loaded = te_->load(filename);
 		if (loaded) {
+			useDocumentDictionaries(filename);
+			spellCheckDocument();
 			filename_ = filename;
 			resetCursorToTopOfFile();
 			writeStatus("Loaded file successfully!");
@@ -89,14 +152,57 @@ public:
 			writeStatus("Unable to load file.");
 	}
 
+	// A document can name the dictionaries it is written in, beyond the one loaded with Ctrl-D, in a
+	// file beside it: notes.txt's in notes.txt.dictionaries, one per line as "path [priority]", with
+	// paths relative to the document's directory. They are stacked on that dictionary for as long
+	// as the document is open.
+	void useDocumentDictionaries(const std::string& filename) {
+		finishLoadingDictionary(true); // the stack is changed one load at a time
+		for (const std::string& file : document_dictionaries_)
+			spell_check_->removeDictionary(file);
+		document_dictionaries_.clear();
+		const size_t slash = filename.find_last_of("/\\");
+		const std::string directory = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+		std::ifstream list(filename + ".dictionaries");
+		std::string line;
+		while (std::getline(list, line)) {
+			std::istringstream fields(line);
+			std::string file;
+			int priority = 0;
+			if (!(fields >> file) || file[0] == '#')
+				continue;
+			fields >> priority;
+			if (file[0] != '/' && file[0] != '\\' && file.find(':') == std::string::npos)
+				file = directory + file;
+			if (spell_check_->addDictionary(file, priority))
+				document_dictionaries_.push_back(file);
+		}
+	}
+
 	// Run our main text editor. When this function returns, it means the user decided to quit/exit
 	// from the editor.
 	void run() {
-		bool cont;
-		do {
-			const int ch = TextIO::getChar();
-			cont = processKey(ch);
-		} while (cont);
+		const int kProgressIntervalMs = 100; // how often a dictionary load's progress is redrawn
+		bool cont = true;
+		while (cont) {
+			const int ch = loader_.joinable() ? TextIO::getChar(kProgressIntervalMs) : TextIO::getChar();
+			if (!finishLoadingDictionary(false) && ch == NO_KEY)
+				redisplayTheEditorWindowAndPositionCursor(false); // the load's progress
+			if (ch != NO_KEY)
+				cont = processKey(ch);
+		}
+	}
+
+	// Record every key (and every answer typed at a prompt) with its time to a key script that
+	// tools/headless.cpp can replay. Setting WURD_RECORD to a filename does the same.
+	// Returns false if the file could not be created.
+	bool recordSession(const std::string& file) {
+		record_.close();
+		record_.open(file);
+		record_start_ns_ = Trace::nowNs();
+		if (record_)
+			record_ << "# Wurd session\n";
+		return (bool)record_;
 	}
 
 	// Print the status line on the bottom of the screen, overwriting other text that might have been there before.
@@ -106,13 +212,15 @@ public:
 		TextIO::print(line + std::string(cols_ - line.length(), ' '));
 	}
 
-private:
-
 	// Process each key that the user presses and call the appropriate function in the student's
 	// editor class.
 	// ch: The character that was pressed (e.g., a letter, backspace, tab, enter, delete, ctrl-L, ctrl-S, ctrl-X).
 	// Returns true if the user wants to keep editing, and false if they want to quit editing (Ctrl-X).
+	// This is public so that the headless driver (tools/headless.cpp) can feed scripted keys.
 	bool processKey(const int ch) {
+		TRACE_SCOPE(PROCESS_KEY);
+		ALLOC_SCOPE(GUI);
+		recordKey(ch);
 		switch (ch) {
 		case KEY_UP:
 			te_->move(TextEditor::Dir::UP);
@@ -159,6 +267,21 @@ private:
 		case CTRL_D:
 			promptAndLoadDictionary();
 			break;
+		case CTRL_N:	// Jump to the next misspelled word
+			jumpToMisspelling(true);
+			break;
+		case CTRL_P:	// Jump to the previous misspelled word
+			jumpToMisspelling(false);
+			break;
+		case CTRL_A:	// Add the word under the cursor to the user dictionary
+			acceptWordUnderCursor(true);
+			return true;
+		case CTRL_G:	// Ignore the word under the cursor until the editor exits
+			acceptWordUnderCursor(false);
+			return true;
+		case CTRL_W:	// Show words that complete the one being typed
+			showCompletions();
+			return true;
 		case CTRL_X:
 			if (quit()) return false;
 			break;
@@ -171,6 +294,8 @@ private:
 		return true;
 	}
 
+private:
+
 	// This addresses a page-up keypress, moving the window up by one screen's worth.
 	void prevPage() {
 		int cursor_dist_from_top = getCurDistFromTopRow();
@@ -201,6 +326,52 @@ private:
 		if (top_ < 0) top_ = 0;
 	}
 
+	// Move the cursor to the start of the next (or previous) misspelled word in the document,
+	// wrapping around at either end, and scroll it to the middle of the screen if it is off it.
+	void jumpToMisspelling(bool forward) {
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		int row;
+		SpellCheck::Position found;
+		if (!loaded_dictionary_ ||
+			!(forward ? document_->nextMisspelling(cur_row, cur_col, row, found)
+				: document_->previousMisspelling(cur_row, cur_col, row, found)))
+			return;
+		// The editor only moves a step at a time.
+		while (cur_row != row) {
+			const int before = cur_row;
+			te_->move(cur_row < row ? TextEditor::Dir::DOWN : TextEditor::Dir::UP);
+			te_->getPos(cur_row, cur_col);
+			if (cur_row == before) return; // the index is ahead of the editor
+		}
+		te_->move(TextEditor::Dir::HOME);
+		for (int i = 0; i < found.start; ++i) {
+			te_->move(TextEditor::Dir::RIGHT);
+			te_->getPos(cur_row, cur_col);
+			if (cur_row != row) { // past the end of the line
+				te_->move(TextEditor::Dir::LEFT);
+				break;
+			}
+		}
+		if (row < top_ || row >= top_ + rows_) {
+			top_ = row - rows_ / 2;
+			if (top_ < 0) top_ = 0;
+		}
+	}
+
+	// The status line's count of misspelled words in the document, e.g. "12 misspellings", with
+	// how far the background check has got while it is still running.
+	std::string getMisspellingCountString() const {
+		if (loader_.joinable() && !loader_done_)
+			return "Loading dictionary " + std::to_string(spell_check_->loadProgress()) + "%";
+		if (!loaded_dictionary_) return "";
+		const DocumentSpellCheck::Stats stats = document_->stats();
+		std::string count = std::to_string(stats.misspellings) + (stats.misspellings == 1 ? " misspelling" : " misspellings");
+		if (stats.unchecked > 0)
+			count += " (checked " + std::to_string((stats.lines - stats.unchecked) * 100 / stats.lines) + "%)";
+		return count;
+	}
+
 	// Get the distance from the top of the screen to the current row where the cursor
 	// is being displayed. 
 	// Returns the vertical distance of the user's cursor in the editor from the top of the screen.
@@ -210,12 +381,24 @@ private:
 		return cur_row - top_;
 	}
 
-	// Get a list of spelling suggestions for the word in the editor that the cursor is currently
-	// positioned on top of. If the word is spelled correctly, this returns the empty string.
-	// Otherwise it returns a string like: "Spelling suggestions: apple, ample" if there are
-	// suggestions or "No spelling suggestions." if there are no suggestions.
-	// Returns the suggestion string.
-	std::string getSuggestionString() {
+	// The file of the user's added words: WURD_USER_DICTIONARY if it is set, otherwise
+	// .wurd_user_dictionary in the home directory, or "" (words are added for the session only)
+	// if there is none.
+	static std::string userDictionaryFile() {
+		if (const char* file = getenv("WURD_USER_DICTIONARY"))
+			return file;
+#ifdef _WIN32
+		const char* home = getenv("USERPROFILE");
+#else
+		const char* home = getenv("HOME");
+#endif
+		if (home == nullptr || *home == '\0')
+			return "";
+		return std::string(home) + "/.wurd_user_dictionary";
+	}
+
+	// The full word that the cursor is sitting on, or "" if it isn't on one.
+	std::string getWordUnderCursor() {
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		std::vector<std::string> lines;
@@ -224,7 +407,6 @@ private:
 		if (cur_col >= lines[0].length()) return ""; // at end of line
 		if (!isWordChar(lines[0][cur_col])) return "";  // not on a word
 
-		// Extract the full word that the cursor is sitting on.
 		while (cur_col >= 0 && isWordChar(lines[0][cur_col]))
 			--cur_col;
 		++cur_col;
@@ -233,6 +415,74 @@ private:
 			cur_word += lines[0][cur_col];
 			++cur_col;
 		}
+		return cur_word;
+	}
+
+	// Add the word under the cursor to the user dictionary (or just ignore it, if !add), and take
+	// it off the document's misspellings.
+	void acceptWordUnderCursor(bool add) {
+		const std::string word = getWordUnderCursor();
+		if (word.empty())
+			writeStatus("Not on a word.");
+		else if (!(add ? spell_check_->addWord(word) : spell_check_->ignoreWord(word)))
+			writeStatus(add ? "Unable to add word." : "Unable to ignore word.");
+		else {
+			document_->accept(word);
+			writeStatus((add ? "Added \"" : "Ignoring \"") + word + "\".");
+		}
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// The part of a word that ends at the cursor, or "" if the cursor isn't just after a word
+	// character.
+	std::string getWordBeforeCursor() {
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		std::vector<std::string> lines;
+		te_->getLines(cur_row, 1, lines);
+		if (lines.empty()) return "";
+		int start = std::min(cur_col, static_cast<int>(lines[0].length()));
+		const int end = start;
+		while (start > 0 && isWordChar(lines[0][start - 1]))
+			--start;
+		return lines[0].substr(start, end - start);
+	}
+
+	// Show on the status line the dictionary words that begin with the word before the cursor,
+	// most common first, as many as fit beside the misspelling count.
+	void showCompletions() {
+		const std::string prefix = getWordBeforeCursor();
+		if (prefix.empty())
+			writeStatus("Not after a word.");
+		else {
+			const int kNumCompletions = 20;
+			std::vector<std::string> completions;
+			spell_check_->complete(prefix, kNumCompletions, completions);
+			// Leave room for the misspelling count at the right-hand end.
+			const int room = cols_ - static_cast<int>(getMisspellingCountString().length()) - 1;
+			std::string line;
+			const std::string base = "Completions: ";
+			const int kCommaLength = 2;
+			// Stop at the first that doesn't fit, so that a shorter, rarer word never jumps it.
+			for (const auto& c : completions) {
+				if (static_cast<int>(line.length() + c.length() + base.length() + kCommaLength) > room)
+					break;
+				if (!line.empty()) line += ", ";
+				line += c;
+			}
+			writeStatus(line.empty() ? "No completions." : base + line);
+		}
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Get a list of spelling suggestions for the word in the editor that the cursor is currently
+	// positioned on top of. If the word is spelled correctly, this returns the empty string.
+	// Otherwise it returns a string like: "Spelling suggestions: apple, ample" if there are
+	// suggestions or "No spelling suggestions." if there are no suggestions.
+	// Returns the suggestion string.
+	std::string getSuggestionString() {
+		const std::string cur_word = getWordUnderCursor();
+		if (cur_word.empty()) return "";
 
 		// Ask the student's spell checker if the word is spelled correctly, and if not
 		// for up to kNumSuggestions suggestions.
@@ -262,8 +512,7 @@ private:
 	// ch: The character to check.
 	// Returns true if the character is one that's considered part of a word.
 	bool isWordChar(const char ch) {
-		if (ch < 0) return false;
-		return isalpha(ch) || ch == '\'';
+		return WordTokenizer::isWordChar(ch); // as the spell checker splits lines
 	}
 
 	// Redisplay the entire editor window (all text being edited, in white and red) and then
@@ -271,6 +520,8 @@ private:
 	// clear_status_line: If true, this causes the function to clear the status line at
 	// the bottom of the screen.
 	void redisplayTheEditorWindowAndPositionCursor(bool clear_status_line = true) {
+		TRACE_SCOPE(RENDER);
+		ALLOC_SCOPE(GUI);
 
 		// Compute how the screen should have shifted based on the keypress (e.g., pg-up, down-arrow)
 		// This is not as trivial as it seems. For example, a left key-press doesn't always just take
@@ -329,6 +580,21 @@ private:
 		const std::string suggestions = getSuggestionString();
 		TextIO::move(rows_, 0);
 		TextIO::print(suggestions, TextIO::COLOR::RED);
+		// The document's misspelling count goes at the right-hand end, if there is room.
+		const std::string count = getMisspellingCountString();
+		if (!count.empty() && static_cast<int>(suggestions.length() + count.length()) < cols_) {
+			TextIO::move(rows_, cols_ - static_cast<int>(count.length()));
+			TextIO::print(count);
+		}
+	}
+
+	// Start checking every line of the document in the background, if there is a dictionary.
+	void spellCheckDocument() {
+		if (!loaded_dictionary_)
+			return;
+		std::vector<std::string> lines;
+		te_->getLines(0, INT_MAX, lines);
+		document_->start(std::move(lines));
 	}
 
 	// Compute a pattern of spaces and asterisks for the current line indicating where spelling
@@ -337,17 +603,22 @@ private:
 	// For this line:    "Thys is spelt wrong."
 	// Would yield this: "****    *****       " 
 	// This is used by the GUI to hilight misspellings in red.
+	// row: The line's row in the document
 	// line: The input line from the text editor
 	// prob_str: The spaces and asterisks that show the locations of the spelling mistakes.
-	void produceBadPattern(const std::string& line, std::string& prob_str) {
+	void produceBadPattern(int row, const std::string& line, std::string& prob_str) {
 		if (line.empty()) return;
 		// Create a string of all spaces that is the same length of the input line. We start by
 		// assuming all words are spelled correctly.
 		prob_str = std::string(line.length(), kGoodChar);
 		if (loaded_dictionary_) {
 			std::vector<SpellCheck::Position> problems;
-			// Get a list of all problems on the specified line.
-			spell_check_->spellCheckLine(line, problems);
+			// Get a list of all problems on the specified line: from the document's spell check,
+			// unless the line changed since it was last checked.
+			if (!document_->find(row, line, problems)) {
+				spell_check_->spellCheckLine(line, problems);
+				document_->store(row, line, problems);
+			}
 			// Add asterisks to problem spots in the string.
 			for (const auto& p : problems) {
 				for (int i = p.start; i <= p.end; ++i)
@@ -362,7 +633,7 @@ private:
 	// line: The line to output
 	void writeLine(int row, const std::string& line) {
 		std::string prob_str;
-		produceBadPattern(line, prob_str);
+		produceBadPattern(top_ + row, line, prob_str);
 
 		TextIO::move(row, 0);
 		// Determine what to actually print out. Since lines can be very long, we need to compute
@@ -372,6 +643,8 @@ private:
 			print_me = line.substr(left_, cols_);
 			prob_str = prob_str.substr(left_, cols_);
 		}
+		else
+			prob_str.clear(); // the whole line is scrolled off to the left
 		// Pad with spaces as necessary to overwrite other text from before.
 		if (cols_ > print_me.length()) {
 			print_me.insert(print_me.length(), cols_ - print_me.length(), ' ');
@@ -391,6 +664,7 @@ private:
 		TextIO::move(rows_, static_cast<int>(prompt.length()));
 		TextIO::getString(input);
 		clearLine(rows_);
+		recordKey(0, input);
 
 		return !input.empty();
 	}
@@ -458,15 +732,30 @@ private:
 		top_ = left_ = 0;
 	}
 
+	// Append a key (or, with ch == 0, a prompt answer) to the session recording, if any.
+	void recordKey(int ch, const std::string& input = "") {
+		if (!record_.is_open())
+			return;
+		const long long us = (long long)((Trace::nowNs() - record_start_ns_) / 1000);
+		record_ << formatScriptKey({ us, ch, input }) << '\n';
+		record_.flush(); // keep the recording if the editor crashes
+	}
+
 	// Private variables and constants.
 	static const char kGoodChar = ' ', kBadChar = '*';
 	std::string filename_;
 	TextEditor* te_;
 	Undo* undo_;
 	SpellCheck* spell_check_;
+	DocumentSpellCheck* document_;
 	bool loaded_dictionary_;
+	std::vector<std::string> document_dictionaries_; // stacked by useDocumentDictionaries()
+	std::thread loader_; // loading a dictionary, from promptAndLoadDictionary()
+	std::atomic<bool> loader_done_{ false }, loader_loaded_{ false };
 	int top_, left_;
 	int rows_, cols_;
+	std::ofstream record_;
+	uint64_t record_start_ns_ = 0;
 };
 
 #endif // #ifndef _EDITORGUI_H_
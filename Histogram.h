@@ -0,0 +1,90 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+// A log-linear latency histogram: values below 8 ns get their own bucket and every power of two
+// above that is split into 8 buckets, so any recorded value is within 12.5% of its bucket's
+// bounds. Counters are atomics, so several threads can record into one histogram.
+
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+	static const int kSubBits = 3;
+	static const int kSub = 1 << kSubBits;
+	static const int kBuckets = kSub + (64 - kSubBits) * kSub;
+
+	LatencyHistogram() { clear(); }
+
+	void clear() {
+		for (int i = 0; i < kBuckets; i++)
+			counts_[i].store(0, std::memory_order_relaxed);
+		total_.store(0, std::memory_order_relaxed);
+		max_.store(0, std::memory_order_relaxed);
+	}
+
+	void add(uint64_t ns, uint64_t n = 1) {
+		counts_[bucketOf(ns)].fetch_add(n, std::memory_order_relaxed);
+		total_.fetch_add(n, std::memory_order_relaxed);
+		uint64_t m = max_.load(std::memory_order_relaxed);
+		while (ns > m && !max_.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+			;
+	}
+
+	void merge(const LatencyHistogram& other) {
+		for (int i = 0; i < kBuckets; i++) {
+			uint64_t n = other.bucketCount(i);
+			if (n)
+				add(bucketUpper(i), n);
+		}
+	}
+
+	uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+	uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+	uint64_t bucketCount(int i) const { return counts_[i].load(std::memory_order_relaxed); }
+
+	// Upper bound of the bucket holding the pct-th percentile (0 if empty).
+	uint64_t percentile(double pct) const {
+		uint64_t total = count();
+		if (total == 0)
+			return 0;
+		uint64_t rank = (uint64_t)(pct / 100.0 * total + 0.5);
+		if (rank < 1)
+			rank = 1;
+		uint64_t seen = 0;
+		for (int i = 0; i < kBuckets; i++) {
+			seen += bucketCount(i);
+			if (seen >= rank) {
+				uint64_t upper = bucketUpper(i);
+				return upper < max() ? upper : max();
+			}
+		}
+		return max();
+	}
+
+	static int bucketOf(uint64_t v) {
+		if (v < (uint64_t)kSub)
+			return (int)v;
+		int e = 63;
+		while (!(v >> e))
+			e--;
+		int sub = (int)((v >> (e - kSubBits)) & (kSub - 1));
+		return kSub + (e - kSubBits) * kSub + sub;
+	}
+
+	static uint64_t bucketUpper(int i) {
+		if (i < kSub)
+			return (uint64_t)i;
+		int e = (i - kSub) / kSub + kSubBits;
+		uint64_t sub = (uint64_t)((i - kSub) % kSub);
+		uint64_t lower = (1ULL << e) + (sub << (e - kSubBits));
+		return lower + (1ULL << (e - kSubBits)) - 1;
+	}
+
+private:
+	std::atomic<uint64_t> counts_[kBuckets];
+	std::atomic<uint64_t> total_;
+	std::atomic<uint64_t> max_;
+};
+
+#endif // HISTOGRAM_H_
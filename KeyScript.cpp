@@ -0,0 +1,100 @@
+#include "KeyScript.h"
+#include "TextIO.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+namespace {
+	struct NamedKey {
+		const char* name;
+		int key;
+	};
+
+	const NamedKey kNamedKeys[] = {
+		{ "UP", KEY_UP }, { "DOWN", KEY_DOWN }, { "LEFT", KEY_LEFT }, { "RIGHT", KEY_RIGHT },
+		{ "HOME", KEY_HOME }, { "END", KEY_END }, { "PGUP", KEY_PPAGE }, { "PGDN", KEY_NPAGE },
+		{ "DEL", KEY_DC }, { "BS", KEY_BACKSPACE }, { "ENTER", KEY_ENTER },
+		{ "SAVE", CTRL_S }, { "LOAD", CTRL_L }, { "UNDO", CTRL_Z }, { "DICT", CTRL_D }, { "QUIT", CTRL_X },
+		{ "NEXTMISS", CTRL_N }, { "PREVMISS", CTRL_P }, { "ADDWORD", CTRL_A }, { "IGNOREWORD", CTRL_G },
+		{ "COMPLETE", CTRL_W },
+	};
+}
+
+bool parseKeyScriptLine(const std::string& line, std::vector<ScriptKey>& keys) {
+	size_t i = 0;
+	while (i < line.size() && isspace((unsigned char)line[i]))
+		i++;
+	if (i == line.size() || line[i] == '#')
+		return true; // blank line or comment
+	long long time = -1;
+	if (isdigit((unsigned char)line[i])) { // optional timestamp
+		time = 0;
+		while (i < line.size() && isdigit((unsigned char)line[i]))
+			time = time * 10 + (line[i++] - '0');
+		while (i < line.size() && line[i] == ' ')
+			i++;
+	}
+	size_t nameEnd = i;
+	while (nameEnd < line.size() && !isspace((unsigned char)line[nameEnd]))
+		nameEnd++;
+	string name = line.substr(i, nameEnd - i);
+	string arg = nameEnd < line.size() ? line.substr(nameEnd + 1) : ""; // exactly one separator, so TYPE can start with spaces
+	if (!arg.empty() && arg.back() == '\r')
+		arg.pop_back();
+
+	if (name == "TYPE") {
+		for (char ch : arg)
+			keys.push_back({ time, (unsigned char)ch, "" });
+		return true;
+	}
+	if (name == "INPUT") {
+		keys.push_back({ time, 0, arg });
+		return true;
+	}
+	if (name == "CHAR") {
+		int code = atoi(arg.c_str());
+		if (code <= 0)
+			return false;
+		keys.push_back({ time, code, "" });
+		return true;
+	}
+	for (const NamedKey& k : kNamedKeys) {
+		if (name == k.name) {
+			keys.push_back({ time, k.key, "" });
+			return true;
+		}
+	}
+	return false; // unknown key name
+}
+
+bool loadKeyScript(const std::string& file, std::vector<ScriptKey>& keys) {
+	ifstream infile(file);
+	if (!infile)
+		return false;
+	string line;
+	while (getline(infile, line)) {
+		if (!parseKeyScriptLine(line, keys))
+			return false;
+	}
+	return true;
+}
+
+std::string formatScriptKey(const ScriptKey& key) {
+	string out;
+	if (key.timeUs >= 0)
+		out = to_string(key.timeUs) + " ";
+	if (key.key == 0)
+		return out + "INPUT " + key.input;
+	for (const NamedKey& k : kNamedKeys) {
+		if (key.key == k.key)
+			return out + k.name;
+	}
+	if (key.key > ' ' && key.key < 127)
+		return out + "TYPE " + string(1, (char)key.key);
+	return out + "CHAR " + to_string(key.key);
+}
@@ -0,0 +1,35 @@
+#ifndef KEYSCRIPT_H_
+#define KEYSCRIPT_H_
+
+// Key scripts drive the editor without a terminal (see tools/headless.cpp). A script is a text
+// file with one entry per line:
+//
+//     [time_us] NAME          a named key: UP DOWN LEFT RIGHT HOME END PGUP PGDN DEL BS ENTER
+//                             SAVE LOAD UNDO DICT QUIT NEXTMISS PREVMISS
+//                             ADDWORD IGNOREWORD COMPLETE
+//     [time_us] CHAR code     a single key by character code, e.g. CHAR 9 for tab
+//     [time_us] TYPE text     every character of text (up to the end of the line) in turn
+//     [time_us] INPUT text    the answer to a prompt (filename, "Quit [y/N]", ...) raised by
+//                             the key before it
+//
+// Blank lines and lines starting with '#' are ignored, except that recordings note the files the
+// session started with as "# file path" and "# dictionary path". The optional leading time is the
+// microsecond offset from the start of the session at which the key was pressed.
+
+#include <string>
+#include <vector>
+
+struct ScriptKey {
+	long long timeUs; // -1 if the script has no timestamp for this key
+	int key;          // 0 for an INPUT entry
+	std::string input;
+};
+
+// Read a key script. Returns false if the file cannot be opened or a line cannot be parsed.
+bool loadKeyScript(const std::string& file, std::vector<ScriptKey>& keys);
+// Parse one script line, appending the keys it produces.
+bool parseKeyScriptLine(const std::string& line, std::vector<ScriptKey>& keys);
+// Format a key as a script line (without the trailing newline).
+std::string formatScriptKey(const ScriptKey& key);
+
+#endif // KEYSCRIPT_H_
@@ -0,0 +1,113 @@
+#include "LevenshteinAutomaton.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+LevenshteinAutomaton::LevenshteinAutomaton(const std::string& word, int maxDistance)
+	: wordClass_(word.size()), classes_(1), n_(word.size()),
+	cap_((uint8_t)(min(max(maxDistance, -1), 254) + 1)), stride_(n_ + 1 + (n_ > 1 ? n_ - 1 : 0)) {
+	fill(classOf_, classOf_ + Lexicon::kSymbols, 0);
+	for (size_t j = 0; j < n_; j++) {
+		int symbol = Lexicon::symbolOf(word[j]);
+		if (symbol < 0) {
+			wordClass_[j] = -1; // matches nothing in the lexicon
+			continue;
+		}
+		if (classOf_[symbol] == 0)
+			classOf_[symbol] = classes_++;
+		wordClass_[j] = classOf_[symbol];
+	}
+	vector<uint8_t> cells(stride_, cap_);
+	intern(cells); // kDead
+	for (size_t j = 0; j <= n_; j++)
+		cells[j] = (uint8_t)min<size_t>(j, cap_); // the empty prefix is j deletions from word[0, j)
+	intern(cells); // start()
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::intern(const std::vector<uint8_t>& cells) {
+	string key(cells.begin(), cells.end());
+	unordered_map<string, State>::iterator found = ids_.find(key);
+	if (found != ids_.end())
+		return found->second;
+	State s = (State)distance_.size();
+	ids_.emplace(move(key), s);
+	cells_.insert(cells_.end(), cells.begin(), cells.end());
+	next_.resize(next_.size() + classes_, -1);
+	distance_.push_back(cells[n_]);
+	minDistance_.push_back(*min_element(cells.begin(), cells.begin() + n_ + 1));
+	return s;
+}
+
+LevenshteinAutomaton::State LevenshteinAutomaton::step(State s, int symbol) {
+	int c = classOf_[symbol];
+	int32_t& cached = next_[s * classes_ + c];
+	if (cached >= 0)
+		return (State)cached;
+	// One row of the restricted Damerau-Levenshtein matrix, as in suggestByTrieWalk(), with
+	// the row two back folded into the transposition entries.
+	const uint8_t* row = &cells_[s * stride_];
+	const uint8_t* swaps = row + n_ + 1;
+	scratch_.assign(stride_, cap_);
+	uint8_t* next = scratch_.data();
+	next[0] = (uint8_t)min(row[0] + 1, (int)cap_);
+	for (size_t j = 1; j <= n_; j++) {
+		int v = min(min(row[j], next[j - 1]) + 1, row[j - 1] + (wordClass_[j - 1] == c ? 0 : 1));
+		if (j >= 2 && wordClass_[j - 2] == c)
+			v = min(v, (int)swaps[j - 2]);
+		next[j] = (uint8_t)min(v, (int)cap_);
+	}
+	// A pending swap of word[j] and word[j + 1]: this letter was word[j + 1], the next must be word[j].
+	for (size_t j = 0; j + 1 < n_; j++) {
+		if (wordClass_[j + 1] == c)
+			next[n_ + 1 + j] = (uint8_t)min(row[j] + 1, (int)cap_);
+	}
+	bool dead = *min_element(next, next + n_ + 1) >= cap_;
+	State t = dead ? kDead : intern(scratch_);
+	next_[s * classes_ + c] = (int32_t)t; // intern() may have moved next_
+	return t;
+}
+
+namespace {
+	class AutomatonWalk {
+	public:
+		AutomatonWalk(const Lexicon& lexicon, LevenshteinAutomaton& automaton, SuggestionList& results)
+			: lexicon_(lexicon), automaton_(automaton), results_(results) {
+		}
+
+		void visit(Lexicon::Node node, LevenshteinAutomaton::State state) {
+			Lexicon::Edge edges[Lexicon::kSymbols];
+			int count = lexicon_.children(node, edges);
+			for (int e = 0; e < count; e++) {
+				LevenshteinAutomaton::State next = automaton_.step(state, edges[e].symbol);
+				if (next == LevenshteinAutomaton::kDead || automaton_.minDistance(next) > results_.bound())
+					continue;
+				prefix_.push_back(Lexicon::charOf(edges[e].symbol));
+				if (automaton_.distance(next) <= results_.bound() && lexicon_.isWord(edges[e].target))
+					results_.offer(prefix_.data(), prefix_.size(), automaton_.distance(next));
+				visit(edges[e].target, next);
+				prefix_.pop_back();
+			}
+		}
+
+	private:
+		const Lexicon& lexicon_;
+		LevenshteinAutomaton& automaton_;
+		SuggestionList& results_;
+		string prefix_;
+	};
+}
+
+void suggestByAutomaton(const Lexicon& lexicon, const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies) {
+	SuggestionList results(maxDistance, maxResults, frequencies);
+	if (results.bound() < 0)
+		return;
+	LevenshteinAutomaton automaton(word, maxDistance);
+	if (automaton.distance(automaton.start()) <= results.bound() && lexicon.isWord(lexicon.root()))
+		results.offer("", 0, automaton.distance(automaton.start()));
+	AutomatonWalk walk(lexicon, automaton, results);
+	walk.visit(lexicon.root(), automaton.start());
+	results.take(out);
+}
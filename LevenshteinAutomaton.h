@@ -0,0 +1,59 @@
+#ifndef LEVENSHTEINAUTOMATON_H_
+#define LEVENSHTEINAUTOMATON_H_
+
+// A deterministic automaton accepting exactly the strings within maxDistance restricted
+// Damerau-Levenshtein edits of one word (Schulz and Mihov, "Fast string correction with
+// Levenshtein automata"). A state is the band of the edit-distance matrix that a prefix leaves
+// behind: for each prefix of the word, how many edits it takes to reach it (capped at
+// maxDistance + 1), plus the pending transpositions. Prefixes that leave the same band behave
+// the same from then on, so they share a state, and a transition depends only on which
+// positions of the word the next letter matches, so letters absent from the word share one.
+//
+// States and transitions are built lazily, the first time a search asks for them, so a query
+// never pays for the parts of the automaton the dictionary doesn't reach.
+
+#include "Lexicon.h"
+#include "Suggest.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class LevenshteinAutomaton {
+public:
+	typedef uint32_t State;
+	static const State kDead = 0; // no continuation is within maxDistance
+
+	LevenshteinAutomaton(const std::string& word, int maxDistance);
+
+	State start() const { return 1; }
+	// The state after reading Lexicon symbol from s.
+	State step(State s, int symbol);
+	// Edits between the word and the string that led to s, or maxDistance + 1 if more.
+	int distance(State s) const { return distance_[s]; }
+	// The fewest edits any extension of the string that led to s can be from the word.
+	int minDistance(State s) const { return minDistance_[s]; }
+	size_t stateCount() const { return distance_.size(); }
+
+private:
+	State intern(const std::vector<uint8_t>& cells);
+
+	std::vector<int> wordClass_; // class of each letter of the word, -1 for non-symbols
+	int classOf_[Lexicon::kSymbols]; // 0 for symbols not in the word
+	int classes_;
+	size_t n_;
+	uint8_t cap_; // maxDistance + 1
+	std::vector<uint8_t> cells_; // per state: n + 1 row entries, then n - 1 transposition entries
+	size_t stride_;
+	std::vector<int32_t> next_; // per state and class, -1 until computed
+	std::vector<uint8_t> distance_, minDistance_;
+	std::unordered_map<std::string, State> ids_;
+	std::vector<uint8_t> scratch_;
+};
+
+// The best maxResults dictionary words within maxDistance edits of word, found by walking the
+// lexicon and the word's automaton together; a lexicon subtree is skipped as soon as the
+// automaton dies on its prefix. Same results and order as suggestByTrieWalk().
+void suggestByAutomaton(const Lexicon& lexicon, const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies = nullptr);
+
+#endif // LEVENSHTEINAUTOMATON_H_
@@ -0,0 +1,26 @@
+#include "Lexicon.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void Lexicon::collectWords(std::string& text, std::vector<uint32_t>& offsets) const {
+	text.clear();
+	offsets.assign(1, 0);
+	string prefix;
+	collectWords(root(), prefix, text, offsets);
+}
+
+void Lexicon::collectWords(Node node, std::string& prefix, std::string& text, std::vector<uint32_t>& offsets) const {
+	if (isWord(node)) {
+		text += prefix;
+		offsets.push_back((uint32_t)text.size());
+	}
+	Edge edges[kSymbols];
+	int count = children(node, edges);
+	for (int e = 0; e < count; e++) {
+		prefix.push_back(charOf(edges[e].symbol));
+		collectWords(edges[e].target, prefix, text, offsets);
+		prefix.pop_back();
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef LEXICON_H_
+#define LEXICON_H_
+
+// A read-only set of dictionary words over the alphabet a-z plus apostrophe, exposed as an
+// automaton so that lookups and suggestion searches can walk it one symbol at a time.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LexiconDetail {
+	constexpr std::array<int8_t, 256> makeFoldedSymbols() {
+		std::array<int8_t, 256> table = {};
+		for (int ch = 0; ch < 256; ch++)
+			table[ch] = -1;
+		for (int i = 0; i < 26; i++)
+			table['a' + i] = table['A' + i] = (int8_t)i;
+		table['\''] = 26;
+		return table;
+	}
+}
+
+class Lexicon {
+public:
+	typedef uint32_t Node;
+	static const int kSymbols = 27; // 'a'..'z' are 0..25, apostrophe is 26
+
+	struct Edge {
+		int symbol;
+		Node target;
+	};
+
+	Lexicon() { }
+	virtual ~Lexicon() { }
+
+	virtual Node root() const = 0;
+	// Follow node's edge labelled symbol into next. Returns false if there is none.
+	virtual bool child(Node node, int symbol, Node& next) const = 0;
+	// Fill edges (room for kSymbols) with node's edges in symbol order and return how many.
+	virtual int children(Node node, Edge* edges) const = 0;
+	// Whether the path from the root to node spells a word.
+	virtual bool isWord(Node node) const = 0;
+
+	// Every word, depth first and so in symbol order: word i is text[offsets[i], offsets[i + 1]).
+	void collectWords(std::string& text, std::vector<uint32_t>& offsets) const;
+
+	virtual size_t nodeCount() const = 0;
+	virtual size_t bytes() const = 0; // memory held by the structure
+
+	// Whether the word, its letters in either case, is in the set.
+	virtual bool contains(const char* word, size_t length) const {
+		Node node = root();
+		for (size_t i = 0; i < length; i++) {
+			int symbol = foldedSymbolOf(word[i]);
+			if (symbol < 0 || !child(node, symbol, node))
+				return false;
+		}
+		return isWord(node);
+	}
+
+	static int symbolOf(char ch) {
+		if (ch >= 'a' && ch <= 'z')
+			return ch - 'a';
+		return ch == '\'' ? 26 : -1;
+	}
+	static char charOf(int symbol) { return symbol == 26 ? '\'' : (char)('a' + symbol); }
+	// symbolOf() for uppercase letters as well, by table, so lookups needn't lowercase a copy.
+	static int foldedSymbolOf(char ch) { return kFoldedSymbols[(unsigned char)ch]; }
+	// A 64-bit hash of word with its letters in lowercase, for the filters and hash sets kept
+	// beside a lexicon. Returns false if word holds a character no dictionary word can.
+	static bool foldedHash(const char* word, size_t length, uint64_t& hash) {
+		uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a, then a finalizer
+		for (size_t i = 0; i < length; i++) {
+			if (foldedSymbolOf(word[i]) < 0)
+				return false;
+			h = (h ^ (unsigned char)(word[i] | 0x20)) * 0x100000001b3ULL; // lowercases letters, keeps '\''
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		hash = h ^ (h >> 33);
+		return true;
+	}
+
+private:
+	void collectWords(Node node, std::string& prefix, std::string& text, std::vector<uint32_t>& offsets) const;
+
+	static constexpr std::array<int8_t, 256> kFoldedSymbols = LexiconDetail::makeFoldedSymbols();
+};
+
+#endif // LEXICON_H_
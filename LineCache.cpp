@@ -0,0 +1,130 @@
+#include "LineCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+LineCache::LineCache(size_t capacity) : sets_(0), generation_(1), changes_(0), clock_(0), stats_() {
+	resize(capacity);
+}
+
+void LineCache::resize(size_t capacity) {
+	lock_guard<mutex> lock(mutex_);
+	size_t sets = 0;
+	if (capacity > 0) {
+		sets = 1;
+		while (sets * kWays < capacity)
+			sets *= 2;
+	}
+	vector<Entry>(sets * kWays).swap(entries_);
+	sets_ = sets;
+}
+
+uint64_t LineCache::hash(const std::string& line) {
+	// Eight bytes per multiply, then the tail; good enough to spread lines over the sets, and a
+	// hit is confirmed by comparing the text anyway.
+	const uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+	uint64_t h = line.size() * kMul;
+	const char* p = line.data();
+	size_t n = line.size();
+	for (; n >= 8; p += 8, n -= 8) {
+		uint64_t w;
+		memcpy(&w, p, 8);
+		h = (h ^ w) * kMul;
+		h ^= h >> 29;
+	}
+	if (n > 0) {
+		uint64_t w = 0;
+		memcpy(&w, p, n);
+		h = (h ^ w) * kMul;
+	}
+	return h ^ (h >> 32);
+}
+
+bool LineCache::find(const std::string& line, uint64_t hash, std::vector<SpellCheck::Position>& problems,
+	uint64_t& stamp) {
+	lock_guard<mutex> lock(mutex_);
+	stamp = changes_;
+	if (sets_ == 0)
+		return false;
+	Entry* set = &entries_[(hash & (sets_ - 1)) * kWays];
+	for (size_t w = 0; w < kWays; w++) {
+		Entry& e = set[w];
+		if (e.generation == generation_ && e.hash == hash && e.line == line) {
+			problems.insert(problems.end(), e.problems.begin(), e.problems.end());
+			e.lastUse = ++clock_;
+			stats_.hits++;
+			return true;
+		}
+	}
+	stats_.misses++;
+	return false;
+}
+
+void LineCache::insert(const std::string& line, uint64_t hash, uint64_t stamp,
+	const std::vector<SpellCheck::Position>& problems) {
+	lock_guard<mutex> lock(mutex_);
+	if (sets_ == 0 || stamp != changes_)
+		return; // perhaps checked against what was there before the change
+	Entry* set = &entries_[(hash & (sets_ - 1)) * kWays];
+	// The same line (another thread got there first), else a free or stale way, else the least
+	// recently used one.
+	Entry* victim = nullptr;
+	for (size_t w = 0; w < kWays && victim == nullptr; w++) {
+		if (set[w].generation == generation_ && set[w].hash == hash && set[w].line == line)
+			victim = &set[w];
+	}
+	for (size_t w = 0; w < kWays && victim == nullptr; w++) {
+		if (set[w].generation != generation_)
+			victim = &set[w];
+	}
+	if (victim == nullptr) {
+		victim = &set[0];
+		for (size_t w = 1; w < kWays; w++) {
+			if (set[w].lastUse < victim->lastUse)
+				victim = &set[w];
+		}
+		stats_.evictions++;
+	}
+	victim->hash = hash;
+	victim->generation = generation_;
+	victim->lastUse = ++clock_;
+	victim->line.assign(line); // reuses the entry's buffers
+	victim->problems.assign(problems.begin(), problems.end());
+}
+
+void LineCache::invalidate() {
+	lock_guard<mutex> lock(mutex_);
+	generation_++;
+	changes_++;
+}
+
+void LineCache::forgetWord(const std::string& word) {
+	lock_guard<mutex> lock(mutex_);
+	changes_++;
+	for (Entry& e : entries_) {
+		if (e.generation != generation_)
+			continue;
+		for (const SpellCheck::Position& p : e.problems) {
+			size_t length = p.end - p.start + 1;
+			if (length == word.size() && equal(word.begin(), word.end(), e.line.begin() + p.start,
+				[](char a, char b) { return tolower((unsigned char)a) == tolower((unsigned char)b); })) {
+				e.generation = 0; // never current
+				break;
+			}
+		}
+	}
+}
+
+LineCache::Stats LineCache::stats() const {
+	lock_guard<mutex> lock(mutex_);
+	return stats_;
+}
+
+void LineCache::resetStats() {
+	lock_guard<mutex> lock(mutex_);
+	stats_ = Stats();
+}
@@ -0,0 +1,76 @@
+#ifndef LINECACHE_H_
+#define LINECACHE_H_
+
+// Memoized spellCheckLine() answers: the misspelled spans of a line of text. The GUI checks
+// every visible row on every redraw, so while the cursor moves or the view scrolls almost all
+// of them are lines it checked a moment ago.
+//
+// A line is found by a 64-bit hash of its content and then compared in full, so an unchanged
+// line costs one pass of hashing and one of comparing instead of tokenizing it and looking up
+// each word. The cache is 4-way set associative with least-recently-used replacement within a
+// set, and every entry carries the generation of the dictionary it was checked against:
+// invalidate() bumps the generation, so a dictionary change costs O(1). Lookups and inserts
+// take a mutex; either holds it for about as long as copying the spans takes.
+//
+// A miss hands out a stamp that the answer is inserted with: if invalidate() or forgetWord() has
+// run in between, the line was perhaps checked before the change, and the answer is dropped.
+
+#include "SpellCheck.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class LineCache {
+public:
+	static const size_t kDefaultCapacity = 256; // a few screens' worth of rows
+	static const size_t kWays = 4;
+
+	struct Stats {
+		uint64_t hits; // spellCheckLine() calls answered without checking the line
+		uint64_t misses;
+		uint64_t evictions; // live entries replaced to make room
+	};
+
+	explicit LineCache(size_t capacity = kDefaultCapacity);
+
+	static uint64_t hash(const std::string& line);
+	// On a hit, appends the line's problems to problems; on a miss, sets stamp for insert().
+	bool find(const std::string& line, uint64_t hash, std::vector<SpellCheck::Position>& problems,
+		uint64_t& stamp);
+	void insert(const std::string& line, uint64_t hash, uint64_t stamp,
+		const std::vector<SpellCheck::Position>& problems);
+	// Forget every entry, e.g. because the dictionary changed.
+	void invalidate();
+	// Forget the lines on which word (in any case) was misspelled, because it no longer is.
+	void forgetWord(const std::string& word);
+
+	// Drop everything and hold up to capacity lines (0 turns the cache off).
+	void resize(size_t capacity);
+	size_t capacity() const { return sets_ * kWays; }
+
+	Stats stats() const;
+	void resetStats();
+
+private:
+	struct Entry {
+		uint64_t hash = 0;
+		uint64_t generation = 0; // 0 for an empty way
+		uint64_t lastUse = 0;
+		std::string line;
+		std::vector<SpellCheck::Position> problems;
+	};
+
+	LineCache(const LineCache&) = delete;
+	LineCache& operator=(const LineCache&) = delete;
+
+	std::vector<Entry> entries_; // sets_ * kWays
+	size_t sets_; // a power of two
+	uint64_t generation_; // starts at 1
+	uint64_t changes_; // invalidate() and forgetWord() calls so far
+	uint64_t clock_;
+	Stats stats_;
+	mutable std::mutex mutex_;
+};
+
+#endif // LINECACHE_H_
@@ -0,0 +1,156 @@
+#include "PerfectHashSet.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const size_t kWordsPerBucket = 4;
+	const uint32_t kMaxSeed = 1u << 24; // tries per bucket before giving up
+
+	size_t bucketOf(uint64_t hash, size_t bucketCount) {
+		return (size_t)(((hash >> 32) * (uint64_t)bucketCount) >> 32);
+	}
+
+	// The word's slot under seed: its two 32-bit halves of a second hash combined by the seed and
+	// mixed (murmur3's finalizer), then scaled to the slot count.
+	size_t slotOf(uint64_t hash, uint32_t seed, size_t slotCount) {
+		uint64_t g = hash * 0x9e3779b97f4a7c15ULL;
+		uint32_t x = (uint32_t)g + seed * ((uint32_t)(g >> 32) | 1);
+		x ^= x >> 16;
+		x *= 0x85ebca6bu;
+		x ^= x >> 13;
+		x *= 0xc2b2ae35u;
+		x ^= x >> 16;
+		return (size_t)(((uint64_t)x * slotCount) >> 32);
+	}
+}
+
+PerfectHashSet::PerfectHashSet() {
+	clear();
+}
+
+void PerfectHashSet::clear() {
+	seedStore_ = vector<uint32_t>();
+	offsetStore_.assign(1, 0);
+	offsetStore_.shrink_to_fit();
+	textStore_ = string();
+	seeds_ = seedStore_.data();
+	bucketCount_ = 0;
+	offsets_ = offsetStore_.data();
+	wordCount_ = 0;
+	text_ = textStore_.data();
+	textSize_ = 0;
+}
+
+bool PerfectHashSet::build(const Lexicon& lexicon) {
+	clear();
+	string text;
+	vector<uint32_t> offsets;
+	lexicon.collectWords(text, offsets);
+	size_t words = offsets.size() - 1;
+	if (words == 0)
+		return true;
+	size_t bucketCount = (words + kWordsPerBucket - 1) / kWordsPerBucket;
+	vector<uint64_t> hashes(words);
+	vector<vector<uint32_t>> buckets(bucketCount);
+	for (size_t w = 0; w < words; w++) {
+		Lexicon::foldedHash(&text[offsets[w]], offsets[w + 1] - offsets[w], hashes[w]);
+		buckets[bucketOf(hashes[w], bucketCount)].push_back((uint32_t)w);
+	}
+	// Place the biggest buckets first, while most slots are free.
+	vector<uint32_t> order(bucketCount);
+	for (size_t b = 0; b < bucketCount; b++)
+		order[b] = (uint32_t)b;
+	stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+	vector<uint32_t> seeds(bucketCount, 0);
+	vector<uint32_t> slotWord(words, UINT32_MAX);
+	vector<size_t> slots;
+	for (uint32_t b : order) {
+		if (buckets[b].empty())
+			break;
+		uint32_t seed = 0;
+		for (;; seed++) {
+			if (seed == kMaxSeed)
+				return false;
+			slots.clear();
+			bool free = true;
+			for (uint32_t w : buckets[b]) {
+				size_t slot = slotOf(hashes[w], seed, words);
+				if (slotWord[slot] != UINT32_MAX || find(slots.begin(), slots.end(), slot) != slots.end()) {
+					free = false;
+					break;
+				}
+				slots.push_back(slot);
+			}
+			if (free)
+				break;
+		}
+		seeds[b] = seed;
+		for (size_t i = 0; i < slots.size(); i++)
+			slotWord[slots[i]] = buckets[b][i];
+	}
+	string slotText;
+	slotText.reserve(text.size());
+	vector<uint32_t> slotOffsets(1, 0);
+	slotOffsets.reserve(words + 1);
+	for (size_t slot = 0; slot < words; slot++) {
+		uint32_t w = slotWord[slot];
+		slotText.append(text, offsets[w], offsets[w + 1] - offsets[w]);
+		slotOffsets.push_back((uint32_t)slotText.size());
+	}
+	seedStore_.swap(seeds);
+	offsetStore_.swap(slotOffsets);
+	textStore_.swap(slotText);
+	seeds_ = seedStore_.data();
+	bucketCount_ = bucketCount;
+	offsets_ = offsetStore_.data();
+	wordCount_ = words;
+	text_ = textStore_.data();
+	textSize_ = textStore_.size();
+	return true;
+}
+
+bool PerfectHashSet::contains(const char* word, size_t length) const {
+	uint64_t h;
+	if (wordCount_ == 0 || !Lexicon::foldedHash(word, length, h))
+		return false;
+	size_t slot = slotOf(h, seeds_[bucketOf(h, bucketCount_)], wordCount_);
+	uint32_t begin = offsets_[slot], end = offsets_[slot + 1];
+	if (end - begin != length || end > textSize_)
+		return false;
+	const char* stored = text_ + begin;
+	for (size_t i = 0; i < length; i++) {
+		if ((char)(word[i] | 0x20) != stored[i]) // word holds only letters and apostrophes
+			return false;
+	}
+	return true;
+}
+
+PerfectHashSet::Arrays PerfectHashSet::arrays() const {
+	return { seeds_, bucketCount_, offsets_, wordCount_, text_, textSize_ };
+}
+
+bool PerfectHashSet::attach(const Arrays& a) {
+	if (a.wordCount == 0 || a.bucketCount != (a.wordCount + kWordsPerBucket - 1) / kWordsPerBucket ||
+		a.offsets[0] != 0 || a.offsets[a.wordCount] != a.textSize)
+		return false;
+	seedStore_ = vector<uint32_t>();
+	offsetStore_ = vector<uint32_t>();
+	textStore_ = string();
+	seeds_ = a.seeds;
+	bucketCount_ = a.bucketCount;
+	offsets_ = a.offsets;
+	wordCount_ = a.wordCount;
+	text_ = a.text;
+	textSize_ = a.textSize;
+	return true;
+}
+
+size_t PerfectHashSet::bytes() const {
+	if (wordCount_ == 0)
+		return 0;
+	return bucketCount_ * sizeof(uint32_t) + (wordCount_ + 1) * sizeof(uint32_t) + textSize_;
+}
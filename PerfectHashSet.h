@@ -0,0 +1,65 @@
+#ifndef PERFECTHASHSET_H_
+#define PERFECTHASHSET_H_
+
+// The dictionary's words under a minimal perfect hash (hash and displace): words are hashed into
+// buckets of about four, and each bucket stores the seed that sends its words to slots no other
+// word has, so n words fill exactly n slots. A lookup is one hash, one seed, one slot and one
+// comparison with the word stored there, whatever the word's length, where a trie walk reads a
+// node per letter. It answers membership only; the lexicon stays for suggestions.
+//
+// Storage is flat arrays, so a compiled dictionary can carry the set and attach() can use it in
+// place:
+//
+//     seeds    bucketCount 32-bit seeds
+//     offsets  wordCount + 1 offsets into text, one per slot
+//     text     the words, concatenated in slot order
+
+#include "Lexicon.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class PerfectHashSet {
+public:
+	struct Arrays {
+		const uint32_t* seeds;
+		size_t bucketCount;
+		const uint32_t* offsets;
+		size_t wordCount;
+		const char* text;
+		size_t textSize;
+	};
+
+	PerfectHashSet();
+
+	// Returns false, leaving the set empty, if some bucket's words can't be placed (two words
+	// with the same 64-bit hash).
+	bool build(const Lexicon& lexicon);
+	void clear();
+	bool empty() const { return wordCount_ == 0; }
+
+	// Whether word, its letters in either case, is in the set.
+	bool contains(const char* word, size_t length) const;
+
+	Arrays arrays() const;
+	// Use arrays saved from another set without copying them; they must outlive this object.
+	// Returns false, leaving the set unchanged, if their sizes don't fit together.
+	bool attach(const Arrays& arrays);
+	size_t bytes() const;
+
+private:
+	PerfectHashSet(const PerfectHashSet&) = delete;
+	PerfectHashSet& operator=(const PerfectHashSet&) = delete;
+
+	const uint32_t* seeds_;
+	size_t bucketCount_;
+	const uint32_t* offsets_;
+	size_t wordCount_;
+	const char* text_;
+	size_t textSize_;
+	std::vector<uint32_t> seedStore_; // the arrays, unless attached
+	std::vector<uint32_t> offsetStore_;
+	std::string textStore_;
+};
+
+#endif // PERFECTHASHSET_H_
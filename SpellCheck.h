@@ -17,6 +17,45 @@ public:
 	virtual bool load(std::string dictionaryFile) = 0;
 	virtual bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string>& suggestions) = 0;
 	virtual void spellCheckLine(const std::string& line, std::vector<Position>& problems) = 0;
+	// Check count lines at once. problems is replaced by those of every line, in order, and offsets
+	// by count + 1 indices into it: line i's problems are problems[offsets[i]] up to, not including,
+	// problems[offsets[i + 1]].
+	virtual void spellCheckLines(const std::string* lines, size_t count, std::vector<Position>& problems,
+		std::vector<size_t>& offsets) {
+		problems.clear();
+		offsets.assign(1, 0);
+		for (size_t i = 0; i < count; i++) {
+			spellCheckLine(lines[i], problems);
+			offsets.push_back(problems.size());
+		}
+	}
+
+	// Words accepted on top of the loaded dictionary, which a new dictionary doesn't replace:
+	// loadUserDictionary() reads them from file (which need not exist yet) and addWord() appends
+	// to it, while ignoreWord() accepts a word for this session only. Spell checkers without a
+	// user dictionary return false.
+	virtual bool loadUserDictionary(const std::string& /*file*/) { return false; }
+	virtual bool addWord(const std::string& /*word*/) { return false; }
+	virtual bool ignoreWord(const std::string& /*word*/) { return false; }
+
+	// Dictionaries stacked on the loaded one, e.g. a document's jargon: a word in any of them is
+	// correct, and suggestions from one of higher priority come first. Spell checkers that keep one
+	// dictionary return false.
+	virtual bool addDictionary(const std::string& /*file*/, int /*priority*/) { return false; }
+	virtual bool removeDictionary(const std::string& /*file*/) { return false; }
+
+	// Up to maxResults dictionary words that begin with prefix, most common first if ranked and the
+	// spell checker knows how common words are, otherwise shortest first. Spell checkers that can't
+	// complete words give none.
+	virtual void complete(const std::string& /*prefix*/, size_t /*maxResults*/, std::vector<std::string>& completions,
+		bool /*ranked*/ = true) const {
+		completions.clear();
+	}
+
+	// Whether load() may run on a thread of its own while other threads go on checking against the
+	// dictionary it replaces, and how far (in percent) a load that is running has got.
+	virtual bool loadsConcurrently() const { return false; }
+	virtual int loadProgress() const { return 100; }
 
 private:
 
@@ -1,104 +1,734 @@
 #include "StudentSpellCheck.h"
+#include "Trace.h"
+#include "AllocTrack.h"
+#include "Suggest.h"
+#include "LevenshteinAutomaton.h"
+#include "WordTokenizer.h"
 #include <string>
 #include <vector>
 #include <iostream>
 #include <stdio.h>
 #include <ctype.h>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <thread>
 
 using namespace std;
 
+namespace {
+	// The .aff file that goes with dicFile, or "" if dicFile isn't the .dic half of a pair.
+	string affixFileOf(const string& dicFile) {
+		if (dicFile.size() < 4 || dicFile.compare(dicFile.size() - 4, 4, ".dic") != 0)
+			return "";
+		string affFile = dicFile.substr(0, dicFile.size() - 4) + ".aff";
+		error_code error;
+		return filesystem::is_regular_file(affFile, error) ? affFile : "";
+	}
+}
+
 SpellCheck* createSpellCheck()
 {
+	ALLOC_SCOPE(SPELL_CHECK);
 	return new StudentSpellCheck;
 }
 
+StudentSpellCheck::StudentSpellCheck(Backend backend) : backend_(backend) {
+	shared_ptr<Stack> stack = make_shared<Stack>();
+	stack->layers.push_back({ make_shared<Dictionary>(backend), "", 0, true });
+	stack_ = move(stack);
+}
+
 StudentSpellCheck::~StudentSpellCheck() {
-	// TODO
+	// the dictionary structures and any mapped file release themselves
+}
+
+StudentSpellCheck::Dictionary::Dictionary(Backend backend) {
+	active = backend == DAWG ? (const Lexicon*)&dawg : backend == DOUBLE_ARRAY ? (const Lexicon*)&doubleArray : &trie;
 }
 
 bool StudentSpellCheck::load(std::string dictionaryFile) {
-	root->free(root);
-	ifstream infile(dictionaryFile);
-	if (!infile)
+	ALLOC_SCOPE(SPELL_CHECK);
+	TRACE_SCOPE(LOAD);
+	lock_guard<mutex> lock(loadMutex_);
+	loadProgress_ = 0;
+	shared_ptr<const Dictionary> base = loadDictionary(dictionaryFile);
+	if (base) {
+		vector<Layer> layers = stack()->layers;
+		for (Layer& layer : layers) {
+			if (layer.base)
+				layer = { base, dictionaryFile, 0, true };
+		}
+		shared_ptr<const WordFrequencies> ranks;
+		if (!base->frequencies.empty())
+			ranks = shared_ptr<const WordFrequencies>(base, &base->frequencies); // keeps the file mapped
+		atomic_store(&frequencies_, move(ranks));
+		publish(move(layers));
+	}
+	loadProgress_ = 100;
+	return base != nullptr;
+}
+
+bool StudentSpellCheck::addDictionary(const std::string& file, int priority) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	TRACE_SCOPE(LOAD);
+	lock_guard<mutex> lock(loadMutex_);
+	loadProgress_ = 0;
+	shared_ptr<const Dictionary> added = loadDictionary(file);
+	if (added) {
+		vector<Layer> layers = stack()->layers;
+		layers.push_back({ added, file, priority, false });
+		publish(move(layers));
+	}
+	loadProgress_ = 100;
+	return added != nullptr;
+}
+
+bool StudentSpellCheck::removeDictionary(const std::string& file) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	lock_guard<mutex> lock(loadMutex_);
+	vector<Layer> layers = stack()->layers;
+	for (size_t i = 0; i < layers.size(); i++) {
+		if (!layers[i].base && layers[i].file == file) {
+			layers.erase(layers.begin() + i);
+			publish(move(layers));
+			return true;
+		}
+	}
+	return false;
+}
+
+// Make layers the dictionaries in use, with a prefilter over them if there are several. Checks
+// that took hold of the old stack before the swap may still cache answers from it, so once they
+// have all let go (RCU's grace period) the caches are forgotten, and any dictionary no longer used
+// is freed here rather than on a thread that is checking.
+void StudentSpellCheck::publish(std::vector<Layer> layers) {
+	shared_ptr<Stack> next = make_shared<Stack>();
+	stable_sort(layers.begin(), layers.end(), [](const Layer& a, const Layer& b) { return a.priority > b.priority; });
+	next->layers = move(layers);
+	if (next->layers.size() > 1) {
+		vector<const Lexicon*> lexicons;
+		bool affixed = false; // a filter of the stems would turn their forms away
+		for (const Layer& layer : next->layers) {
+			lexicons.push_back(&layer.dictionary->lexicon());
+			next->lookups.push_back(layer.dictionary.get());
+			affixed = affixed || !layer.dictionary->affixes.empty();
+		}
+		if (!affixed)
+			next->prefilter.build(lexicons);
+		stable_sort(next->lookups.begin(), next->lookups.end(), [](const Dictionary* a, const Dictionary* b) {
+			return a->lexicon().nodeCount() > b->lexicon().nodeCount(); });
+	}
+	shared_ptr<const Stack> old = atomic_exchange(&stack_, shared_ptr<const Stack>(move(next)));
+	while (old.use_count() > 1)
+		this_thread::sleep_for(chrono::microseconds(200));
+	cache_.invalidate();
+	lines_.invalidate();
+}
+
+// The dictionary in file: another StudentSpellCheck's, if sharing is on and one has the same file
+// loaded with the same settings, or else a new one. nullptr if file can't be loaded.
+std::shared_ptr<const StudentSpellCheck::Dictionary> StudentSpellCheck::loadDictionary(const std::string& file) {
+	static mutex sharedMutex;
+	static map<string, weak_ptr<const Dictionary>> shared; // by sharingKey()
+	string key;
+	if (shareDictionaries_) {
+		key = sharingKey(file);
+		lock_guard<mutex> lock(sharedMutex);
+		auto found = shared.find(key);
+		if (found != shared.end()) {
+			if (shared_ptr<const Dictionary> dictionary = found->second.lock())
+				return dictionary;
+		}
+	}
+	shared_ptr<Dictionary> next = make_shared<Dictionary>(backend_);
+	bool loaded = DictionaryFile::isCompiled(file) ? loadCompiled(file, *next) :
+		!affixFileOf(file).empty() ? loadAffixed(file, *next) : loadWords(file, *next);
+	if (!loaded)
+		return nullptr;
+	if (shareDictionaries_ && !key.empty()) {
+		lock_guard<mutex> lock(sharedMutex);
+		for (auto i = shared.begin(); i != shared.end();) {
+			if (i->second.expired())
+				i = shared.erase(i);
+			else
+				++i;
+		}
+		shared[key] = next;
+	}
+	return next;
+}
+
+// What makes two loads of file give the same dictionary: the file as it is now, and the settings
+// load() builds with. Empty if the file isn't there.
+std::string StudentSpellCheck::sharingKey(const std::string& file) const {
+	error_code error;
+	filesystem::path path = filesystem::absolute(file, error);
+	uintmax_t size = filesystem::file_size(path, error);
+	if (error)
+		return "";
+	auto modified = filesystem::last_write_time(path, error).time_since_epoch().count();
+	string key = path.string() + '\n' + to_string(size) + ' ' + to_string((long long)modified) + ' ' + to_string(backend_) +
+		' ' + to_string(deletionIndexEnabled_ ? maxEditDistance_ : 0) + ' ' + to_string(bloomFilterEnabled_) +
+		' ' + to_string(perfectHashEnabled_);
+	string affFile = affixFileOf(file);
+	if (!affFile.empty()) { // the rules are half the dictionary
+		size = filesystem::file_size(affFile, error);
+		modified = filesystem::last_write_time(affFile, error).time_since_epoch().count();
+		key += ' ' + to_string(size) + ' ' + to_string((long long)modified);
+	}
+	return error ? "" : key;
+}
+
+// Read a word list into next, in the backend's structure.
+bool StudentSpellCheck::loadWords(const std::string& dictionaryFile, Dictionary& next) {
+	vector<string> words;
+	if (!readWords(dictionaryFile, words))
 		return false; // dictionaryFile not loaded
-	string s;
-	while (getline(infile, s)) {
-		root->insert(root,s); // insert the line into trie data structure
+	loadProgress_ = 30;
+	bool built = true;
+	if (backend_ == DAWG)
+		built = next.dawg.build(words);
+	else if (backend_ == DOUBLE_ARRAY)
+		built = next.doubleArray.build(words);
+	else {
+		// Sorted words need exactly one new node per character past the prefix they share with
+		// the previous word, so the arena is allocated once at its final size.
+		size_t nodes = 1;
+		for (size_t i = 0; i < words.size(); i++) {
+			size_t common = 0;
+			while (i > 0 && common < words[i].size() && common < words[i - 1].size() && words[i][common] == words[i - 1][common])
+				common++;
+			nodes += words[i].size() - common;
+		}
+		next.trie.reserve(nodes);
+		for (const string& word : words)
+			next.trie.insert(word); // insert the line into trie data structure
 	}
+	if (!built)
+		return false;
+	loadProgress_ = 70;
+	if (deletionIndexEnabled_)
+		next.deletions.build(next.lexicon(), maxEditDistance_);
+	loadProgress_ = 85;
+	buildFilters(next);
 	return true;
 }
 
+bool StudentSpellCheck::readWords(const std::string& dictionaryFile, std::vector<std::string>& words) {
+	string affFile = affixFileOf(dictionaryFile);
+	if (!affFile.empty()) {
+		AffixDictionary affixes;
+		if (!affixes.read(affFile, dictionaryFile))
+			return false;
+		affixes.expand(words);
+		return true;
+	}
+	ifstream infile(dictionaryFile, ios::binary | ios::ate);
+	if (!infile)
+		return false;
+	string text((size_t)infile.tellg(), '\0');
+	infile.seekg(0);
+	infile.read(&text[0], text.size()); // one read
+	text += '\n';
+	words.clear();
+	string word;
+	size_t descents = 0;
+	for (char ch : text) {
+		if (ch == '\n') {
+			if (!word.empty() && word.size() <= kMaxWordLength) { // longer lines aren't words; they're skipped
+				words.push_back(word);
+				if (words.size() > 1 && words.back() < words[words.size() - 2])
+					descents++;
+			}
+			word.clear();
+		}
+		else if (isalpha((unsigned char)ch) || ch == '\'') // keep only letters (lowercased) and apostrophes
+			word += (char)tolower((unsigned char)ch);
+	}
+	if (descents > 0)
+		sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+	return true;
+}
+
+// Map a compiled dictionary and use its structure in place, preferring the backend's own kind
+// when the file holds more than one.
+bool StudentSpellCheck::loadCompiled(const std::string& dictionaryFile, Dictionary& next) {
+	DictionaryFile& file = next.compiled;
+	if (!file.open(dictionaryFile))
+		return false;
+	loadProgress_ = 50;
+	size_t nodesSize, edgesSize, unitsSize;
+	const void* nodes = file.section(DictionaryFile::DAWG_NODES, nodesSize);
+	const void* edges = file.section(DictionaryFile::DAWG_EDGES, edgesSize);
+	const void* units = file.section(DictionaryFile::DOUBLE_ARRAY_UNITS, unitsSize);
+	bool preferDoubleArray = backend_ == DOUBLE_ARRAY || nodes == nullptr || edges == nullptr;
+	if (units && preferDoubleArray &&
+		next.doubleArray.attach((const DoubleArrayTrie::Unit*)units, unitsSize / sizeof(DoubleArrayTrie::Unit)))
+		next.active = &next.doubleArray;
+	else if (nodes && edges && nodesSize >= 2 * sizeof(uint32_t) &&
+		next.dawg.attach((const uint32_t*)nodes, nodesSize / sizeof(uint32_t) - 1, (const uint32_t*)edges, edgesSize / sizeof(uint32_t)))
+		next.active = &next.dawg;
+	else
+		return false;
+	if (!attachDeletionIndex(file, next) && deletionIndexEnabled_)
+		next.deletions.build(next.lexicon(), maxEditDistance_);
+	loadProgress_ = 85;
+	attachFrequencies(file, next);
+	attachFilters(file, next);
+	return true;
+}
+
+// Read an .aff and .dic pair into next. Its lexicon is the stems, which suggestions walk; the
+// deletion index and filters would hold only the stems too, and aren't made.
+bool StudentSpellCheck::loadAffixed(const std::string& dicFile, Dictionary& next) {
+	if (!next.affixes.read(affixFileOf(dicFile), dicFile))
+		return false;
+	loadProgress_ = 85;
+	next.active = &next.affixes.stems();
+	return true;
+}
+
+bool StudentSpellCheck::attachDeletionIndex(const DictionaryFile& file, Dictionary& next) {
+	size_t paramsSize, bucketsSize, postingsSize, offsetsSize, textSize;
+	const uint32_t* params = (const uint32_t*)file.section(DictionaryFile::DELETION_PARAMS, paramsSize);
+	const void* buckets = file.section(DictionaryFile::DELETION_BUCKETS, bucketsSize);
+	const void* postings = file.section(DictionaryFile::DELETION_POSTINGS, postingsSize);
+	const void* offsets = file.section(DictionaryFile::DELETION_OFFSETS, offsetsSize);
+	const void* text = file.section(DictionaryFile::DELETION_TEXT, textSize);
+	if (!params || paramsSize < 2 * sizeof(uint32_t) || !buckets || bucketsSize < 2 * sizeof(uint32_t) ||
+		!postings || !offsets || offsetsSize < sizeof(uint32_t) || !text)
+		return false;
+	DeletionIndex::Arrays a = { params[0], (const uint32_t*)buckets, bucketsSize / sizeof(uint32_t) - 1,
+		(const uint32_t*)postings, postingsSize / sizeof(uint32_t), (const uint32_t*)offsets,
+		offsetsSize / sizeof(uint32_t) - 1, (const char*)text, textSize };
+	return next.deletions.attach(a);
+}
+
+void StudentSpellCheck::attachFrequencies(const DictionaryFile& file, Dictionary& next) {
+	size_t hashesSize, ranksSize;
+	const void* hashes = file.section(DictionaryFile::FREQUENCY_HASHES, hashesSize);
+	const void* ranks = file.section(DictionaryFile::FREQUENCY_RANKS, ranksSize);
+	if (hashes && ranks && ranksSize == hashesSize / sizeof(uint32_t))
+		next.frequencies.attach((const uint32_t*)hashes, (const uint8_t*)ranks, ranksSize);
+}
+
+// Whichever of the Bloom filter and perfect hash are enabled, from the lexicon just loaded.
+void StudentSpellCheck::buildFilters(Dictionary& next) {
+	if (bloomFilterEnabled_)
+		next.bloom.build(next.lexicon());
+	if (perfectHashEnabled_ && !next.perfect.build(next.lexicon()))
+		next.perfect.clear(); // words are looked up in the lexicon
+}
+
+// The file's Bloom filter and perfect hash, or where it has none, as buildFilters() would.
+void StudentSpellCheck::attachFilters(const DictionaryFile& file, Dictionary& next) {
+	size_t blocksSize, seedsSize, offsetsSize, textSize;
+	const void* blocks = file.section(DictionaryFile::BLOOM_BLOCKS, blocksSize);
+	const void* seeds = file.section(DictionaryFile::PERFECT_HASH_SEEDS, seedsSize);
+	const void* offsets = file.section(DictionaryFile::PERFECT_HASH_OFFSETS, offsetsSize);
+	const void* text = file.section(DictionaryFile::PERFECT_HASH_TEXT, textSize);
+	size_t blockBytes = BloomFilter::kWordsPerBlock * sizeof(uint64_t);
+	if (blocks && blocksSize >= blockBytes && blocksSize % blockBytes == 0)
+		next.bloom.attach((const uint64_t*)blocks, blocksSize / blockBytes);
+	else if (bloomFilterEnabled_)
+		next.bloom.build(next.lexicon());
+	PerfectHashSet::Arrays a = { (const uint32_t*)seeds, seedsSize / sizeof(uint32_t), (const uint32_t*)offsets,
+		offsetsSize / sizeof(uint32_t) - 1, (const char*)text, textSize };
+	if (seeds && offsets && offsetsSize >= 2 * sizeof(uint32_t) && text && next.perfect.attach(a))
+		return;
+	if (perfectHashEnabled_ && !next.perfect.build(next.lexicon()))
+		next.perfect.clear();
+}
+
+bool StudentSpellCheck::loadFrequencies(const std::string& file) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	shared_ptr<WordFrequencies> ranks = make_shared<WordFrequencies>();
+	bool read = ranks->read(file, stack()->base().lexicon());
+	atomic_store(&frequencies_, shared_ptr<const WordFrequencies>(ranks->empty() ? nullptr : ranks));
+	cache_.invalidate();
+	return read;
+}
+
+size_t StudentSpellCheck::frequencyBytes() const {
+	shared_ptr<const WordFrequencies> ranks = frequencies();
+	return ranks ? ranks->bytes() : 0;
+}
+
+bool StudentSpellCheck::compile(const std::string& dictionaryFile, const std::string& outFile, Backend backend,
+	int deletionDistance, const std::string& frequencyFile, bool bloomFilter, bool perfectHash) {
+	vector<string> words;
+	if (!readWords(dictionaryFile, words))
+		return false;
+	vector<DictionaryFile::Section> sections;
+	Dawg dawg;
+	DoubleArrayTrie doubleArray;
+	if (backend == DAWG) {
+		if (!dawg.build(words))
+			return false;
+		sections.push_back({ DictionaryFile::DAWG_NODES, dawg.nodeArray(), (dawg.nodeCount() + 1) * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::DAWG_EDGES, dawg.edgeArray(), dawg.edgeCount() * sizeof(uint32_t) });
+	}
+	else if (backend == DOUBLE_ARRAY) {
+		if (!doubleArray.build(words))
+			return false;
+		sections.push_back({ DictionaryFile::DOUBLE_ARRAY_UNITS, doubleArray.unitArray(),
+			doubleArray.unitCount() * sizeof(DoubleArrayTrie::Unit) });
+	}
+	else
+		return false; // the plain trie isn't worth storing
+	const Lexicon& lexicon = backend == DAWG ? (const Lexicon&)dawg : doubleArray;
+	DeletionIndex deletions;
+	uint32_t params[2] = { (uint32_t)deletionDistance, 0 };
+	if (deletionDistance > 0) {
+		if (!deletions.build(lexicon, deletionDistance))
+			return false;
+		DeletionIndex::Arrays a = deletions.arrays();
+		sections.push_back({ DictionaryFile::DELETION_PARAMS, params, sizeof(params) });
+		sections.push_back({ DictionaryFile::DELETION_BUCKETS, a.buckets, (a.bucketCount + 1) * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::DELETION_POSTINGS, a.postings, a.postingCount * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::DELETION_OFFSETS, a.offsets, (a.wordCount + 1) * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::DELETION_TEXT, a.text, a.textSize });
+	}
+	WordFrequencies frequencies;
+	if (!frequencyFile.empty()) {
+		if (!frequencies.read(frequencyFile, lexicon))
+			return false;
+		sections.push_back({ DictionaryFile::FREQUENCY_HASHES, frequencies.hashArray(), frequencies.size() * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::FREQUENCY_RANKS, frequencies.rankArray(), frequencies.size() });
+	}
+	BloomFilter bloom;
+	if (bloomFilter) {
+		bloom.build(lexicon);
+		sections.push_back({ DictionaryFile::BLOOM_BLOCKS, bloom.blockArray(), bloom.bytes() });
+	}
+	PerfectHashSet perfect;
+	if (perfectHash) {
+		if (!perfect.build(lexicon))
+			return false;
+		PerfectHashSet::Arrays a = perfect.arrays();
+		sections.push_back({ DictionaryFile::PERFECT_HASH_SEEDS, a.seeds, a.bucketCount * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::PERFECT_HASH_OFFSETS, a.offsets, (a.wordCount + 1) * sizeof(uint32_t) });
+		sections.push_back({ DictionaryFile::PERFECT_HASH_TEXT, a.text, a.textSize });
+	}
+	return DictionaryFile::write(outFile, words.size(), sections);
+}
+
+bool StudentSpellCheck::Dictionary::contains(const char* word, size_t length) const {
+	if (!affixes.empty())
+		return affixes.contains(word, length);
+	return bloom.mayContain(word, length) &&
+		(perfect.empty() ? active->contains(word, length) : perfect.contains(word, length));
+}
+
+bool StudentSpellCheck::Stack::contains(const char* word, size_t length) const {
+	if (layers.size() == 1)
+		return layers[0].dictionary->contains(word, length);
+	if (!prefilter.mayContain(word, length))
+		return false;
+	for (const Dictionary* dictionary : lookups) {
+		if (dictionary->contains(word, length))
+			return true;
+	}
+	return false;
+}
+
+const StudentSpellCheck::Dictionary& StudentSpellCheck::Stack::base() const {
+	for (const Layer& layer : layers) {
+		if (layer.base)
+			return *layer.dictionary;
+	}
+	return *layers[0].dictionary;
+}
+
+bool StudentSpellCheck::contains(const Stack& stack, const char* word, size_t length) const {
+	return stack.contains(word, length) || user_.contains(word, length);
+}
+
+bool StudentSpellCheck::contains(const char* word, size_t length) const {
+	return contains(*stack(), word, length);
+}
+
+bool StudentSpellCheck::loadUserDictionary(const std::string& file) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	bool loaded = user_.open(file);
+	cache_.invalidate(); // any number of words may have changed
+	lines_.invalidate();
+	return loaded;
+}
+
+bool StudentSpellCheck::addWord(const std::string& word) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	bool added = user_.add(word);
+	forgetAnswers(word);
+	return added;
+}
+
+bool StudentSpellCheck::ignoreWord(const std::string& word) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	bool ignored = user_.ignore(word);
+	forgetAnswers(word);
+	return ignored;
+}
+
+// word has just been accepted: its cached suggestions and the cached lines it was misspelled on
+// are out of date, and nothing else is.
+void StudentSpellCheck::forgetAnswers(const std::string& word) {
+	string lower = word;
+	for (char& c : lower)
+		c = (char)tolower((unsigned char)c);
+	cache_.erase(lower);
+	lines_.forgetWord(word);
+}
+
+
+size_t StudentSpellCheck::dictionaryNodes() const {
+	size_t nodes = 0;
+	for (const Layer& layer : stack()->layers)
+		nodes += layer.dictionary->lexicon().nodeCount();
+	return nodes;
+}
+
+size_t StudentSpellCheck::dictionaryBytes() const {
+	size_t bytes = 0;
+	for (const Layer& layer : stack()->layers)
+		bytes += layer.dictionary->lexicon().bytes();
+	return bytes;
+}
+
+size_t StudentSpellCheck::deletionIndexBytes() const {
+	size_t bytes = 0;
+	for (const Layer& layer : stack()->layers)
+		bytes += layer.dictionary->deletions.bytes();
+	return bytes;
+}
+
+size_t StudentSpellCheck::bloomFilterBytes() const {
+	size_t bytes = 0;
+	for (const Layer& layer : stack()->layers)
+		bytes += layer.dictionary->bloom.bytes();
+	return bytes;
+}
+
+size_t StudentSpellCheck::perfectHashBytes() const {
+	size_t bytes = 0;
+	for (const Layer& layer : stack()->layers)
+		bytes += layer.dictionary->perfect.bytes();
+	return bytes;
+}
+
+// Up to maxResults suggestions for word from each dictionary of the stack, merged: closest first,
+// then by the priority of the dictionary they came from, then as that dictionary ranked them.
+void StudentSpellCheck::suggest(const Stack& stack, const std::string& word, int maxDistance, size_t maxResults,
+	bool useDeletions, std::vector<Suggestion>& found) const {
+	shared_ptr<const WordFrequencies> ranks = frequencies();
+	vector<Suggestion> some;
+	for (const Layer& layer : stack.layers) {
+		const Dictionary& dictionary = *layer.dictionary;
+		some.clear();
+		if (!dictionary.affixes.empty())
+			dictionary.affixes.suggest(word, maxDistance, maxResults, some, ranks.get());
+		else if (useDeletions && !dictionary.deletions.empty() && maxDistance <= dictionary.deletions.maxDistance())
+			dictionary.deletions.suggest(word, maxDistance, maxResults, some, ranks.get());
+		else
+			suggestByAutomaton(dictionary.lexicon(), word, maxDistance, maxResults, some, ranks.get());
+		if (stack.layers.size() == 1) {
+			found.swap(some);
+			return;
+		}
+		for (Suggestion& s : some) {
+			if (none_of(found.begin(), found.end(), [&](const Suggestion& f) { return f.word == s.word; }))
+				found.push_back(move(s));
+		}
+	}
+	stable_sort(found.begin(), found.end(), [](const Suggestion& a, const Suggestion& b) { return a.distance < b.distance; });
+	if (found.size() > maxResults)
+		found.resize(maxResults);
+}
+
 bool StudentSpellCheck::spellCheck(std::string word, int max_suggestions, std::vector<std::string>& suggestions) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	TRACE_SCOPE(SPELL_SUGGEST);
 	for (int i = 0; i < word.size(); i++) {
 		word[i] = tolower(word[i]);
 	}
-	if (root->searchWord(root, word)) {
-		return true;
+	shared_ptr<const Stack> stack = this->stack();
+	if (contains(*stack, word.data(), word.size())) {
+		return true; // a dictionary lookup is as quick as a cache probe, so these aren't cached
 	}
 	else {
-		vector<string>::iterator it = suggestions.begin();
+		bool correct;
+		if (cache_.find(word, max_suggestions, correct, suggestions))
+			return correct;
 		suggestions.clear(); // clear suggestions
-		int suggest = 0;
-		string sugg = word;
-		string temp;
-		for (int i = 0; i < word.size(); i++) {
-			for (int g = 'a'; g < 'z'; g++) {
-				temp = sugg;
-				sugg[i] = g;
-				if (root->searchWord(root, sugg) && suggest < max_suggestions) {
-					suggest++;
-					suggestions.push_back(sugg);
-				}
-				sugg = temp;
-			}
+		if (max_suggestions > 0) {
+			vector<Suggestion> found; // closest first
+			suggest(*stack, word, maxEditDistance_, max_suggestions, true, found);
+			for (Suggestion& s : found)
+				suggestions.push_back(move(s.word));
 		}
+		cache_.insert(word, max_suggestions, false, suggestions);
 		return false;
 	}
 }
 
-void StudentSpellCheck::spellCheckLine(const std::string& line, std::vector<SpellCheck::Position>& problems) {
-	int pos1 = -1;
-	int pos2 = -1;
-	Position temp;
-	string lineTemp = line;
-	for (int i = 0; i < lineTemp.size(); i++) {
-		if (isalpha(lineTemp[i]))
-			lineTemp[i] = tolower(lineTemp[i]);
-	}
-	for (int i = 0; i < line.size(); i++) {
-		if (isalpha(line[0])) { // case for first word
-			pos1 = 0;
-		}
-		if (!isalpha(line[i]) && line[i] != '' && pos1 == 0) { // case for first word
-			pos2 = i;
-			if (!root->searchWord(root, lineTemp.substr(pos1, pos2-pos1))) {
-				temp.start = pos1;
-				temp.end = pos2-1;
-				problems.push_back(temp); // push back first word positions
-			}
-			if (pos2 + 2 >= line.size())
-				return; // return if only one word
-			break;
+void StudentSpellCheck::fuzzyFind(std::string word, int maxDistance, size_t maxMatches,
+	std::vector<Suggestion>& matches) const {
+	ALLOC_SCOPE(SPELL_CHECK);
+	TRACE_SCOPE(SPELL_SUGGEST);
+	for (char& ch : word)
+		ch = (char)tolower((unsigned char)ch);
+	matches.clear();
+	suggest(*stack(), word, maxDistance, maxMatches, false, matches);
+}
+
+void StudentSpellCheck::complete(const std::string& prefix, size_t maxResults, std::vector<std::string>& completions,
+	bool ranked) const {
+	ALLOC_SCOPE(SPELL_CHECK);
+	completions.clear();
+	shared_ptr<const Stack> stack = this->stack();
+	shared_ptr<const WordFrequencies> ranks = ranked ? frequencies() : nullptr;
+	shared_ptr<const CompletionRanking> ranking = ranks ? completionRanking(stack, ranks) : nullptr;
+	vector<string> some;
+	for (size_t i = 0; i < stack->layers.size(); i++) {
+		const Lexicon& lexicon = stack->layers[i].dictionary->lexicon();
+		vector<string>& out = stack->layers.size() == 1 ? completions : some;
+		some.clear();
+		if (ranking)
+			ranking->indexes[i].complete(lexicon, prefix.data(), prefix.size(), maxResults, out);
+		else
+			completeByWalk(lexicon, prefix.data(), prefix.size(), maxResults, out);
+		if (stack->layers.size() == 1)
+			return;
+		for (string& word : some) {
+			if (find(completions.begin(), completions.end(), word) == completions.end())
+				completions.push_back(move(word));
 		}
 	}
-	for (int i = pos2+1; i < line.size(); i++) {
-		if (ispunct(lineTemp[i])) {
-			continue;
+	if (ranks) {
+		stable_sort(completions.begin(), completions.end(), [&](const string& a, const string& b) {
+			return ranks->rank(a.data(), a.size()) > ranks->rank(b.data(), b.size()); });
+	}
+	else {
+		sort(completions.begin(), completions.end(), [](const string& a, const string& b) {
+			return a.size() != b.size() ? a.size() < b.size() : a < b; });
+	}
+	if (completions.size() > maxResults)
+		completions.resize(maxResults);
+}
+
+// The completion indexes for stack and frequencies, built (once, whichever thread asks first) if
+// the ones kept are for others.
+std::shared_ptr<const StudentSpellCheck::CompletionRanking> StudentSpellCheck::completionRanking(
+	const std::shared_ptr<const Stack>& stack, const std::shared_ptr<const WordFrequencies>& frequencies) const {
+	shared_ptr<const CompletionRanking> ranking = atomic_load(&ranking_);
+	if (ranking && ranking->stack.lock() == stack && ranking->frequencies.lock() == frequencies)
+		return ranking;
+	lock_guard<mutex> lock(rankingMutex_);
+	ranking = atomic_load(&ranking_);
+	if (ranking && ranking->stack.lock() == stack && ranking->frequencies.lock() == frequencies)
+		return ranking;
+	shared_ptr<CompletionRanking> next = make_shared<CompletionRanking>();
+	next->stack = stack;
+	next->frequencies = frequencies;
+	next->indexes.resize(stack->layers.size());
+	for (size_t i = 0; i < stack->layers.size(); i++)
+		next->indexes[i].build(stack->layers[i].dictionary->lexicon(), *frequencies);
+	ranking = move(next);
+	atomic_store(&ranking_, ranking);
+	return ranking;
+}
+
+size_t StudentSpellCheck::completionBytes() const {
+	shared_ptr<const CompletionRanking> ranking = atomic_load(&ranking_);
+	size_t total = 0;
+	if (ranking) {
+		for (const CompletionIndex& index : ranking->indexes)
+			total += index.bytes();
+	}
+	return total;
+}
+
+void StudentSpellCheck::spellCheckLine(const std::string& line, std::vector<SpellCheck::Position>& problems) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	uint64_t hash = LineCache::hash(line), stamp;
+	if (lines_.find(line, hash, problems, stamp))
+		return;
+	size_t first = problems.size();
+	// Held until the answer is cached: publish() waits for it, so its invalidation can't come
+	// between the check and the insert and leave an answer from the old dictionary current.
+	shared_ptr<const Stack> stack = this->stack();
+	checkLine(*stack, line, problems);
+	if (first == 0)
+		lines_.insert(line, hash, stamp, problems);
+	else
+		lines_.insert(line, hash, stamp, vector<Position>(problems.begin() + first, problems.end()));
+}
+
+void StudentSpellCheck::setThreads(unsigned threads) {
+	lock_guard<mutex> lock(poolMutex_);
+	threads_ = threads;
+	pool_.reset();
+}
+
+void StudentSpellCheck::spellCheckLines(const std::string* lines, size_t count, std::vector<Position>& problems,
+	std::vector<size_t>& offsets) {
+	ALLOC_SCOPE(SPELL_CHECK);
+	const size_t kMinLinesPerTask = 64; // below this, handing a task to another thread costs more than it saves
+	problems.clear();
+	offsets.assign(1, 0);
+	offsets.reserve(count + 1);
+	shared_ptr<const Stack> stack = this->stack(); // one for the whole batch
+	ThreadPool* pool = nullptr;
+	if (count >= 2 * kMinLinesPerTask) {
+		lock_guard<mutex> lock(poolMutex_);
+		if (!pool_)
+			pool_.reset(new ThreadPool(threads_));
+		if (pool_->threads() > 1)
+			pool = pool_.get();
+	}
+	if (pool == nullptr) {
+		for (size_t i = 0; i < count; i++) {
+			checkLine(*stack, lines[i], problems);
+			offsets.push_back(problems.size());
 		}
-		if (isalpha(line[i]) || line[i] == '') { // case for first word
-			pos1 = i;
-			while (isalpha(line[i])) {
-				i++;
-			}
-			pos2 = i;
-			
-			if (!root->searchWord(root, lineTemp.substr(pos1, pos2-pos1))) {
-				temp.start = pos1;
-				temp.end = pos2-1;
-				problems.push_back(temp); // push back first word positions
-				i--;
-			}
+		return;
+	}
+	// A few tasks per thread, so one that drew long lines doesn't hold up the rest; each fills its
+	// own problems and per-line counts, which are joined in order afterwards.
+	size_t tasks = min<size_t>(pool->threads() * 4, count / kMinLinesPerTask);
+	vector<vector<Position>> found(tasks);
+	vector<size_t> ends(count);
+	pool->run(tasks, [&](size_t t) {
+		ALLOC_SCOPE(SPELL_CHECK);
+		size_t first = count * t / tasks, last = count * (t + 1) / tasks;
+		for (size_t i = first; i < last; i++) {
+			checkLine(*stack, lines[i], found[t]);
+			ends[i] = found[t].size();
 		}
+	});
+	size_t total = 0;
+	for (const vector<Position>& f : found)
+		total += f.size();
+	problems.reserve(total);
+	for (size_t t = 0; t < tasks; t++) {
+		size_t base = problems.size();
+		problems.insert(problems.end(), found[t].begin(), found[t].end());
+		for (size_t i = count * t / tasks, last = count * (t + 1) / tasks; i < last; i++)
+			offsets.push_back(base + ends[i]);
 	}
 }
+
+void StudentSpellCheck::checkLine(const Stack& stack, const std::string& line,
+	std::vector<SpellCheck::Position>& problems) {
+	TRACE_SCOPE(SPELL_CHECK_LINE); // only lines the cache didn't answer
+	const char* text = line.data();
+	WordTokenizer::forEachWord(text, line.size(), [&](size_t start, size_t length) {
+		if (!contains(stack, text + start, length)) // looked up as it stands, in either case
+			problems.push_back({ (int)start, (int)(start + length - 1) });
+	});
+}
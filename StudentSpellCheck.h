@@ -2,88 +2,286 @@
 #define STUDENTSPELLCHECK_H_
 
 #include "SpellCheck.h"
+#include "Dawg.h"
+#include "DoubleArrayTrie.h"
+#include "DeletionIndex.h"
+#include "BloomFilter.h"
+#include "PerfectHashSet.h"
+#include "AffixDictionary.h"
+#include "Completion.h"
+#include "UserDictionary.h"
+#include "WordFrequencies.h"
+#include "SuggestionCache.h"
+#include "LineCache.h"
+#include "DictionaryFile.h"
+#include "ThreadPool.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 class StudentSpellCheck : public SpellCheck {
 public:
-    StudentSpellCheck() { }
+	// Which structure holds the dictionary. The DAWG shares suffixes as well as prefixes and is
+	// a small fraction of the trie's size; the double-array trie needs one array read per
+	// character; the plain trie is kept for comparison.
+	enum Backend { TRIE, DAWG, DOUBLE_ARRAY };
+
+    StudentSpellCheck(Backend backend = DAWG);
 	virtual ~StudentSpellCheck();
+	// Loads a word list, a file written by compile(), which is mapped and used in place (with
+	// whichever structure it holds), or the .dic file of a Hunspell-style .aff and .dic pair (see
+	// AffixDictionary.h), whose words are found through their stems. The new dictionary is built to
+	// one side while other threads go on checking against the old one, then swapped in whole; the
+	// old one is freed, and the cached answers forgotten, once no check that started before the
+	// swap is still running. If loading fails, the old dictionary stays.
 	bool load(std::string dict_file);
+	bool loadsConcurrently() const { return true; }
+	int loadProgress() const { return loadProgress_.load(std::memory_order_relaxed); }
+	// Stack another dictionary (a word list or compiled file) on the one load() loads, or take it
+	// off again; a word in any of them is correct. Suggestions come from all of them, closest first
+	// and, among equally close words, from the dictionary of higher priority (load()'s is 0) first.
+	// Lookups ask a Bloom filter of every stacked dictionary's words before any of them, so a
+	// misspelling costs one probe however many there are. Swapped in the way load() swaps.
+	bool addDictionary(const std::string& file, int priority);
+	bool removeDictionary(const std::string& file);
+	size_t dictionaryCount() const { return stack()->layers.size(); }
+	size_t prefilterBytes() const { return stack()->prefilter.bytes(); }
+	// Share each dictionary this loads with any other StudentSpellCheck in the process that loads
+	// the same file, unchanged, with the same settings, rather than building it again (the default).
+	// Compiled files are also shared between processes, as mapped pages of the same file.
+	void setShareDictionaries(bool enabled) { shareDictionaries_ = enabled; }
 	bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string>& suggestions);
 	void spellCheckLine(const std::string& line, std::vector<Position>& problems);
+	// Splits the lines between the threads of a pool, which all read the one dictionary, and
+	// goes around the line cache: a batch is usually a file being read, whose lines won't recur.
+	void spellCheckLines(const std::string* lines, size_t count, std::vector<Position>& problems,
+		std::vector<size_t>& offsets);
+	// Threads for spellCheckLines(), the caller's included; 0 (the default) means one per hardware
+	// thread. Not safe while a batch is being checked.
+	void setThreads(unsigned threads);
+	// The user's words (see UserDictionary.h) are looked up without a lock, so lines can be checked
+	// while words are added. Adding or ignoring a word forgets only the cached answers it changes:
+	// its own suggestions and the lines on which it was misspelled.
+	bool loadUserDictionary(const std::string& file);
+	bool addWord(const std::string& word);
+	bool ignoreWord(const std::string& word);
+
+	// Suggestions are dictionary words at most this many edits (substitutions, insertions,
+	// deletions or swaps of adjacent letters) away, closest first and, once loadFrequencies() has
+	// counts, most common first among equally close words.
+	static const int kDefaultMaxEditDistance = 2;
+	void setMaxEditDistance(int distance) {
+		maxEditDistance_ = distance;
+		cache_.invalidate();
+	}
+	// Answer suggestions from a deletion index (see DeletionIndex.h) built by the next load() at
+	// the current maximum edit distance: far faster than walking the dictionary, for tens of
+	// megabytes more memory. A compiled dictionary that carries an index uses it regardless.
+	void setDeletionIndex(bool enabled) { deletionIndexEnabled_ = enabled; }
+	size_t deletionIndexBytes() const;
+	// Ask a Bloom filter of the dictionary's words (see BloomFilter.h), built by the next load(),
+	// before the dictionary itself, so most misspellings are turned away without a walk. A
+	// compiled dictionary that carries a filter uses it regardless.
+	void setBloomFilter(bool enabled) { bloomFilterEnabled_ = enabled; }
+	size_t bloomFilterBytes() const;
+	// Look words up in a perfect hash of the dictionary's words (see PerfectHashSet.h), built by
+	// the next load(), instead of walking the dictionary structure, which suggestions still use.
+	// Likewise used regardless from a compiled dictionary that carries one.
+	void setPerfectHash(bool enabled) { perfectHashEnabled_ = enabled; }
+	size_t perfectHashBytes() const;
+	// Whether word, its letters in either case, is in the dictionary or the user's. Each call takes
+	// hold of the dictionary in use, which costs about 20 ns; spellCheckLine() does so once a line.
+	bool contains(const char* word, size_t length) const;
+	// Rank suggestions that are equally close by how common they are, counting words from a
+	// "word count" list or from plain text (see WordFrequencies.h). Words not in the dictionary
+	// are dropped, so call this after load(); load() replaces the counts with the compiled
+	// dictionary's, if it has any.
+	bool loadFrequencies(const std::string& file);
+	size_t frequencyBytes() const;
+
+	// spellCheck() answers are cached (see SuggestionCache.h) and forgotten whenever the
+	// dictionary or the suggestion settings change. A size of 0 turns the cache off; resizing
+	// isn't safe while other threads are checking words.
+	void setSuggestionCacheSize(size_t entries) { cache_.resize(entries); }
+	SuggestionCache::Stats suggestionCacheStats() const { return cache_.stats(); }
+	void resetSuggestionCacheStats() { cache_.resetStats(); }
+	// Likewise spellCheckLine() answers, per line of text (see LineCache.h).
+	void setLineCacheSize(size_t lines) { lines_.resize(lines); }
+	LineCache::Stats lineCacheStats() const { return lines_.stats(); }
+	void resetLineCacheStats() { lines_.resetStats(); }
+
+	// Every dictionary word within maxDistance edits of word (up to maxMatches of them),
+	// closest first: the word itself if it is in the dictionary, then its near misses.
+	void fuzzyFind(std::string word, int maxDistance, size_t maxMatches, std::vector<Suggestion>& matches) const;
+
+	// Completions of prefix (see Completion.h) from every stacked dictionary, merged: given counts
+	// from loadFrequencies() or a compiled dictionary and ranked, most common first and, among
+	// equally common words, from the dictionary of higher priority first; otherwise shortest first
+	// and then alphabetically. The first ranked call after the dictionaries or counts change
+	// builds each dictionary's CompletionIndex, which takes about as long as listing the words
+	// once. An affixed dictionary completes its stems, not the forms its rules make of them.
+	void complete(const std::string& prefix, size_t maxResults, std::vector<std::string>& completions,
+		bool ranked = true) const;
+	size_t completionBytes() const;
+
+	// Size of the loaded dictionary structures, every stacked dictionary's included (as are the
+	// other ...Bytes() figures).
+	size_t dictionaryNodes() const;
+	size_t dictionaryBytes() const;
+
+	// Read a dictionary file the way load() does: letters lowercased, other characters except
+	// apostrophes dropped, empty lines and lines of more than kMaxWordLength letters skipped, then
+	// sorted with duplicates removed. A .dic file with an .aff file beside it gives every word that
+	// its stems and rules make.
+	static const size_t kMaxWordLength = 256;
+	static bool readWords(const std::string& dictionaryFile, std::vector<std::string>& words);
+
+	// Build the backend's structure (DAWG or DOUBLE_ARRAY) from a word list and save it as a
+	// compiled dictionary that load() can map, with a deletion index for suggestions up to
+	// deletionDistance edits if that is positive, word frequencies if frequencyFile is given, and
+	// a Bloom filter and perfect hash if asked for.
+	static bool compile(const std::string& dictionaryFile, const std::string& outFile, Backend backend = DAWG,
+		int deletionDistance = 0, const std::string& frequencyFile = "", bool bloomFilter = false,
+		bool perfectHash = false);
 
 private:
-	struct Trie {
+	// A plain 27-way trie. Nodes live in one arena and refer to their children by 32-bit index
+	// (0, the root, means no child), so building is a bump allocation and clear() releases the
+	// whole structure with a single free.
+	class Trie : public Lexicon {
 	public:
-		bool isEnd; // bool for each node to check if its the end of the trie
-		Trie* c[27]; // array for 27 children
-		Trie* root;
-		Trie() { // constructor
-			this->isEnd = false;
-			for (int i = 0; i < 27; i++) {
-				this->c[i] = nullptr; // all children are nullptr
+		Trie() { clear(); }
+
+		void clear() { std::vector<TrieNode>(1).swap(nodes_); }
+		void reserve(size_t nodes) { nodes_.reserve(nodes); }
+
+		void insert(const std::string& word) { // word is made of Lexicon symbols
+			Node node = 0;
+			for (char ch : word) {
+				int symbol = symbolOf(ch);
+				if (nodes_[node].c[symbol] == 0) {
+					nodes_[node].c[symbol] = (Node)nodes_.size(); // new node if there is not node there
+					nodes_.emplace_back();
+				}
+				node = nodes_[node].c[symbol]; // iterator to next node
 			}
+			nodes_[node].isEnd = true; // the node is the end of a word once we insert
 		}
 
-		bool child(Trie* node) { // check if node has child
-			for (int i = 0; i < 27; i++) {
-				if (node->c[i] != nullptr)
-					return true; // node has child,, then return true
-			}
-			return false; // no child
+		Node root() const { return 0; }
+		bool child(Node node, int symbol, Node& next) const {
+			next = nodes_[node].c[symbol];
+			return next != 0;
 		}
-		void insert(Trie* root, std::string word) { // insert node into trie
-			Trie* currentNode = root;
-			for (int g = 0; g < word.length(); g++) {
-				int wordInd;
-				if (word[g] == 39)
-					wordInd = 26; // apostrophe case
-				else {
-					wordInd = word[g] - 'a'; // letter case
-				}	 
-				if (currentNode->c[wordInd] == nullptr)
-					currentNode->c[wordInd] = new Trie(); // new node if there is not node there
-				currentNode = currentNode->c[wordInd]; // iterator to next node
+		int children(Node node, Edge* edges) const {
+			int count = 0;
+			for (int i = 0; i < kSymbols; i++) {
+				if (nodes_[node].c[i] != 0)
+					edges[count++] = { i, nodes_[node].c[i] };
 			}
-			currentNode->isEnd = true; // new node is the end of the trie once we insert
+			return count;
 		}
+		bool isWord(Node node) const { return nodes_[node].isEnd != 0; }
+		size_t nodeCount() const { return nodes_.size(); }
+		size_t bytes() const { return nodes_.capacity() * sizeof(TrieNode); }
 
-		~Trie() {
-		}
+	private:
+		struct TrieNode {
+			Node c[kSymbols] = {}; // children
+			uint32_t isEnd = 0;
+		};
+		std::vector<TrieNode> nodes_;
+	};
 
-		void free(Trie* node) { // delete trie
-			for (int i = 0; i < 27; i++) {
-				if (node != nullptr) {
-					free(node->c[i]); // recursive function to reach all nodes below
-				}
-				else
-					delete node; // delete the node
-			}	
-		}
+	// Everything load() makes of one dictionary file. A Dictionary isn't changed once it is in
+	// use, so any number of threads can read it while the next one is built.
+	struct Dictionary {
+		explicit Dictionary(Backend backend);
+		Dictionary(const Dictionary&) = delete;
+		Dictionary& operator=(const Dictionary&) = delete;
 
-		bool searchWord(Trie* node, std::string word) { // search for a word from a given root
-			for (int i = 0; i < word.size(); i++) {
-				int wordInd;
-				if (word[i] == 39) {
-					wordInd = 26; // apostrophe case
-				}
-				else {
-					wordInd = word[i] - 'a'; // letter case
-				}
-				if (node->c[wordInd] == nullptr)
-					return false; // no match
-				else
-					node = node->c[wordInd];
-			}
-			if (node != nullptr && node->isEnd)
-				return true; // found the word 
-			else
-				return false; // did not find the word
-		}
+		const Lexicon& lexicon() const { return *active; }
+		bool contains(const char* word, size_t length) const;
+
+		Dawg dawg;
+		DoubleArrayTrie doubleArray;
+		Trie trie;
+		DictionaryFile compiled;  // the mapped file, if the dictionary came from one
+		const Lexicon* active;    // whichever of the structures holds the words
+		DeletionIndex deletions;
+		BloomFilter bloom;
+		PerfectHashSet perfect;
+		WordFrequencies frequencies; // the compiled file's, if it has any
+		AffixDictionary affixes;     // the stems and rules, if the dictionary came from them
 	};
-	Trie* root = new Trie(); // root node
+
+	struct Layer {
+		std::shared_ptr<const Dictionary> dictionary;
+		std::string file; // as given to load() or addDictionary()
+		int priority;
+		bool base; // load()'s
+	};
+	// The dictionaries in use, highest priority first. Like a Dictionary, a Stack isn't changed
+	// once it is in use; load() and addDictionary() publish a new one.
+	struct Stack {
+		std::vector<Layer> layers;
+		BloomFilter prefilter; // every layer's words, when there is more than one layer and none is affixed
+		std::vector<const Dictionary*> lookups; // the layers' dictionaries, biggest (and likeliest to hold a word) first
+		bool contains(const char* word, size_t length) const;
+		const Dictionary& base() const;
+	};
+
+	// Each layer's completion index for one stack and one set of counts, which the weak pointers
+	// tell apart from any later ones without keeping them alive.
+	struct CompletionRanking {
+		std::weak_ptr<const Stack> stack;
+		std::weak_ptr<const WordFrequencies> frequencies;
+		std::vector<CompletionIndex> indexes; // per layer
+	};
+
+	std::shared_ptr<const Stack> stack() const { return std::atomic_load(&stack_); }
+	std::shared_ptr<const WordFrequencies> frequencies() const { return std::atomic_load(&frequencies_); }
+	bool contains(const Stack& stack, const char* word, size_t length) const;
+	void checkLine(const Stack& stack, const std::string& line, std::vector<Position>& problems);
+	void suggest(const Stack& stack, const std::string& word, int maxDistance, size_t maxResults, bool useDeletions,
+		std::vector<Suggestion>& found) const;
+	std::shared_ptr<const Dictionary> loadDictionary(const std::string& file);
+	std::string sharingKey(const std::string& file) const;
+	bool loadWords(const std::string& dictionaryFile, Dictionary& next);
+	bool loadCompiled(const std::string& dictionaryFile, Dictionary& next);
+	bool loadAffixed(const std::string& dicFile, Dictionary& next);
+	static bool attachDeletionIndex(const DictionaryFile& file, Dictionary& next);
+	void attachFilters(const DictionaryFile& file, Dictionary& next);
+	void buildFilters(Dictionary& next);
+	static void attachFrequencies(const DictionaryFile& file, Dictionary& next);
+	std::shared_ptr<const CompletionRanking> completionRanking(const std::shared_ptr<const Stack>& stack,
+		const std::shared_ptr<const WordFrequencies>& frequencies) const;
+	void publish(std::vector<Layer> layers);
+	void forgetAnswers(const std::string& word);
+
+	Backend backend_;
+	// The dictionaries in use and the counts that rank their suggestions, read and replaced with
+	// std::atomic_load() and std::atomic_store().
+	std::shared_ptr<const Stack> stack_;
+	std::shared_ptr<const WordFrequencies> frequencies_;
+	mutable std::shared_ptr<const CompletionRanking> ranking_; // built by the first ranked complete()
+	mutable std::mutex rankingMutex_;
+	bool shareDictionaries_ = true;
+	std::mutex loadMutex_; // one load() at a time
+	std::atomic<int> loadProgress_{ 100 };
+	int maxEditDistance_ = kDefaultMaxEditDistance;
+	bool deletionIndexEnabled_ = false;
+	bool bloomFilterEnabled_ = false;
+	bool perfectHashEnabled_ = false;
+	UserDictionary user_;
+	SuggestionCache cache_;
+	LineCache lines_;
+	unsigned threads_ = 0;
+	std::unique_ptr<ThreadPool> pool_; // started by the first batch big enough to share out
+	std::mutex poolMutex_;
 };
 
 #endif  // STUDENTSPELLCHECK_H_
@@ -1,5 +1,7 @@
 #include "StudentTextEditor.h"
 #include "Undo.h"
+#include "Trace.h"
+#include "AllocTrack.h"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -14,6 +16,7 @@ TextEditor* createTextEditor(Undo* un)
 
 StudentTextEditor::StudentTextEditor(Undo* undo)
  : TextEditor(undo) {
+	ALLOC_SCOPE(EDITOR);
 	rowEdit = 0;
 	colEdit = 0;
 	m_list.push_back("");
@@ -26,6 +29,8 @@ StudentTextEditor::~StudentTextEditor()
 }
 
 bool StudentTextEditor::load(std::string file) {
+	ALLOC_SCOPE(EDITOR);
+	TRACE_SCOPE(LOAD);
 	ifstream infile(file);
 	if (!infile)
 		return false; // file cannot be loaded
@@ -53,6 +58,8 @@ bool StudentTextEditor::load(std::string file) {
 }
 
 bool StudentTextEditor::save(std::string file) {
+	ALLOC_SCOPE(EDITOR);
+	TRACE_SCOPE(SAVE);
 	ofstream outfile(file);
 	if (!outfile)
 		return false; // false if cannot open file
@@ -67,6 +74,7 @@ bool StudentTextEditor::save(std::string file) {
 }
 
 void StudentTextEditor::reset() {
+	ALLOC_SCOPE(EDITOR);
 	rowEdit, colEdit = 0;
 	list<string>::iterator it = m_list.begin();
 	while (it != m_list.end()) {
@@ -78,6 +86,7 @@ void StudentTextEditor::reset() {
 }
 
 void StudentTextEditor::move(Dir dir) {
+	ALLOC_SCOPE(EDITOR);
 	string currentLine = *it1;
 	switch (dir)
 	{
@@ -90,6 +99,8 @@ void StudentTextEditor::move(Dir dir) {
 			}
 			else {
 				rowEdit--; // move up
+				if (colEdit > (*it1).size())
+					colEdit = (*it1).size(); // line above is shorter
 			}
 		}
 		break;
@@ -102,6 +113,8 @@ void StudentTextEditor::move(Dir dir) {
 			}
 			else {
 				rowEdit++; // move down
+				if (colEdit > (*it1).size())
+					colEdit = (*it1).size(); // line below is shorter
 			}
 		}
 		break;
@@ -155,6 +168,7 @@ void StudentTextEditor::move(Dir dir) {
 }
 
 void StudentTextEditor::del() {
+	ALLOC_SCOPE(EDITOR);
 	list<string>::iterator it = m_list.end();
 	it--;
 	string temp = *it;
@@ -200,6 +214,7 @@ void StudentTextEditor::del() {
 }
 
 void StudentTextEditor::backspace() {
+	ALLOC_SCOPE(EDITOR);
 	string s = *it1;
 	if (colEdit == 0 && rowEdit == 0)
 		return;
@@ -243,6 +258,7 @@ void StudentTextEditor::backspace() {
 }
 
 void StudentTextEditor::insert(char ch) {
+	ALLOC_SCOPE(EDITOR);
 	string s = *it1;
 	if (colEdit == 0) {
 		if (ch == '\t') { // if tab character
@@ -274,6 +290,7 @@ void StudentTextEditor::insert(char ch) {
 }
 
 void StudentTextEditor::enter() {
+	ALLOC_SCOPE(EDITOR);
 	string s = *it1;
 	if (colEdit == s.size()) { // last pos
 		int colBefore = colEdit;
@@ -308,6 +325,8 @@ void StudentTextEditor::getPos(int& row, int& col) const {
 }
 
 int StudentTextEditor::getLines(int startRow, int numRows, std::vector<std::string>& lines) const {
+	ALLOC_SCOPE(EDITOR);
+	TRACE_SCOPE(GET_LINES);
 	if (startRow < 0 || numRows < 0)
 		return -1; // return -1 if startRow or numrows is negative
 	if (startRow > listSize) {
@@ -331,11 +350,22 @@ int StudentTextEditor::getLines(int startRow, int numRows, std::vector<std::stri
 }
 
 void StudentTextEditor::undo() {
+	ALLOC_SCOPE(EDITOR);
+	TRACE_SCOPE(UNDO_APPLY);
 	int row1;
 	int col1;
 	int count1;
 	string undo;
-	switch (getUndo()->get(row1,col1,count1,undo))
+	Undo::Action action = getUndo()->get(row1, col1, count1, undo);
+	if (action == Undo::Action::ERROR)
+		return; // nothing to undo, and row1 and col1 weren't set
+	if (row1 > listSize - 1)
+		row1 = listSize - 1; // never walk the iterator past the last line
+	if (row1 < 0)
+		row1 = 0;
+	if (col1 < 0)
+		col1 = 0;
+	switch (action)
 	{
 	case Undo::Action::INSERT: { // inserting back into doc
 		while (rowEdit > row1) { // ensure iterator is correct
@@ -355,11 +385,17 @@ void StudentTextEditor::undo() {
 			break;
 		}
 		if (colEdit > 0 && colEdit <= currLine.size() - 1) {
-			currLine = currLine.substr(0, colEdit-undo.size()) + undo + currLine.substr(colEdit-undo.size(), currLine.size()); //combine character into line
+			int at = colEdit - (int)undo.size();
+			if (at < 0)
+				at = 0; // batched text longer than the column it was recorded at
+			if (at > currLine.size())
+				at = currLine.size();
+			currLine = currLine.substr(0, at) + undo + currLine.substr(at, currLine.size()); //combine character into line
 			*it1 = currLine;
 			break;
 		}
-		if (colEdit == currLine.size()) {
+		if (colEdit >= currLine.size()) {
+			colEdit = currLine.size();
 			currLine = currLine + undo; //combine character into line
 			*it1 = currLine;
 			break;
@@ -377,6 +413,10 @@ void StudentTextEditor::undo() {
 		rowEdit = row1; // assign correct row
 		colEdit = col1; // assign correct col
 		string s = *it1;
+		if (colEdit > s.size())
+			colEdit = s.size();
+		if (count1 > s.size() - colEdit)
+			count1 = s.size() - colEdit; // only delete what is left on the line
 		if (colEdit == 0) { // if deleting first column
 			s = s.substr(count1, s.size()); // substring excluding first characters that we want to delete
 		}
@@ -402,7 +442,7 @@ void StudentTextEditor::undo() {
 		rowEdit = row1;
 		colEdit = col1;
 		string s = *it1;
-		if (colEdit == s.size()) {
+		if (colEdit == s.size() && rowEdit < listSize - 1) {
 			it1++;
 			string s1 = *it1; // temp string for next line
 			s = s + s1; // combine both lines
@@ -410,7 +450,6 @@ void StudentTextEditor::undo() {
 			listSize--; // decrement size
 			it1--; // decrement current line
 			*it1 = s; // store new line in list
-			return;
 		}
 		break;
 	}		
@@ -426,11 +465,16 @@ void StudentTextEditor::undo() {
 		rowEdit = row1;
 		colEdit = col1;
 		string s = *it1;
+		if (colEdit > s.size())
+			colEdit = s.size();
 		string temp = s.substr(0, colEdit); // store first line
 		string temp2 = s.substr(colEdit, s.size()); // store second lline
 		m_list.insert(next(it1), temp2); // split both lines
+		listSize++;
 		*it1 = temp;
 		break;
 	}
+	if (colEdit > (*it1).size())
+		colEdit = (*it1).size(); // keep the cursor on the line it was restored to
 }
 
@@ -1,14 +1,18 @@
 #include "StudentUndo.h"
+#include "Trace.h"
+#include "AllocTrack.h"
 #include <stack>
 #include <string>
 
 using namespace std;
 Undo* createUndo()
 {
+	ALLOC_SCOPE(UNDO);
 	return new StudentUndo;
 }
 
 void StudentUndo::submit(const Action action, int row, int col, char ch) {
+	ALLOC_SCOPE(UNDO);
 	string s = string(1, ch);
 	int colTemp = col;
 	int rowTemp = row;
@@ -79,6 +83,8 @@ void StudentUndo::submit(const Action action, int row, int col, char ch) {
 }
 
 StudentUndo::Action StudentUndo::get(int &row, int &col, int& count, std::string& text) {
+	ALLOC_SCOPE(UNDO);
+	TRACE_SCOPE(UNDO_GET);
 	if (undo.empty())
 		return Undo::Action::ERROR;
 	Action act = undo.top().act;
@@ -129,6 +135,7 @@ StudentUndo::Action StudentUndo::get(int &row, int &col, int& count, std::string
 }
 
 void StudentUndo::clear() {
+	ALLOC_SCOPE(UNDO);
 	for (int i = 0; i < undo.size(); i++) {
 		undo.pop(); // pop from stack repeatedly until empty
 	}
@@ -0,0 +1,161 @@
+#include "Suggest.h"
+#include "WordFrequencies.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+SuggestionList::SuggestionList(int maxDistance, size_t maxResults, const WordFrequencies* frequencies)
+	: maxResults_(maxResults), frequencies_(frequencies), offered_(0), bound_(maxResults > 0 ? maxDistance : -1) {
+}
+
+bool SuggestionList::better(const Entry& a, const Entry& b) {
+	if (a.distance != b.distance)
+		return a.distance < b.distance;
+	if (a.frequency != b.frequency)
+		return a.frequency > b.frequency;
+	return a.order < b.order;
+}
+
+bool SuggestionList::offer(const char* word, size_t length, int distance) {
+	if (distance < 0 || distance > bound_)
+		return false;
+	int frequency = frequencies_ ? frequencies_->rank(word, length) : 0;
+	if (heap_.size() < maxResults_) {
+		heap_.push_back({ distance, frequency, offered_++, string(word, length) });
+		push_heap(heap_.begin(), heap_.end(), better);
+	}
+	else {
+		// Later offers lose ties, so only a closer or more common word displaces the worst.
+		const Entry& worst = heap_.front();
+		if (distance > worst.distance || (distance == worst.distance && frequency <= worst.frequency))
+			return false;
+		pop_heap(heap_.begin(), heap_.end(), better);
+		Entry& e = heap_.back();
+		e.distance = distance;
+		e.frequency = frequency;
+		e.order = offered_++;
+		e.word.assign(word, length); // reuses the displaced word's buffer
+		push_heap(heap_.begin(), heap_.end(), better);
+	}
+	if (heap_.size() == maxResults_) {
+		// A full list only takes words closer than its worst, or as close and more common.
+		const Entry& worst = heap_.front();
+		bound_ = frequencies_ && worst.frequency < WordFrequencies::kMaxRank ? worst.distance : worst.distance - 1;
+	}
+	return true;
+}
+
+void SuggestionList::take(std::vector<Suggestion>& out) {
+	sort_heap(heap_.begin(), heap_.end(), better);
+	for (Entry& e : heap_)
+		out.push_back({ move(e.word), e.distance });
+	heap_.clear();
+}
+
+namespace {
+	class TrieWalk {
+	public:
+		TrieWalk(const Lexicon& lexicon, const string& word, int maxDistance, SuggestionList& results)
+			: lexicon_(lexicon), word_(word), n_(word.size()), results_(results),
+			rows_((word.size() + maxDistance + 2) * (word.size() + 1)), maxDepth_(word.size() + maxDistance) {
+			for (size_t j = 0; j <= n_; j++)
+				rows_[j] = (int)j; // the empty prefix is j insertions away from word[0, j)
+		}
+
+		void visit(Lexicon::Node node, size_t depth) {
+			Lexicon::Edge edges[Lexicon::kSymbols];
+			int count = lexicon_.children(node, edges);
+			const int* prev = row(depth);
+			const int* prev2 = depth > 0 ? row(depth - 1) : nullptr;
+			int* cur = row(depth + 1);
+			for (int e = 0; e < count; e++) {
+				char c = Lexicon::charOf(edges[e].symbol);
+				prefix_.push_back(c);
+				cur[0] = (int)depth + 1;
+				int best = cur[0];
+				for (size_t j = 1; j <= n_; j++) {
+					int v = min(min(prev[j], cur[j - 1]) + 1, prev[j - 1] + (word_[j - 1] == c ? 0 : 1));
+					if (prev2 && j > 1 && word_[j - 2] == c && word_[j - 1] == prefix_[depth - 1])
+						v = min(v, prev2[j - 2] + 1); // adjacent characters swapped
+					cur[j] = v;
+					best = min(best, v);
+				}
+				if (cur[n_] <= results_.bound() && lexicon_.isWord(edges[e].target))
+					results_.offer(prefix_.data(), prefix_.size(), cur[n_]);
+				if (best <= results_.bound() && depth + 1 < maxDepth_)
+					visit(edges[e].target, depth + 1);
+				prefix_.pop_back();
+			}
+		}
+
+	private:
+		int* row(size_t depth) { return &rows_[depth * (n_ + 1)]; }
+
+		const Lexicon& lexicon_;
+		const string& word_;
+		size_t n_;
+		SuggestionList& results_;
+		vector<int> rows_; // row d scores the current d-character prefix against every prefix of word
+		size_t maxDepth_;
+		string prefix_;
+	};
+}
+
+void suggestByTrieWalk(const Lexicon& lexicon, const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies) {
+	SuggestionList results(maxDistance, maxResults, frequencies);
+	if (results.bound() < 0)
+		return;
+	if (word.size() <= (size_t)maxDistance && lexicon.isWord(lexicon.root()))
+		results.offer("", 0, (int)word.size());
+	TrieWalk walk(lexicon, word, maxDistance, results);
+	walk.visit(lexicon.root(), 0);
+	results.take(out);
+}
+
+int editDistance(const std::string& a, const std::string& b) {
+	vector<vector<int>> d(a.size() + 1, vector<int>(b.size() + 1));
+	for (size_t i = 0; i <= a.size(); i++)
+		d[i][0] = (int)i;
+	for (size_t j = 0; j <= b.size(); j++)
+		d[0][j] = (int)j;
+	for (size_t i = 1; i <= a.size(); i++) {
+		for (size_t j = 1; j <= b.size(); j++) {
+			d[i][j] = min(min(d[i - 1][j], d[i][j - 1]) + 1, d[i - 1][j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1));
+			if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+				d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+		}
+	}
+	return d[a.size()][b.size()];
+}
+
+int boundedEditDistance(const std::string& a, const char* b, size_t bLength, int bound, std::vector<int>& rows) {
+	size_t n = a.size();
+	rows.resize(3 * (n + 1));
+	int* prev2 = &rows[0];
+	int* prev = &rows[n + 1];
+	int* cur = &rows[2 * (n + 1)];
+	for (size_t j = 0; j <= n; j++)
+		prev[j] = (int)j;
+	for (size_t i = 1; i <= bLength; i++) {
+		char c = b[i - 1];
+		cur[0] = (int)i;
+		int best = cur[0];
+		for (size_t j = 1; j <= n; j++) {
+			int v = min(min(prev[j], cur[j - 1]) + 1, prev[j - 1] + (a[j - 1] == c ? 0 : 1));
+			if (i > 1 && j > 1 && a[j - 2] == c && a[j - 1] == b[i - 2])
+				v = min(v, prev2[j - 2] + 1);
+			cur[j] = v;
+			best = min(best, v);
+		}
+		if (best > bound)
+			return bound + 1; // every later row is at least as large
+		int* t = prev2;
+		prev2 = prev;
+		prev = cur;
+		cur = t;
+	}
+	return min(prev[n], bound + 1);
+}
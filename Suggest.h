@@ -0,0 +1,61 @@
+#ifndef SUGGEST_H_
+#define SUGGEST_H_
+
+// Spelling suggestion searches over a Lexicon. A suggestion is a dictionary word within a
+// bounded (restricted) Damerau-Levenshtein distance of the misspelled word: each substitution,
+// insertion, deletion or swap of two adjacent characters costs one edit.
+
+#include "Lexicon.h"
+#include <string>
+#include <vector>
+
+class WordFrequencies;
+
+struct Suggestion {
+	std::string word;
+	int distance;
+};
+
+// The best maxResults suggestions seen so far: closest first, then, given frequencies, most
+// common first, then in the order they were offered. They are kept in a heap of at most
+// maxResults entries with the worst on top, so a candidate costs O(log maxResults) and nothing
+// is sorted until take(). bound() tells a search the largest distance that could still get in,
+// so it can stop exploring candidates that can't.
+class SuggestionList {
+public:
+	SuggestionList(int maxDistance, size_t maxResults, const WordFrequencies* frequencies = nullptr);
+
+	// Returns false if the word doesn't make the list.
+	bool offer(const char* word, size_t length, int distance);
+	int bound() const { return bound_; }
+	// Move the suggestions out, best first.
+	void take(std::vector<Suggestion>& out);
+
+private:
+	struct Entry {
+		int distance;
+		int frequency;
+		size_t order;
+		std::string word;
+	};
+	static bool better(const Entry& a, const Entry& b);
+
+	std::vector<Entry> heap_; // heap_[0] is the worst entry kept
+	size_t maxResults_;
+	const WordFrequencies* frequencies_;
+	size_t offered_;
+	int bound_;
+};
+
+// Depth-first walk of the lexicon carrying one row of the edit-distance matrix per level, so
+// each shared prefix is scored once; subtrees whose row minimum exceeds the bound are skipped.
+void suggestByTrieWalk(const Lexicon& lexicon, const std::string& word, int maxDistance, size_t maxResults,
+	std::vector<Suggestion>& out, const WordFrequencies* frequencies = nullptr);
+
+// Restricted Damerau-Levenshtein (optimal string alignment) distance between two words.
+int editDistance(const std::string& a, const std::string& b);
+// The same distance between a and b[0, bLength), or bound + 1 as soon as it must exceed bound.
+// rows is scratch space that callers can reuse across calls.
+int boundedEditDistance(const std::string& a, const char* b, size_t bLength, int bound, std::vector<int>& rows);
+
+#endif // SUGGEST_H_
@@ -0,0 +1,144 @@
+#include "SuggestionCache.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+SuggestionCache::SuggestionCache(size_t capacity)
+	: sets_(0), generation_(0), clock_(0), hits_(0), misses_(0), evictions_(0), readers_(0) {
+	resize(capacity);
+}
+
+SuggestionCache::~SuggestionCache() {
+	resize(0);
+}
+
+void SuggestionCache::resize(size_t capacity) {
+	lock_guard<mutex> lock(writer_);
+	for (size_t i = 0; i < sets_ * kWays; i++)
+		delete slots_[i].load(memory_order_relaxed);
+	for (Entry* e : retired_)
+		delete e;
+	retired_.clear();
+	size_t sets = 0;
+	if (capacity > 0) {
+		sets = 1;
+		while (sets * kWays < capacity)
+			sets *= 2;
+	}
+	slots_.reset(sets ? new atomic<Entry*>[sets * kWays] : nullptr);
+	for (size_t i = 0; i < sets * kWays; i++)
+		slots_[i].store(nullptr, memory_order_relaxed);
+	sets_ = sets;
+}
+
+size_t SuggestionCache::setOf(const std::string& word) const {
+	uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a
+	for (char c : word)
+		h = (h ^ (unsigned char)c) * 0x100000001b3ULL;
+	return (size_t)(h ^ (h >> 32)) & (sets_ - 1);
+}
+
+bool SuggestionCache::find(const std::string& word, int maxSuggestions, bool& correct,
+	std::vector<std::string>& suggestions) const {
+	if (sets_ == 0)
+		return false;
+	bool hit = false;
+	// seq_cst pairs this with the writer's exchange-then-check, so an entry is never freed
+	// between our loading its pointer and our leaving.
+	readers_.fetch_add(1);
+	uint64_t generation = generation_.load(memory_order_acquire);
+	const atomic<Entry*>* set = &slots_[setOf(word) * kWays];
+	for (size_t w = 0; w < kWays && !hit; w++) {
+		const Entry* e = set[w].load();
+		if (e == nullptr || e->generation != generation || e->word != word)
+			continue;
+		if (!e->correct && e->maxSuggestions < maxSuggestions && (int)e->suggestions.size() >= e->maxSuggestions)
+			continue; // computed for fewer suggestions than asked for, and there may be more
+		correct = e->correct;
+		if (!e->correct) {
+			size_t n = min(e->suggestions.size(), (size_t)max(maxSuggestions, 0));
+			suggestions.assign(e->suggestions.begin(), e->suggestions.begin() + n);
+		}
+		e->lastUse.store(clock_.fetch_add(1, memory_order_relaxed) + 1, memory_order_relaxed);
+		hit = true;
+	}
+	readers_.fetch_sub(1);
+	(hit ? hits_ : misses_).fetch_add(1, memory_order_relaxed);
+	return hit;
+}
+
+void SuggestionCache::insert(const std::string& word, int maxSuggestions, bool correct,
+	const std::vector<std::string>& suggestions) {
+	if (sets_ == 0)
+		return;
+	Entry* fresh = new Entry;
+	fresh->word = word;
+	fresh->maxSuggestions = maxSuggestions;
+	fresh->correct = correct;
+	if (!correct)
+		fresh->suggestions = suggestions;
+	fresh->generation = generation_.load(memory_order_acquire);
+	fresh->lastUse.store(clock_.fetch_add(1, memory_order_relaxed) + 1, memory_order_relaxed);
+
+	lock_guard<mutex> lock(writer_);
+	atomic<Entry*>* set = &slots_[setOf(word) * kWays];
+	// The same word, else a free or stale way, else the least recently used one.
+	size_t victim = kWays;
+	for (size_t w = 0; w < kWays && victim == kWays; w++) {
+		const Entry* e = set[w].load(memory_order_relaxed);
+		if (e != nullptr && e->word == word)
+			victim = w;
+	}
+	for (size_t w = 0; w < kWays && victim == kWays; w++) {
+		const Entry* e = set[w].load(memory_order_relaxed);
+		if (e == nullptr || e->generation != fresh->generation)
+			victim = w;
+	}
+	if (victim == kWays) {
+		victim = 0;
+		for (size_t w = 1; w < kWays; w++) {
+			if (set[w].load(memory_order_relaxed)->lastUse.load(memory_order_relaxed) <
+				set[victim].load(memory_order_relaxed)->lastUse.load(memory_order_relaxed))
+				victim = w;
+		}
+		evictions_.fetch_add(1, memory_order_relaxed);
+	}
+	Entry* old = set[victim].exchange(fresh);
+	if (old != nullptr)
+		retired_.push_back(old);
+	reclaim();
+}
+
+void SuggestionCache::erase(const std::string& word) {
+	if (sets_ == 0)
+		return;
+	lock_guard<mutex> lock(writer_);
+	atomic<Entry*>* set = &slots_[setOf(word) * kWays];
+	for (size_t w = 0; w < kWays; w++) {
+		const Entry* e = set[w].load(memory_order_relaxed);
+		if (e != nullptr && e->word == word)
+			retired_.push_back(set[w].exchange(nullptr));
+	}
+	reclaim();
+}
+
+void SuggestionCache::reclaim() {
+	if (retired_.empty() || readers_.load() != 0)
+		return; // a reader that saw a retired entry is still inside find(); try again next time
+	for (Entry* e : retired_)
+		delete e;
+	retired_.clear();
+}
+
+SuggestionCache::Stats SuggestionCache::stats() const {
+	return { hits_.load(memory_order_relaxed), misses_.load(memory_order_relaxed),
+		evictions_.load(memory_order_relaxed) };
+}
+
+void SuggestionCache::resetStats() {
+	hits_.store(0, memory_order_relaxed);
+	misses_.store(0, memory_order_relaxed);
+	evictions_.store(0, memory_order_relaxed);
+}
@@ -0,0 +1,81 @@
+#ifndef SUGGESTIONCACHE_H_
+#define SUGGESTIONCACHE_H_
+
+// Memoized spellCheck() answers: whether a lowercased word is in the dictionary and, if not, its
+// suggestion list. The GUI asks again for the word under the cursor on every redraw, so repeats
+// are the common case. (StudentSpellCheck only stores misspelled words; it answers correct ones
+// from the dictionary, which is as quick as a probe here.)
+//
+// The cache is 8-way set associative with least-recently-used replacement within each set.
+// Entries are immutable once published, so lookups take no lock: a reader loads an entry
+// pointer, compares and copies, and stamps the entry's last use with a relaxed store. Writers
+// serialize on a mutex, publish a new entry with one pointer exchange, and free replaced entries
+// only once no reader is inside find(). invalidate() bumps a generation number that every entry
+// carries, so a dictionary change costs O(1) and stale entries simply stop matching.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SuggestionCache {
+public:
+	static const size_t kDefaultCapacity = 1024;
+	static const size_t kWays = 8;
+
+	struct Stats {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions; // live entries replaced to make room
+	};
+
+	explicit SuggestionCache(size_t capacity = kDefaultCapacity);
+	~SuggestionCache();
+
+	// On a hit, sets correct and, for a misspelled word, the first maxSuggestions suggestions.
+	// An entry answers any request for as many suggestions as it was computed with, or more if
+	// the list it holds was already complete.
+	bool find(const std::string& word, int maxSuggestions, bool& correct, std::vector<std::string>& suggestions) const;
+	void insert(const std::string& word, int maxSuggestions, bool correct, const std::vector<std::string>& suggestions);
+	// Forget every entry, e.g. because the dictionary changed.
+	void invalidate() { generation_.fetch_add(1, std::memory_order_release); }
+	// Forget the entry for word, e.g. because it has just been added to the dictionary.
+	void erase(const std::string& word);
+
+	// Drop everything and hold up to capacity entries (0 turns the cache off). Not safe while
+	// other threads use the cache.
+	void resize(size_t capacity);
+	size_t capacity() const { return sets_ * kWays; }
+
+	Stats stats() const;
+	void resetStats();
+
+private:
+	struct Entry {
+		std::string word;
+		int maxSuggestions;
+		bool correct;
+		std::vector<std::string> suggestions;
+		uint64_t generation;
+		mutable std::atomic<uint64_t> lastUse;
+	};
+
+	SuggestionCache(const SuggestionCache&) = delete;
+	SuggestionCache& operator=(const SuggestionCache&) = delete;
+
+	size_t setOf(const std::string& word) const;
+	void reclaim(); // with writer_ held
+
+	std::unique_ptr<std::atomic<Entry*>[]> slots_; // sets_ * kWays
+	size_t sets_; // a power of two
+	std::atomic<uint64_t> generation_;
+	mutable std::atomic<uint64_t> clock_; // last-use stamps
+	mutable std::atomic<uint64_t> hits_, misses_, evictions_;
+	mutable std::atomic<int> readers_; // threads inside find()
+	std::mutex writer_;
+	std::vector<Entry*> retired_; // replaced entries a reader may still be looking at
+};
+
+#endif // SUGGESTIONCACHE_H_
@@ -1,7 +1,24 @@
 #ifndef TEXTIO_H_
 #define TEXTIO_H_
 
-#ifndef _MSC_VER
+#if defined(WURD_HEADLESS)
+// No terminal: key codes mirror ncurses so scripts behave the same either way.
+#define COLOR_RED	1
+#define COLOR_WHITE	7
+#define KEY_DOWN	0402
+#define KEY_UP		0403
+#define KEY_LEFT	0404
+#define KEY_RIGHT	0405
+#define KEY_HOME	0406
+#define KEY_BACKSPACE	0407
+#define KEY_DC		0512
+#define KEY_NPAGE	0522
+#define KEY_PPAGE	0523
+#define KEY_ENTER	0527
+#define KEY_END		0550
+#include <deque>
+#include <vector>
+#elif !defined(_MSC_VER)
 #include <curses.h>		// https://www.linuxjournal.com/content/getting-started-ncurses
 #else
 #include "curses.h"
@@ -9,12 +26,88 @@
 
 #include <string>
 
+const int CTRL_A = 'A' - 'A' + 1;
 const int CTRL_D = 'D' - 'A' + 1;
+const int CTRL_G = 'G' - 'A' + 1;
 const int CTRL_S = 'S' - 'A' + 1;
 const int CTRL_L = 'L' - 'A' + 1;
+const int CTRL_N = 'N' - 'A' + 1;
+const int CTRL_P = 'P' - 'A' + 1;
+const int CTRL_W = 'W' - 'A' + 1;
 const int CTRL_X = 'X' - 'A' + 1;
 const int CTRL_Z = 'Z' - 'A' + 1;
+const int NO_KEY = -1; // getChar(timeoutMs) gave up waiting
 
+#if defined(WURD_HEADLESS)
+// Headless TextIO used by the scripted driver (tools/headless.cpp). Output goes to an in-memory
+// screen so rendering still does the same work, and prompts are answered from a queue of
+// inputs instead of the keyboard.
+class TextIO {
+public:
+	TextIO(int, int, int) { }
+
+	static void clear() {
+		screen_.clear();
+	}
+
+	enum COLOR {
+		WHITE = COLOR_WHITE,
+		RED = COLOR_RED
+	};
+
+	static void print(char ch, COLOR /*fcolor*/ = COLOR::WHITE) {
+		if (row_ >= (int)screen_.size())
+			screen_.resize(row_ + 1);
+		std::string& line = screen_[row_];
+		if (col_ >= (int)line.size())
+			line.resize(col_ + 1, ' ');
+		line[col_++] = ch;
+	}
+
+	static void print(const std::string& s, COLOR fcolor = COLOR::WHITE) {
+		for (char ch : s)
+			print(ch, fcolor);
+	}
+
+	static void refresh() { }
+
+	static void move(int row, int col) {
+		row_ = row;
+		col_ = col;
+	}
+
+	static int getChar() {
+		return 0; // keys are fed straight to EditorGui::processKey()
+	}
+
+	static int getChar(int /*timeoutMs*/) {
+		return NO_KEY;
+	}
+
+	static void getString(std::string& str) {
+		str.clear();
+		if (!inputs_.empty()) {
+			str = inputs_.front();
+			inputs_.pop_front();
+		}
+	}
+
+	// Queue the answer to the next prompt (filename, "Quit [y/N]", ...).
+	static void pushInput(const std::string& str) {
+		inputs_.push_back(str);
+	}
+
+	static const std::vector<std::string>& screen() {
+		return screen_;
+	}
+
+private:
+	static inline std::vector<std::string> screen_;
+	static inline std::deque<std::string> inputs_;
+	static inline int row_ = 0;
+	static inline int col_ = 0;
+};
+#else
 class TextIO {
 public:
 	TextIO(int fgcolor, int bgcolor, int hilite) {
@@ -95,6 +188,14 @@ public:
 		return ch;
 	}
 
+	// As getChar(), but returns NO_KEY if no key is pressed within timeoutMs milliseconds.
+	static int getChar(int timeoutMs) {
+		wtimeout(stdscr, timeoutMs);
+		const int ch = getChar();
+		wtimeout(stdscr, -1);
+		return ch == ERR ? NO_KEY : ch;
+	}
+
 	static void getString(std::string& str) {
 		const int kMaxFilenameLength = 1024;
 		char temp[kMaxFilenameLength] = "";
@@ -107,5 +208,6 @@ public:
 private:
 	static const int kDefaultPair = 1;
 };
+#endif // WURD_HEADLESS
 
 #endif // TEXTIO_H_
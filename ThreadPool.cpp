@@ -0,0 +1,70 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned threads) {
+	if (threads == 0)
+		threads = max(1u, thread::hardware_concurrency());
+	for (unsigned i = 1; i < threads; i++)
+		workers_.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (thread& t : workers_)
+		t.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+	if (count == 0)
+		return;
+	lock_guard<mutex> turn(runMutex_);
+	{
+		lock_guard<mutex> lock(mutex_);
+		task_ = &task;
+		count_ = count;
+		next_ = 0;
+		finished_ = 0;
+		generation_++;
+	}
+	wake_.notify_all();
+	drain();
+	unique_lock<mutex> lock(mutex_);
+	done_.wait(lock, [this] { return finished_ == count_; });
+	task_ = nullptr;
+}
+
+void ThreadPool::drain() {
+	unique_lock<mutex> lock(mutex_);
+	while (next_ < count_) {
+		size_t i = next_++;
+		const function<void(size_t)>& task = *task_;
+		lock.unlock();
+		task(i);
+		lock.lock();
+		if (++finished_ == count_)
+			done_.notify_all();
+	}
+}
+
+void ThreadPool::work() {
+	unsigned seen = 0;
+	for (;;) {
+		{
+			unique_lock<mutex> lock(mutex_);
+			wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+			if (stopping_)
+				return;
+			seen = generation_;
+		}
+		drain();
+	}
+}
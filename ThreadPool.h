@@ -0,0 +1,42 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+// A fixed set of threads for data-parallel loops: run() hands out the indices of a loop to the
+// pool's threads and the calling thread alike, and returns once every one has been done. Runs
+// from different threads take turns.
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+	// threads counts the caller, so threads - 1 are started; 0 means one per hardware thread.
+	explicit ThreadPool(unsigned threads = 0);
+	~ThreadPool();
+
+	unsigned threads() const { return (unsigned)workers_.size() + 1; }
+
+	// Call task(i) for every i in [0, count), in no particular order and on any of the threads.
+	void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void work();
+	void drain(); // take and run indices until none are left
+
+	std::vector<std::thread> workers_;
+	std::mutex runMutex_; // one run() at a time
+	std::mutex mutex_;
+	std::condition_variable wake_, done_;
+	const std::function<void(size_t)>* task_ = nullptr;
+	size_t count_ = 0, next_ = 0, finished_ = 0;
+	unsigned generation_ = 0; // bumped by each run() to wake the workers
+	bool stopping_ = false;
+};
+
+#endif // THREADPOOL_H_
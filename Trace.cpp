@@ -0,0 +1,182 @@
+#include "Trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+namespace {
+	struct Event {
+		uint64_t ts; // nowNs(); the session's start is taken off when the trace is written
+		uint8_t stage;
+		uint8_t phase; // 'B' or 'E'
+	};
+
+	// One ring buffer per thread. Only the owning thread writes to it (start() doesn't reset it);
+	// head is published with release semantics so the thread that dumps the trace sees complete
+	// events.
+	struct Buffer {
+		int tid;
+		size_t mask; // capacity - 1, capacity is a power of two
+		Event* events;
+		atomic<uint64_t> head;
+		Buffer* next;
+	};
+
+	atomic<Buffer*> g_buffers(nullptr); // lock-free list of every thread's buffer
+	atomic<int> g_nextTid(1);
+	atomic<uint64_t> g_startNs(0); // of this session: older events are an earlier session's
+	string g_outFile;
+	bool g_atexitRegistered = false;
+	thread_local Buffer* t_buffer = nullptr;
+
+	size_t bufferCapacity() {
+		size_t cap = 1 << 20; // events per thread
+		if (const char* env = getenv("WURD_TRACE_EVENTS")) {
+			long long n = atoll(env);
+			if (n > 0) {
+				cap = 1;
+				while (cap < (size_t)n)
+					cap <<= 1;
+			}
+		}
+		return cap;
+	}
+
+	Buffer* threadBuffer() {
+		if (t_buffer == nullptr) {
+			Buffer* b = new Buffer; // intentionally never freed; it must outlive the thread
+			size_t cap = bufferCapacity();
+			b->tid = g_nextTid.fetch_add(1);
+			b->mask = cap - 1;
+			b->events = new Event[cap];
+			b->head.store(0, memory_order_relaxed);
+			b->next = g_buffers.load(memory_order_relaxed);
+			while (!g_buffers.compare_exchange_weak(b->next, b, memory_order_release, memory_order_relaxed))
+				;
+			t_buffer = b;
+		}
+		return t_buffer;
+	}
+
+	LatencyHistogram g_histograms[Trace::NUM_STAGES];
+
+	void record(Trace::Stage stage, uint8_t phase, uint64_t ns) {
+		Buffer* b = threadBuffer();
+		uint64_t h = b->head.load(memory_order_relaxed);
+		Event& e = b->events[h & b->mask];
+		e.ts = ns;
+		e.stage = (uint8_t)stage;
+		e.phase = phase;
+		b->head.store(h + 1, memory_order_release);
+	}
+
+	void writeAtExit() {
+		Trace::stop();
+	}
+
+	// Honour WURD_TRACE=<file> without any code changes in the driver.
+	struct EnvInit {
+		EnvInit() {
+			if (const char* env = getenv("WURD_TRACE")) {
+				if (*env)
+					Trace::start(env);
+			}
+		}
+	} g_envInit;
+}
+
+atomic<int> Trace::mode_(0);
+
+const char* Trace::stageName(Stage stage) {
+	static const char* const kNames[NUM_STAGES] = {
+		"load", "save", "processKey", "getLines", "spellCheckLine",
+		"spellCheck", "undoGet", "undoApply", "render"
+	};
+	if (stage < 0 || stage >= NUM_STAGES)
+		return "unknown";
+	return kNames[stage];
+}
+
+uint64_t Trace::nowNs() {
+	return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::start(const std::string& outFile) {
+	g_outFile = outFile;
+	// Other threads may be recording, so their buffers are left alone; stop() skips the events
+	// from before this point instead.
+	g_startNs.store(nowNs(), memory_order_release);
+	if (!g_atexitRegistered) {
+		atexit(writeAtExit);
+		g_atexitRegistered = true;
+	}
+	mode_.fetch_or(EVENTS, memory_order_release);
+}
+
+void Trace::startStats() {
+	for (int i = 0; i < NUM_STAGES; i++)
+		g_histograms[i].clear();
+	mode_.fetch_or(STATS, memory_order_release);
+}
+
+void Trace::stopStats() {
+	mode_.fetch_and(~STATS, memory_order_release);
+}
+
+const LatencyHistogram& Trace::histogram(Stage stage) {
+	return g_histograms[stage];
+}
+
+void Trace::begin(Stage stage, uint64_t ns) {
+	if (mode_.load(memory_order_relaxed) & EVENTS)
+		record(stage, 'B', ns);
+}
+
+void Trace::end(Stage stage, uint64_t ns, uint64_t beginNs) {
+	int mode = mode_.load(memory_order_relaxed);
+	if (mode & EVENTS)
+		record(stage, 'E', ns);
+	if (mode & STATS)
+		g_histograms[stage].add(ns - beginNs);
+}
+
+bool Trace::stop() {
+	if (!(mode_.fetch_and(~EVENTS) & EVENTS))
+		return true; // nothing recorded (or already written)
+	FILE* out = fopen(g_outFile.c_str(), "w");
+	if (out == nullptr)
+		return false;
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	uint64_t startNs = g_startNs.load(memory_order_acquire);
+	bool first = true;
+	for (Buffer* b = g_buffers.load(memory_order_acquire); b != nullptr; b = b->next) {
+		uint64_t head = b->head.load(memory_order_acquire);
+		uint64_t capacity = b->mask + 1;
+		uint64_t tail = head > capacity ? head - capacity : 0;
+		fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			first ? "" : ",\n", b->tid, b->tid == 1 ? "main" : "worker");
+		first = false;
+		int depth = 0;
+		for (uint64_t i = tail; i < head; i++) {
+			const Event& e = b->events[i & b->mask];
+			if (e.ts < startNs)
+				continue; // an earlier session's
+			if (e.phase == 'E') {
+				if (depth == 0)
+					continue; // its begin was overwritten when the ring wrapped, or came before start()
+				depth--;
+			}
+			else
+				depth++;
+			fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u}",
+				stageName((Stage)e.stage), e.phase, b->tid,
+				(unsigned long long)((e.ts - startNs) / 1000), (unsigned)((e.ts - startNs) % 1000));
+		}
+	}
+	fprintf(out, "\n]}\n");
+	return fclose(out) == 0;
+}
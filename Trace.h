@@ -0,0 +1,84 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+// Session tracing. When enabled, every TRACE_SCOPE records a begin and an end event into a
+// per-thread ring buffer, and the buffers are written out as Chrome trace-event JSON (open it in
+// chrome://tracing or https://ui.perfetto.dev) when the program exits.
+//
+// Tracing is switched on either by calling Trace::start() or by setting the WURD_TRACE
+// environment variable to the output filename. Independently, Trace::startStats() makes every
+// scope add its duration to a per-stage latency histogram. Define WURD_NO_TRACE to compile the
+// scopes out.
+
+#include "Histogram.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class Trace {
+public:
+	// The stages we know how to time. Keep stageName() in Trace.cpp in the same order.
+	enum Stage {
+		LOAD = 0,
+		SAVE,
+		PROCESS_KEY,
+		GET_LINES,
+		SPELL_CHECK_LINE,
+		SPELL_SUGGEST,
+		UNDO_GET,
+		UNDO_APPLY,
+		RENDER,
+		NUM_STAGES
+	};
+
+	// Begin recording; the trace is written to outFile by stop() or at exit. Other threads may be
+	// tracing meanwhile: events from an earlier session are left out of the new one's file.
+	static void start(const std::string& outFile);
+	// Stop recording and write the trace file. Returns false if the file could not be written.
+	static bool stop();
+	static bool enabled() { return (mode_.load(std::memory_order_relaxed) & EVENTS) != 0; }
+
+	// Collect per-stage latency histograms (cleared by startStats()).
+	static void startStats();
+	static void stopStats();
+	static const LatencyHistogram& histogram(Stage stage);
+
+	static const char* stageName(Stage stage);
+	static uint64_t nowNs(); // nanoseconds since the trace clock's epoch
+
+	static void begin(Stage stage, uint64_t ns);
+	static void end(Stage stage, uint64_t ns, uint64_t beginNs);
+
+	// RAII helper used by TRACE_SCOPE.
+	class Scope {
+	public:
+		Scope(Stage stage) : stage_(stage), mode_(Trace::mode_.load(std::memory_order_relaxed)), begin_(0) {
+			if (mode_) {
+				begin_ = Trace::nowNs();
+				Trace::begin(stage_, begin_);
+			}
+		}
+		~Scope() {
+			if (mode_)
+				Trace::end(stage_, Trace::nowNs(), begin_);
+		}
+	private:
+		Stage stage_;
+		int mode_;
+		uint64_t begin_;
+	};
+
+private:
+	enum Mode { EVENTS = 1, STATS = 2 };
+	static std::atomic<int> mode_;
+};
+
+#ifdef WURD_NO_TRACE
+#define TRACE_SCOPE(stage)
+#else
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(stage) Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(Trace::stage)
+#endif
+
+#endif // TRACE_H_
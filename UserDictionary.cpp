@@ -0,0 +1,108 @@
+#include "UserDictionary.h"
+#include "Lexicon.h"
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+UserDictionary::UserDictionary() : table_(nullptr), count_(0) {
+	tables_.emplace_back(new Table(16));
+	table_.store(tables_.back().get(), memory_order_release);
+}
+
+UserDictionary::~UserDictionary() {
+	// tables and entries release themselves
+}
+
+bool UserDictionary::open(const std::string& file) {
+	lock_guard<mutex> lock(writer_);
+	file_ = file;
+	saved_.clear();
+	ifstream in(file);
+	if (!in)
+		return errno == ENOENT; // a file not written yet is an empty list
+	string line;
+	while (getline(in, line)) {
+		while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+			line.pop_back();
+		if (!line.empty() && insert(line))
+			saved_.insert(lowercase(line));
+	}
+	return true;
+}
+
+bool UserDictionary::add(const std::string& word) {
+	lock_guard<mutex> lock(writer_);
+	if (!insert(word))
+		return false;
+	if (file_.empty() || !saved_.insert(lowercase(word)).second)
+		return true; // only for the session, or already in the file
+	ofstream out(file_, ios::app);
+	out << word << '\n';
+	return (bool)out;
+}
+
+bool UserDictionary::ignore(const std::string& word) {
+	lock_guard<mutex> lock(writer_);
+	return insert(word);
+}
+
+bool UserDictionary::contains(const char* word, size_t length) const {
+	if (count_.load(memory_order_acquire) == 0)
+		return false; // the usual case, without hashing
+	uint64_t h;
+	if (!Lexicon::foldedHash(word, length, h))
+		return false;
+	const Table* t = table_.load(memory_order_acquire);
+	for (size_t i = h & t->mask;; i = (i + 1) & t->mask) {
+		const Entry* e = t->slots[i].load(memory_order_acquire);
+		if (e == nullptr)
+			return false;
+		if (e->hash != h || e->word.size() != length)
+			continue;
+		size_t k = 0;
+		while (k < length && (char)(word[k] | 0x20) == e->word[k]) // word holds only letters and apostrophes
+			k++;
+		if (k == length)
+			return true;
+	}
+}
+
+bool UserDictionary::insert(const std::string& word) {
+	uint64_t h;
+	if (word.empty() || !Lexicon::foldedHash(word.data(), word.size(), h))
+		return false;
+	if (contains(word.data(), word.size()))
+		return true;
+	Entry* entry = new Entry{ h, lowercase(word) };
+	entries_.emplace_back(entry);
+	Table* t = tables_.back().get();
+	size_t count = count_.load(memory_order_relaxed) + 1;
+	if (count * 2 > t->mask + 1) { // keep probes short: at most half full
+		Table* bigger = new Table((t->mask + 1) * 2);
+		for (const unique_ptr<Entry>& e : entries_)
+			place(*bigger, e.get());
+		tables_.emplace_back(bigger);
+		table_.store(bigger, memory_order_release);
+	}
+	else
+		place(*t, entry);
+	count_.store(count, memory_order_release);
+	return true;
+}
+
+std::string UserDictionary::lowercase(std::string word) {
+	for (char& c : word)
+		c = (char)(c | 0x20); // word holds only letters and apostrophes
+	return word;
+}
+
+void UserDictionary::place(Table& table, const Entry* entry) {
+	size_t i = entry->hash & table.mask;
+	while (table.slots[i].load(memory_order_relaxed) != nullptr)
+		i = (i + 1) & table.mask;
+	table.slots[i].store(entry, memory_order_release);
+}
@@ -0,0 +1,70 @@
+#ifndef USERDICTIONARY_H_
+#define USERDICTIONARY_H_
+
+// Words the user has accepted on top of the main dictionary: added ones, which are appended to a
+// file and read back next time, and ignored ones, which last for the session. Words are only
+// ever added, so lookups take no lock and touch no shared counter: the table is open addressed,
+// a word is published with one atomic store into an empty slot, and when the table fills a
+// bigger copy is published in its place. Superseded tables and every word are kept until the
+// dictionary is destroyed, so a reader is never left holding freed memory; with the tables
+// doubling, that costs at most twice the space.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class UserDictionary {
+public:
+	UserDictionary();
+	~UserDictionary();
+
+	// Accept the words listed in file, one per line, and append words add()ed from now on to it.
+	// A file that doesn't exist yet is an empty list. Returns false if it exists but can't be read.
+	bool open(const std::string& file);
+
+	// Accept word for good, writing it to the file if one is open, or (ignore) for this session.
+	// Returns false if word holds a character no word can (see Lexicon) or, for add(), if the file
+	// can't be written, in which case the word is still accepted for the session.
+	bool add(const std::string& word);
+	bool ignore(const std::string& word);
+
+	// Whether word, its letters in either case, has been added or ignored. Safe alongside add()
+	// and ignore() on other threads.
+	bool contains(const char* word, size_t length) const;
+	size_t size() const { return count_.load(std::memory_order_acquire); }
+
+private:
+	struct Entry {
+		uint64_t hash;
+		std::string word; // lowercase
+	};
+	struct Table {
+		explicit Table(size_t slots) : mask(slots - 1), slots(new std::atomic<const Entry*>[slots]) {
+			for (size_t i = 0; i < slots; i++)
+				this->slots[i].store(nullptr, std::memory_order_relaxed);
+		}
+		size_t mask;
+		std::unique_ptr<std::atomic<const Entry*>[]> slots;
+	};
+
+	UserDictionary(const UserDictionary&) = delete;
+	UserDictionary& operator=(const UserDictionary&) = delete;
+
+	bool insert(const std::string& word); // with writer_ held; false if it isn't a word
+	static void place(Table& table, const Entry* entry);
+	static std::string lowercase(std::string word);
+
+	std::atomic<const Table*> table_;
+	std::atomic<size_t> count_;
+	std::mutex writer_;
+	std::vector<std::unique_ptr<Table>> tables_;  // every table published, the current one last
+	std::vector<std::unique_ptr<Entry>> entries_;
+	std::string file_;
+	std::unordered_set<std::string> saved_; // lowercase, the words in file_
+};
+
+#endif // USERDICTIONARY_H_
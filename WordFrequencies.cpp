@@ -0,0 +1,135 @@
+#include "WordFrequencies.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	uint32_t hashOf(const char* word, size_t length) {
+		uint32_t h = 2166136261u; // FNV-1a
+		for (size_t i = 0; i < length; i++)
+			h = (h ^ (unsigned char)word[i]) * 16777619u;
+		return h;
+	}
+
+	int rankOf(uint64_t count) {
+		return 1 + (int)min(254.0, floor(log2((double)count) * 8)); // 1 for a single sighting
+	}
+
+	struct Token {
+		string text;
+		bool number;
+	};
+
+	// Words (letters, lowercased, and apostrophes) and numbers on one line, in order.
+	void tokenize(const string& line, vector<Token>& tokens) {
+		tokens.clear();
+		for (size_t i = 0; i < line.size();) {
+			unsigned char ch = (unsigned char)line[i];
+			if (isdigit(ch)) {
+				size_t j = i;
+				while (j < line.size() && isdigit((unsigned char)line[j]))
+					j++;
+				tokens.push_back({ line.substr(i, j - i), true });
+				i = j;
+			}
+			else if (isalpha(ch) || ch == '\'') {
+				string word;
+				for (; i < line.size() && (isalpha((unsigned char)line[i]) || line[i] == '\''); i++)
+					word += (char)tolower((unsigned char)line[i]);
+				tokens.push_back({ word, false });
+			}
+			else
+				i++;
+		}
+	}
+}
+
+WordFrequencies::WordFrequencies() {
+	clear();
+}
+
+void WordFrequencies::clear() {
+	hashStore_ = vector<uint32_t>();
+	rankStore_ = vector<uint8_t>();
+	hashes_ = hashStore_.data();
+	ranks_ = rankStore_.data();
+	count_ = 0;
+}
+
+bool WordFrequencies::read(const std::string& file, const Lexicon& lexicon) {
+	ifstream in(file);
+	if (!in)
+		return false;
+	unordered_map<string, uint64_t> counts;
+	vector<Token> tokens;
+	string line;
+	while (getline(in, line)) {
+		tokenize(line, tokens);
+		if (tokens.size() == 2 && !tokens[0].number && tokens[1].number) {
+			if (lexicon.contains(tokens[0].text.data(), tokens[0].text.size()))
+				counts[tokens[0].text] += stoull(tokens[1].text.substr(0, 18));
+			continue;
+		}
+		for (Token& t : tokens) {
+			if (t.number)
+				continue;
+			if (!lexicon.contains(t.text.data(), t.text.size())) {
+				// 'quoted' words carry the quotes along
+				size_t begin = t.text.find_first_not_of('\''), end = t.text.find_last_not_of('\'');
+				if (begin == string::npos)
+					continue;
+				t.text = t.text.substr(begin, end + 1 - begin);
+				if (!lexicon.contains(t.text.data(), t.text.size()))
+					continue;
+			}
+			counts[t.text]++;
+		}
+	}
+
+	vector<pair<uint32_t, uint8_t>> entries;
+	entries.reserve(counts.size());
+	for (const pair<const string, uint64_t>& c : counts) {
+		if (c.second > 0)
+			entries.push_back(make_pair(hashOf(c.first.data(), c.first.size()), (uint8_t)rankOf(c.second)));
+	}
+	sort(entries.begin(), entries.end()); // colliding words end up with the last, largest rank
+	vector<uint32_t> hashes;
+	vector<uint8_t> ranks;
+	for (const pair<uint32_t, uint8_t>& e : entries) {
+		if (!hashes.empty() && hashes.back() == e.first)
+			ranks.back() = e.second;
+		else {
+			hashes.push_back(e.first);
+			ranks.push_back(e.second);
+		}
+	}
+	hashStore_.swap(hashes);
+	rankStore_.swap(ranks);
+	hashes_ = hashStore_.data();
+	ranks_ = rankStore_.data();
+	count_ = hashStore_.size();
+	return true;
+}
+
+int WordFrequencies::rank(const char* word, size_t length) const {
+	if (count_ == 0)
+		return 0;
+	uint32_t h = hashOf(word, length);
+	const uint32_t* found = lower_bound(hashes_, hashes_ + count_, h);
+	return found != hashes_ + count_ && *found == h ? ranks_[found - hashes_] : 0;
+}
+
+void WordFrequencies::attach(const uint32_t* hashes, const uint8_t* ranks, size_t count) {
+	hashStore_ = vector<uint32_t>();
+	rankStore_ = vector<uint8_t>();
+	hashes_ = hashes;
+	ranks_ = ranks;
+	count_ = count;
+}
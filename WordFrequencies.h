@@ -0,0 +1,49 @@
+#ifndef WORDFREQUENCIES_H_
+#define WORDFREQUENCIES_H_
+
+// How common each dictionary word is, used to rank suggestions that are equally close. Counts
+// come from a word count list or from plain text and are kept as an 8-bit rank on a log scale,
+// next to a 32-bit hash of the word: two sorted arrays, five bytes per counted word, which a
+// compiled dictionary can carry and attach() can use in place. Two words whose hashes collide
+// share the larger rank, which only ever reorders ties.
+
+#include "Lexicon.h"
+#include <string>
+#include <vector>
+
+class WordFrequencies {
+public:
+	static const int kMaxRank = 255;
+
+	WordFrequencies();
+
+	// Count words from file. A line holding one word and one number counts the word that many
+	// times; any other line counts each of its words once, so a "word count" list and a text
+	// corpus both work. Only words in lexicon are kept. Returns false if file can't be read.
+	bool read(const std::string& file, const Lexicon& lexicon);
+	void clear();
+	bool empty() const { return count_ == 0; }
+
+	// 0 for a word never counted, otherwise 1..kMaxRank, growing with the log of its count.
+	int rank(const char* word, size_t length) const;
+
+	// The arrays: size() hashes in increasing order and the rank of each.
+	const uint32_t* hashArray() const { return hashes_; }
+	const uint8_t* rankArray() const { return ranks_; }
+	size_t size() const { return count_; }
+	// Use arrays saved from another table without copying them; they must outlive this object.
+	void attach(const uint32_t* hashes, const uint8_t* ranks, size_t count);
+	size_t bytes() const { return count_ * (sizeof(uint32_t) + sizeof(uint8_t)); }
+
+private:
+	WordFrequencies(const WordFrequencies&) = delete;
+	WordFrequencies& operator=(const WordFrequencies&) = delete;
+
+	const uint32_t* hashes_;
+	const uint8_t* ranks_;
+	size_t count_;
+	std::vector<uint32_t> hashStore_; // the arrays, unless attached
+	std::vector<uint8_t> rankStore_;
+};
+
+#endif // WORDFREQUENCIES_H_
@@ -0,0 +1,71 @@
+#ifndef WORDTOKENIZER_H_
+#define WORDTOKENIZER_H_
+
+// Splits text into words the way the editor sees them: maximal runs of ASCII letters and
+// apostrophes, everything else (digits, punctuation, bytes above 127) separating them. Words are
+// reported as spans of the text, which is never copied; where SSE2 is available sixteen bytes are
+// classified at once, and the spans read off the mask's bit transitions.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define WORDTOKENIZER_SSE2
+#endif
+
+namespace WordTokenizer {
+	namespace detail {
+		constexpr std::array<bool, 256> makeWordChars() {
+			std::array<bool, 256> table = {};
+			for (int ch = 'a'; ch <= 'z'; ch++)
+				table[ch] = table[ch - 'a' + 'A'] = true;
+			table['\''] = true;
+			return table;
+		}
+		constexpr std::array<bool, 256> kWordChars = makeWordChars();
+	}
+
+	inline bool isWordChar(char ch) { return detail::kWordChars[(unsigned char)ch]; }
+
+	// Call visit(start, length) for each word of text[0, size), in order.
+	template <class Visit>
+	void forEachWord(const char* text, size_t size, Visit visit) {
+		size_t i = 0, start = 0;
+		bool inWord = false;
+#ifdef WORDTOKENIZER_SSE2
+		// (ch | 0x20) lands in 'a'..'z' for letters of either case; adding 0x1f moves that range to
+		// the bottom of the signed bytes, so one signed compare picks out letters.
+		const __m128i lower = _mm_set1_epi8(0x20), shift = _mm_set1_epi8(0x1f);
+		const __m128i limit = _mm_set1_epi8(-128 + 26), apostrophe = _mm_set1_epi8('\'');
+		for (; i + 16 <= size; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(text + i));
+			__m128i letters = _mm_cmplt_epi8(_mm_add_epi8(_mm_or_si128(v, lower), shift), limit);
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(letters, _mm_cmpeq_epi8(v, apostrophe)));
+			uint32_t edges = (mask ^ ((mask << 1) | (inWord ? 1u : 0u))) & 0xffff; // where words start or end
+			for (; edges != 0; edges &= edges - 1) {
+				size_t at = i + __builtin_ctz(edges);
+				if (inWord)
+					visit(start, at - start);
+				else
+					start = at;
+				inWord = !inWord;
+			}
+		}
+#endif
+		for (; i < size; i++) {
+			if (isWordChar(text[i]) == inWord)
+				continue;
+			if (inWord)
+				visit(start, i - start);
+			else
+				start = i;
+			inWord = !inWord;
+		}
+		if (inWord)
+			visit(start, size - start);
+	}
+}
+
+#endif // WORDTOKENIZER_H_
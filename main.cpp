@@ -1,6 +1,13 @@
 #include "TextEditor.h"
 #include "Undo.h"
 #include "SpellCheck.h"
+#include "StudentSpellCheck.h"
+#include "DocumentSpellCheck.h"
+#include "WordTokenizer.h"
+#include "BloomFilter.h"
+#include "Dawg.h"
+#include "AffixDictionary.h"
+#include "DoubleArrayTrie.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -12,12 +19,15 @@
 #include <chrono>
 #include <cstdlib>
 #include <cctype>
+#include <cstring>
 #include <cassert>
+#include <thread>
+#include <atomic>
 using namespace std;
 
-const int NTE = 66;
+const int NTE = 72;
 const int NUN = 23;
-const int NSP = 25;
+const int NSP = 44;
 const int BASETE = 0;
 const int BASEUN = BASETE + NTE;
 const int BASESP = BASEUN + NUN;
@@ -117,31 +127,77 @@ bool load(Ptr& p, string s)  // passed by ref since unique_ptr
 	return ret;
 }
 
+// Resident set size in KB, or -1 where /proc isn't available.
+long residentKB()
+{
+	ifstream statm("/proc/self/statm");
+	long pages, resident;
+	if (!(statm >> pages >> resident))
+		return -1;
+	return resident * 4;
+}
+
+// dictionary.txt if it is in the current directory, else a generated list of similar size.
+string bigDictionary()
+{
+	if (ifstream("dictionary.txt"))
+		return "dictionary.txt";
+	string filename = makefilename();
+	ofstream ofs(filename);
+	unsigned x = 12345;
+	for (int i = 0; i < 100000; i++)
+	{
+		string w;
+		for (int len = 3 + i % 9; len > 0; len--)
+		{
+			x = x * 1103515245 + 12345;
+			w += char('a' + (x >> 16) % 26);
+		}
+		ofs << w << '\n';
+	}
+	return filename;
+}
+
+// Restricted Damerau-Levenshtein distance: substitutions, insertions, deletions and swaps of
+// adjacent characters each cost one.
+int editdist(const string& a, const string& b)
+{
+	vector<vector<int>> d(a.size() + 1, vector<int>(b.size() + 1));
+	for (size_t i = 0; i <= a.size(); i++)
+		d[i][0] = i;
+	for (size_t j = 0; j <= b.size(); j++)
+		d[0][j] = j;
+	for (size_t i = 1; i <= a.size(); i++)
+		for (size_t j = 1; j <= b.size(); j++)
+		{
+			d[i][j] = min(min(d[i - 1][j], d[i][j - 1]) + 1, d[i - 1][j - 1] + (a[i - 1] != b[j - 1]));
+			if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+				d[i][j] = min(d[i][j], d[i - 2][j - 2] + 1);
+		}
+	return d[a.size()][b.size()];
+}
+
+// Each suggestion is a distinct dictionary word one or two edits from w, closer ones come
+// first, and no dictionary word that was left out is closer than one that was included.
 bool goodsuggs(string w, vector<string> suggs, string dict)
 {
+	vector<string> words;
+	for (size_t p = 0, q; (q = dict.find('\n', p)) != string::npos; p = q + 1)
+		words.push_back(dict.substr(p, q - p));
+	int last = 1;
 	for (auto& s : suggs)
 	{
-		if (s.size() != w.size())
-			return false;
 		transform(s.begin(), s.end(), s.begin(), [](char ch) { return tolower(ch); });
-		auto p = mismatch(s.begin(), s.end(), w.begin());
-		if (p.first == s.end())
-			return false;
-		if (!islower(*p.first) && *p.first != '\'')
+		if (find(words.begin(), words.end(), s) == words.end())
 			return false;
-		if (mismatch(++p.first, s.end(), ++p.second).first != s.end())
+		int d = editdist(s, w);
+		if (d < last || d > 2)
 			return false;
-		auto q = dict.begin();
-		for (;;)
-		{
-			q = search(q, dict.end(), s.begin(), s.end());
-			if (q == dict.end())
-				return false;
-			if (*(q + s.size()) == '\n' &&
-				(q == dict.begin() || *(q - 1) == '\n'))
-				break;
-		}
+		last = d;
 	}
+	for (auto& s : words)
+		if (find(suggs.begin(), suggs.end(), s) == suggs.end() && editdist(s, w) < last)
+			return false;
 	sort(suggs.begin(), suggs.end());
 	return adjacent_find(suggs.begin(), suggs.end()) == suggs.end();
 }
@@ -924,6 +980,79 @@ void testTextEditor(int n)
 		assert(r == 0 && c == 1);
 		t->getLines(0, 1, v);
 		assert(v.size() == 1 && v[0] == "XYZW");
+	} break; case BASETE + 67: {
+		// Moving onto a shorter line leaves the cursor at its end, not past it.
+		load(t, "ab\nabcdef\n");
+		t->move(DOWN);
+		t->move(END);
+		t->move(UP);
+		t->getPos(r, c);
+		assert(r == 0 && c == 2);
+		t->insert('X');
+		t->getLines(0, 2, v);
+		assert(v.size() == 2 && v[0] == "abX" && v[1] == "abcdef");
+		load(t, "abcdef\nab\n");
+		t->move(END);
+		t->move(DOWN);
+		t->getPos(r, c);
+		assert(r == 1 && c == 2);
+	} break; case BASETE + 68: {
+		// Undo with nothing to undo changes nothing.
+		load(t, "abc\nde\n");
+		t->move(RIGHT);
+		t->move(DOWN);
+		t->undo();
+		t->getPos(r, c);
+		assert(r == 1 && c == 1);
+		t->getLines(0, 2, v);
+		assert(v.size() == 2 && v[0] == "abc" && v[1] == "de");
+	} break; case BASETE + 69: {
+		// Undoing a join brings back a line that getLines() and the cursor both reach.
+		load(t, "ab\ncd\n");
+		t->move(DOWN);
+		t->backspace();
+		t->getLines(0, 2, v);
+		assert(v.size() == 1 && v[0] == "abcd");
+		t->undo();
+		t->getPos(r, c);
+		assert(r == 0 && c == 2);
+		v.clear();
+		assert(t->getLines(0, 2, v) == 2 && v.size() == 2 && v[0] == "ab" && v[1] == "cd");
+		t->move(DOWN);
+		t->getPos(r, c);
+		assert(r == 1 && c == 2);
+	} break; case BASETE + 70: {
+		// An undo recorded below the last line is applied to the last line.
+		load(t, "ab\ncd\n");
+		u->undos.push(TesterUndo::Op(Undo::Action::DELETE, 7, 1, "X")); // undone by inserting X
+		t->undo();
+		t->getPos(r, c);
+		assert(r == 1 && c == 1);
+		t->getLines(0, 2, v);
+		assert(v.size() == 2 && v[0] == "ab" && v[1] == "Xcd");
+	} break; case BASETE + 71: {
+		// An undo recorded past the end of a line inserts at its end and deletes only what is there.
+		load(t, "ab\n");
+		u->undos.push(TesterUndo::Op(Undo::Action::DELETE, 0, 9, "X"));
+		t->undo();
+		t->getPos(r, c);
+		assert(r == 0 && c == 2);
+		t->getLines(0, 1, v);
+		assert(v.size() == 1 && v[0] == "abX");
+		u->undos.push(TesterUndo::Op(Undo::Action::INSERT, 0, 9, "XYZ")); // undone by deleting three
+		t->undo();
+		t->getPos(r, c);
+		assert(r == 0 && c == 3);
+		v.clear();
+		t->getLines(0, 1, v);
+		assert(v.size() == 1 && v[0] == "abX");
+	} break; case BASETE + 72: {
+		// Undoing a split on the last line has no line below to join.
+		load(t, "ab\ncd\n");
+		u->undos.push(TesterUndo::Op(Undo::Action::SPLIT, 1, 2, " ")); // undone by a join
+		t->undo();
+		t->getLines(0, 2, v);
+		assert(v.size() == 2 && v[0] == "ab" && v[1] == "cd");
 	}
 	}
 }
@@ -1108,6 +1237,40 @@ void testUndo(int n)
 	}
 }
 
+// Append every word of lexicon below node (spelled from prefix) to words, in symbol order.
+void lexiconWords(const Lexicon& lexicon, Lexicon::Node node, string& prefix, vector<string>& words)
+{
+	if (lexicon.isWord(node))
+		words.push_back(prefix);
+	Lexicon::Edge edges[Lexicon::kSymbols];
+	int count = lexicon.children(node, edges);
+	for (int e = 0; e < count; e++) {
+		prefix.push_back(Lexicon::charOf(edges[e].symbol));
+		lexiconWords(lexicon, edges[e].target, prefix, words);
+		prefix.pop_back();
+	}
+}
+
+// A sorted list of up to count made-up words over a-f and apostrophe, so many share prefixes
+// and endings.
+vector<string> madeUpWords(size_t count, unsigned seed)
+{
+	vector<string> words;
+	for (size_t i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		string w;
+		for (int length = 1 + (seed >> 16) % 10; length > 0; length--) {
+			seed = seed * 1103515245 + 12345;
+			int symbol = (seed >> 16) % 7;
+			w += symbol == 6 ? '\'' : (char)('a' + symbol);
+		}
+		words.push_back(w);
+	}
+	sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+	return words;
+}
+
 void testSpellCheck(int n)
 {
 	auto s = unique_ptr<SpellCheck>(createSpellCheck());
@@ -1173,17 +1336,17 @@ void testSpellCheck(int n)
 	} break; case BASESP + 15: {
 		string dict = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\n";
 		load(s, dict);
-		assert(!s->spellCheck("rat", 9, v) && v.size() == 3 &&
+		assert(!s->spellCheck("rat", 9, v) && v.size() == 8 &&
 			goodsuggs("rat", v, dict));
 	} break; case BASESP + 16: {
 		string dict = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\n";
 		load(s, dict);
-		assert(!s->spellCheck("rat", 12, v) && v.size() == 3 &&
+		assert(!s->spellCheck("rat", 12, v) && v.size() == 8 &&
 			goodsuggs("rat", v, dict));
 	} break; case BASESP + 17: {
 		string dict = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\n";
 		load(s, dict);
-		assert(!s->spellCheck("rat", 12, v) && v.size() == 3 &&
+		assert(!s->spellCheck("rat", 12, v) && v.size() == 8 &&
 			goodsuggs("rat", v, dict));
 	} break; case BASESP + 18: {
 		string dict = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\n";
@@ -1220,6 +1383,992 @@ void testSpellCheck(int n)
 		load(s, "can't\n'tis\n");
 		s->spellCheckLine("I can't 'tis cant ", probs);
 		assert(isPerm(probs, { { 0, 0 }, { 13, 16 } }));
+	} break; case BASESP + 26: {
+		// Dawg: the graph holds every word of a sorted list and nothing else, walking it gives the
+		// list back, words with the same ending share nodes, and unsorted lists are refused.
+		vector<string> list = { "can't", "cat", "cats", "dog", "dogs", "talk", "talked", "talking", "talks",
+			"walk", "walked", "walking", "walks" };
+		Dawg dawg;
+		assert(dawg.build(list));
+		for (const string& w : list)
+			assert(dawg.contains(w.data(), w.size()));
+		for (string w : { "", "ca", "can", "catss", "wal", "talke", "walkings", "x" })
+			assert(!dawg.contains(w.data(), w.size()));
+		vector<string> words;
+		string prefix;
+		lexiconWords(dawg, dawg.root(), prefix, words);
+		sort(words.begin(), words.end());
+		assert(words == list);
+		size_t trieNodes = 1;
+		for (size_t i = 0; i < list.size(); i++) {
+			size_t common = 0;
+			while (i > 0 && common < list[i - 1].size() && list[i - 1][common] == list[i][common])
+				common++;
+			trieNodes += list[i].size() - common;
+		}
+		assert(dawg.nodeCount() < trieNodes); // "talk..." and "walk..." share their endings
+
+		vector<string> many = madeUpWords(20000, 7);
+		assert(dawg.build(many));
+		words.clear();
+		lexiconWords(dawg, dawg.root(), prefix, words);
+		sort(words.begin(), words.end());
+		assert(words == many);
+		for (const string& w : many) {
+			string longer = w + "b", shorter = w.substr(0, w.size() - 1);
+			assert(dawg.contains(longer.data(), longer.size()) == binary_search(many.begin(), many.end(), longer));
+			assert(dawg.contains(shorter.data(), shorter.size()) == binary_search(many.begin(), many.end(), shorter));
+		}
+
+		assert(!dawg.build({ "b", "a" }) && !dawg.contains("a", 1) && !dawg.contains("b", 1));
+		assert(!dawg.build({ "a", "a" }));
+		assert(!dawg.build({ "Cat" }));
+	} break; case BASESP + 27: {
+		// DoubleArrayTrie: the same words as a Dawg of the same list, walking it gives the list
+		// back, and unsorted lists are refused.
+		vector<string> list = { "can't", "cat", "cats", "dog", "dogs", "talk", "talked", "talking", "talks",
+			"walk", "walked", "walking", "walks" };
+		DoubleArrayTrie trie;
+		assert(trie.build(list));
+		for (const string& w : list)
+			assert(trie.contains(w.data(), w.size()));
+		for (string w : { "", "ca", "can", "catss", "wal", "talke", "walkings", "x" })
+			assert(!trie.contains(w.data(), w.size()));
+		vector<string> words;
+		string prefix;
+		lexiconWords(trie, trie.root(), prefix, words);
+		sort(words.begin(), words.end());
+		assert(words == list);
+
+		vector<string> many = madeUpWords(50000, 11);
+		Dawg dawg;
+		assert(trie.build(many) && dawg.build(many));
+		words.clear();
+		lexiconWords(trie, trie.root(), prefix, words);
+		sort(words.begin(), words.end());
+		assert(words == many);
+		for (const string& w : many) {
+			string longer = w + "b", shorter = w.substr(0, w.size() - 1);
+			assert(trie.contains(w.data(), w.size()));
+			assert(trie.contains(longer.data(), longer.size()) == dawg.contains(longer.data(), longer.size()));
+			assert(trie.contains(shorter.data(), shorter.size()) == dawg.contains(shorter.data(), shorter.size()));
+		}
+
+		assert(!trie.build({ "b", "a" }) && !trie.contains("a", 1) && !trie.contains("b", 1));
+		assert(!trie.build({ "a", "a" }));
+		assert(!trie.build({ "Cat" }));
+	} break; case BASESP + 28: {
+		// Reloading releases the previous dictionary, so resident memory stays flat.
+		string dict = bigDictionary();
+		StudentSpellCheck trie(StudentSpellCheck::TRIE);
+		long before = -1;
+		for (int i = 0; i < 1000; i++)
+		{
+			assert(trie.load(dict));
+			if (i == 9)
+				before = residentKB();
+		}
+		long after = residentKB();
+		if (dict != "dictionary.txt")
+			remove(dict.c_str());
+		assert(before < 0 || after - before < 4096);
+		trie.spellCheckLine("zzzzqq", probs);
+		assert(trie.dictionaryNodes() > 1 && probs.size() == 1);
+
+		// Two sorted lists run together are sorted again, and an over-long line is skipped rather
+		// than cut short into another word.
+		string joined = makefilename() + ".txt";
+		ofstream(joined) << "apple\nbanana\ncherry\nApple\navocado\nblueberry\n" << string(300, 'x') << "\ndate\n";
+		vector<string> words;
+		assert(StudentSpellCheck::readWords(joined, words));
+		assert(words == vector<string>({ "apple", "avocado", "banana", "blueberry", "cherry", "date" }));
+		remove(joined.c_str());
+	} break; case BASESP + 29: {
+		// The deletion index gives exactly the trie walk's suggestions, ties and all, whether
+		// built on load or mapped from a compiled dictionary.
+		string dict = bigDictionary();
+		string compiled = makefilename() + ".wdict";
+		assert(StudentSpellCheck::compile(dict, compiled, StudentSpellCheck::DAWG, 2));
+		StudentSpellCheck walk, built, mapped;
+		built.setDeletionIndex(true);
+		assert(walk.load(dict) && built.load(dict) && mapped.load(compiled));
+		remove(compiled.c_str());
+		assert(walk.deletionIndexBytes() < 1024 && built.deletionIndexBytes() > 1024 &&
+			mapped.deletionIndexBytes() == built.deletionIndexBytes());
+		for (string w : { "recieve", "teh", "a", "zzzzqq", "wierd", "cant", "dont'", "abcdefghijklmnop", "ab" })
+			for (int d = 1; d <= 2; d++)
+			{
+				walk.setMaxEditDistance(d);
+				built.setMaxEditDistance(d);
+				mapped.setMaxEditDistance(d);
+				vector<string> a, b, c;
+				walk.spellCheck(w, 10, a);
+				built.spellCheck(w, 10, b);
+				mapped.spellCheck(w, 10, c);
+				assert(a == b && a == c);
+			}
+		if (dict != "dictionary.txt")
+			remove(dict.c_str());
+		string small = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\n";
+		StudentSpellCheck* p = &built;
+		built.setMaxEditDistance(2);
+		assert(load(p, small) && !built.spellCheck("rat", 9, v) && v.size() == 8 &&
+			goodsuggs("rat", v, small));
+	} break; case BASESP + 30: {
+		// Fuzzy find lists the word itself first, then everything within the distance.
+		StudentSpellCheck sc;
+		StudentSpellCheck* p = &sc;
+		load(p, "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\nrat\nart\n");
+		vector<Suggestion> m;
+		sc.fuzzyFind("RAT", 1, 100, m);
+		assert(m.size() == 7 && m[0].word == "rat" && m[0].distance == 0);
+		for (size_t i = 1; i < m.size(); i++)
+			assert(m[i].distance == 1 && editdist(m[i].word, "rat") == 1);
+		sc.fuzzyFind("rat", 2, 3, m);
+		assert(m.size() == 3 && m[0].word == "rat");
+		sc.fuzzyFind("rat", 0, 100, m);
+		assert(m.size() == 1);
+		sc.fuzzyFind("xyzzy", 1, 100, m);
+		assert(m.empty());
+	} break; case BASESP + 31: {
+		// With word counts, equally close suggestions come most common first, from a count list,
+		// from plain text, or from a compiled dictionary.
+		string dict = "cat\nrate\nbrat\nrut\nrug\ncar\nset\ndog\nrag\nart\n";
+		load(s, dict);
+		string counts = makefilename() + ".counts";
+		ofstream(counts) << "rag 1000\nrut 10\ncat 5\nzebra 99999\ncar 1000000\n";
+		StudentSpellCheck* sc = (StudentSpellCheck*)s.get();
+		assert(!sc->loadFrequencies("/this/file/does/not/exist") && sc->loadFrequencies(counts));
+		assert(!s->spellCheck("rat", 3, v) && v == vector<string>({ "rag", "rut", "cat" }));
+		assert(!s->spellCheck("rat", 20, v) && v.size() == 9 && v[3] == "art" && v[6] == "car" &&
+			goodsuggs("rat", v, dict));
+		ofstream(counts) << "The brat ate a 'rate' of rut.\nAnother rut, a RUT.\n";
+		assert(sc->loadFrequencies(counts));
+		assert(!s->spellCheck("rat", 3, v) && v == vector<string>({ "rut", "brat", "rate" }));
+		string compiled = makefilename() + ".wdict";
+		string words = makefilename() + ".txt";
+		ofstream(words) << dict;
+		assert(StudentSpellCheck::compile(words, compiled, StudentSpellCheck::DAWG, 0, counts));
+		StudentSpellCheck mapped;
+		assert(mapped.load(compiled) && mapped.frequencyBytes() == 15);
+		assert(!mapped.spellCheck("rat", 3, v) && v == vector<string>({ "rut", "brat", "rate" }));
+		assert(mapped.load(words) && mapped.frequencyBytes() == 0);
+		remove(counts.c_str());
+		remove(compiled.c_str());
+		remove(words.c_str());
+	} break; case BASESP + 32: {
+		// Repeated questions are answered from the cache until the dictionary changes, and the
+		// cache stays consistent while several threads fill and evict it.
+		StudentSpellCheck sc;
+		StudentSpellCheck* p = &sc;
+		load(p, "cat\nrat\ncar\n");
+		vector<string> first, again;
+		assert(!sc.spellCheck("CST", 20, first) && !sc.spellCheck("cst", 20, again) && first == again);
+		assert(sc.spellCheck("cat", 20, v) && sc.spellCheck("Cat", 20, v));
+		assert(!sc.spellCheck("cst", 1, again) && again.size() == 1 && again[0] == first[0]);
+		SuggestionCache::Stats st = sc.suggestionCacheStats();
+		assert(st.hits == 2 && st.misses == 1);
+		load(p, "cast\n");
+		assert(!sc.spellCheck("cst", 20, v) && v == vector<string>({ "cast" }));
+		sc.setMaxEditDistance(0);
+		assert(!sc.spellCheck("cst", 20, v) && v.empty());
+		sc.setMaxEditDistance(2);
+		assert(sc.suggestionCacheStats().hits == 2);
+
+		sc.setSuggestionCacheSize(16);
+		load(p, "cat\nrat\ncar\nbat\nhat\nmat\nsat\npat\nvat\n");
+		vector<string> words = { "cst", "rst", "cbr", "bst", "hst", "mst", "sst", "pst", "vst", "xat",
+			"cat", "rat", "ca", "at", "catt", "tac", "abt", "hta", "mta", "qqq" };
+		vector<vector<string>> expected(words.size());
+		vector<bool> spelled(words.size());
+		{
+			StudentSpellCheck fresh;
+			StudentSpellCheck* f = &fresh;
+			fresh.setSuggestionCacheSize(0);
+			load(f, "cat\nrat\ncar\nbat\nhat\nmat\nsat\npat\nvat\n");
+			for (size_t i = 0; i < words.size(); i++)
+				spelled[i] = fresh.spellCheck(words[i], 3, expected[i]);
+		}
+		vector<thread> threads;
+		vector<int> bad(4, 0);
+		for (int t = 0; t < 4; t++)
+			threads.emplace_back([&, t] {
+				vector<string> got;
+				for (int i = 0; i < 20000; i++)
+				{
+					size_t w = (i * 7 + t * 3) % words.size();
+					got.clear();
+					if (sc.spellCheck(words[w], 3, got) != spelled[w] || (!spelled[w] && got != expected[w]))
+						bad[t]++;
+				}
+			});
+		for (auto& th : threads)
+			th.join();
+		assert(bad == vector<int>(4, 0));
+		st = sc.suggestionCacheStats();
+		assert(st.hits > 0 && st.evictions > 0);
+	} break; case BASESP + 33: {
+		// Lines checked before are answered from the cache, with the same spans, until the
+		// dictionary changes; evicted lines are simply checked again.
+		StudentSpellCheck sc;
+		StudentSpellCheck* p = &sc;
+		load(p, "cat\ndog\n");
+		sc.spellCheckLine("cat dog rat dog bird cat cat caw", probs);
+		vector<SpellCheck::Position> again = { { 0, 0 } };
+		sc.spellCheckLine("cat dog rat dog bird cat cat caw", again);
+		assert(isPerm(probs, { { 8, 10 }, { 16, 19 }, { 29, 31 } }));
+		assert(isPerm(again, { { 0, 0 }, { 8, 10 }, { 16, 19 }, { 29, 31 } }));
+		again.clear();
+		sc.spellCheckLine("cat dog rat dog bird cat cat cat", again); // differs in the last byte
+		assert(isPerm(again, { { 8, 10 }, { 16, 19 } }));
+		LineCache::Stats st = sc.lineCacheStats();
+		assert(st.hits == 1 && st.misses == 2);
+		load(p, "cat\ndog\nrat\nbird\ncaw\n");
+		again.clear();
+		sc.spellCheckLine("cat dog rat dog bird cat cat caw", again);
+		assert(again.empty() && sc.lineCacheStats().hits == 1);
+
+		sc.setLineCacheSize(8);
+		StudentSpellCheck fresh;
+		StudentSpellCheck* f = &fresh;
+		fresh.setLineCacheSize(0);
+		load(f, "cat\ndog\n");
+		load(p, "cat\ndog\n");
+		for (int i = 0; i < 2000; i++)
+		{
+			string line;
+			for (int w = 0; w < 4; w++)
+				line += (i * 7 + w * 13) % 5 == 0 ? "dgo " : (w + i) % 3 ? "cat " : "dog ";
+			line += to_string(i % 40);
+			vector<SpellCheck::Position> a, b;
+			sc.spellCheckLine(line, a);
+			fresh.spellCheckLine(line, b);
+			assert(a.size() == b.size());
+			for (size_t j = 0; j < a.size(); j++)
+				assert(a[j].start == b[j].start && a[j].end == b[j].end);
+		}
+		st = sc.lineCacheStats();
+		assert(st.hits > 0 && st.evictions > 0 && fresh.lineCacheStats().hits == 0);
+	} break; case BASESP + 34: {
+		// The document index checks every line in the background, follows edits (and undone
+		// edits) through the Undo events, and never answers for a line whose text changed.
+		load(s, "cat\ndog\n");
+		DocumentSpellCheck doc(s.get());
+		doc.start({ "cat dog", "rat", "cat cat caw", "" });
+		doc.wait();
+		DocumentSpellCheck::Stats st = doc.stats();
+		assert(st.lines == 4 && st.unchecked == 0 && st.misspellings == 2);
+		assert(doc.find(1, "rat", probs) && isPerm(probs, { { 0, 2 } }));
+		assert(!doc.find(1, "rap", probs) && !doc.find(4, "", probs));
+		doc.edited(Undo::SPLIT, 0);
+		st = doc.stats();
+		assert(st.lines == 5 && st.unchecked == 2 && st.misspellings == 2);
+		probs.clear();
+		assert(!doc.find(0, "cat dog", probs) && doc.find(2, "rat", probs) && probs.size() == 1);
+		doc.edited(Undo::JOIN, 1);
+		doc.edited(Undo::INSERT, 2);
+		st = doc.stats();
+		assert(st.lines == 4 && st.unchecked == 3 && st.misspellings == 0);
+		doc.store(2, "cat cat caw", { { 8, 10 } });
+		assert(doc.stats().misspellings == 1 && doc.stats().unchecked == 2);
+		for (int i = 0; i < 3000; i++)
+			doc.edited(Undo::SPLIT, 0);
+		assert(doc.stats().lines == 3004 && doc.find(3002, "cat cat caw", probs));
+		for (int i = 0; i < 3000; i++)
+			doc.edited(Undo::JOIN, 0);
+		st = doc.stats();
+		assert(st.lines == 4 && st.unchecked == 2 && st.misspellings == 1 && doc.find(2, "cat cat caw", probs));
+
+		// Driven by the editor, while the worker is still going through a long document.
+		string text;
+		for (int i = 0; i < 20000; i++)
+			text += i % 3 ? "cat dog\n" : "dog rat cat\n";
+		DocumentUndo undo(createUndo(), &doc);
+		auto te = unique_ptr<TextEditor>(createTextEditor(&undo));
+		assert(load(te, text));
+		vector<string> lines;
+		te->getLines(0, 1000000, lines);
+		doc.start(lines);
+		for (int i = 0; i < 300; i++)
+		{
+			switch (i % 7)
+			{
+			case 0: te->move(TextEditor::DOWN); te->move(TextEditor::DOWN); break;
+			case 1: te->insert('r'); break;
+			case 2: te->enter(); break;
+			case 3: te->move(TextEditor::END); te->del(); break;
+			case 4: te->move(TextEditor::HOME); te->backspace(); break;
+			case 5: te->undo(); break;
+			case 6: te->move(TextEditor::RIGHT); te->insert('z'); break;
+			}
+		}
+		doc.wait();
+		lines.clear();
+		te->getLines(0, 1000000, lines);
+		assert(doc.stats().lines == lines.size());
+		size_t misspellings = 0;
+		for (size_t r = 0; r < lines.size(); r++)
+		{
+			vector<SpellCheck::Position> found, checked;
+			s->spellCheckLine(lines[r], checked);
+			misspellings += checked.size();
+			if (doc.find((int)r, lines[r], found))
+			{
+				assert(found.size() == checked.size());
+				for (size_t j = 0; j < found.size(); j++)
+					assert(found[j].start == checked[j].start && found[j].end == checked[j].end);
+			}
+			else
+				doc.store((int)r, lines[r], checked);
+		}
+		st = doc.stats();
+		assert(st.unchecked == 0 && st.misspellings == misspellings);
+	} break; case BASESP + 35: {
+		// Next and previous misspelling agree with a scan of the document, wrap around at its
+		// ends, and follow lines as they are split and joined.
+		load(s, "cat\ndog\n");
+		DocumentSpellCheck doc(s.get());
+		int row;
+		SpellCheck::Position found;
+		doc.start({ "cat dog" });
+		doc.wait();
+		assert(!doc.nextMisspelling(0, 0, row, found) && !doc.previousMisspelling(0, 0, row, found));
+		vector<string> lines;
+		for (int i = 0; i < 5000; i++)
+			lines.push_back(i % 97 == 5 ? "cat dgo cat cta" : i % 1013 == 7 ? "xx" : "cat dog");
+		doc.start(lines);
+		doc.wait();
+		auto check = [&]() {
+			vector<pair<int, SpellCheck::Position>> all; // in document order
+			for (size_t r = 0; r < lines.size(); r++)
+			{
+				vector<SpellCheck::Position> p;
+				s->spellCheckLine(lines[r], p);
+				for (const auto& q : p)
+					all.push_back({ (int)r, q });
+			}
+			assert(doc.stats().misspellings == all.size() && !all.empty());
+			for (int t = 0; t < 400; t++)
+			{
+				int r = (t * 7919) % ((int)lines.size() + 2) - 1, c = t % 11;
+				size_t next = 0, prev = all.size() - 1;
+				for (size_t k = 0; k < all.size(); k++)
+				{
+					if (all[k].first > r || (all[k].first == r && all[k].second.start > c))
+					{
+						next = k;
+						break;
+					}
+				}
+				for (size_t k = all.size(); k > 0; k--)
+				{
+					if (all[k - 1].first < r || (all[k - 1].first == r && all[k - 1].second.start < c))
+					{
+						prev = k - 1;
+						break;
+					}
+				}
+				assert(doc.nextMisspelling(r, c, row, found) && row == all[next].first &&
+					found.start == all[next].second.start && found.end == all[next].second.end);
+				assert(doc.previousMisspelling(r, c, row, found) && row == all[prev].first &&
+					found.start == all[prev].second.start && found.end == all[prev].second.end);
+			}
+		};
+		check();
+		auto restore = [&](int r) {
+			vector<SpellCheck::Position> p;
+			s->spellCheckLine(lines[r], p);
+			doc.store(r, lines[r], p);
+		};
+		for (int i = 0; i < 1500; i++)
+		{
+			int r = (i * 31) % 200 + (i % 2) * 3000;
+			doc.edited(Undo::SPLIT, r);
+			lines.insert(lines.begin() + r + 1, i % 5 ? "dog" : "dgo");
+			restore(r);
+			restore(r + 1);
+		}
+		check();
+		for (int i = 0; i < 1400; i++)
+		{
+			int r = (i * 17) % 150;
+			doc.edited(Undo::JOIN, r);
+			lines[r] += lines[r + 1];
+			lines.erase(lines.begin() + r + 1);
+			restore(r);
+		}
+		check();
+	} break; case BASESP + 36: {
+		// A batch gives every line the problems spellCheckLine() would, however many threads share
+		// it out, and the base class's line-by-line version agrees.
+		StudentSpellCheck sc;
+		StudentSpellCheck* p = &sc;
+		load(p, "cat\ndog\n");
+		load(s, "cat\ndog\n");
+		vector<string> lines;
+		for (int i = 0; i < 3000; i++)
+		{
+			string line;
+			for (int w = 0; w < i % 9; w++)
+				line += (i * 7 + w * 13) % 5 == 0 ? "dgo " : (w + i) % 3 ? "cat " : "Dog, ";
+			lines.push_back(line);
+		}
+		vector<SpellCheck::Position> all;
+		vector<size_t> offsets = { 7, 7 };
+		sc.spellCheckLines(lines.data(), 0, all, offsets);
+		assert(all.empty() && offsets.size() == 1 && offsets[0] == 0);
+		for (unsigned threads : { 1u, 4u, 0u })
+		{
+			sc.setThreads(threads);
+			for (size_t count : { (size_t)1, (size_t)200, lines.size() })
+			{
+				sc.spellCheckLines(lines.data(), count, all, offsets);
+				assert(offsets.size() == count + 1 && offsets[0] == 0 && offsets[count] == all.size());
+				for (size_t i = 0; i < count; i++)
+				{
+					vector<SpellCheck::Position> one;
+					s->spellCheckLine(lines[i], one);
+					assert(offsets[i + 1] - offsets[i] == one.size());
+					for (size_t j = 0; j < one.size(); j++)
+						assert(all[offsets[i] + j].start == one[j].start && all[offsets[i] + j].end == one[j].end);
+				}
+			}
+		}
+		vector<SpellCheck::Position> base;
+		vector<size_t> baseOffsets;
+		s->SpellCheck::spellCheckLines(lines.data(), lines.size(), base, baseOffsets);
+		assert(baseOffsets == offsets && base.size() == all.size());
+	} break; case BASESP + 37: {
+		// The tokenizer finds the same words as a byte-at-a-time scan, on either side of its
+		// sixteen-byte blocks; lines are checked in either case, apostrophes and all.
+		const char alphabet[] = "aZq'9 -.\x80\xe1\x92`{@[";
+		unsigned seed = 1;
+		for (int t = 0; t < 3000; t++)
+		{
+			string text;
+			for (int n = t % 70; n > 0; n--)
+			{
+				seed = seed * 1103515245 + 12345;
+				text += alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+			}
+			vector<pair<size_t, size_t>> expected, words;
+			for (size_t i = 0; i < text.size(); )
+			{
+				auto word = [&](char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '\''; };
+				size_t j = i;
+				while (j < text.size() && word(text[j]))
+					j++;
+				if (j > i)
+					expected.push_back({ i, j - i });
+				i = max(j, i + 1);
+			}
+			WordTokenizer::forEachWord(text.data(), text.size(), [&](size_t start, size_t length) {
+				words.push_back({ start, length });
+			});
+			assert(words == expected);
+		}
+		load(s, "don't\nstop\ncat\ndog\n");
+		s->spellCheckLine("Don't STOP, cat\xe9" "dog dont' a", probs);
+		assert(isPerm(probs, { { 20, 24 }, { 26, 26 } }));
+	} break; case BASESP + 38: {
+		// The Bloom filter never turns a word away and lets few others through, and with it, the
+		// perfect hash or both, every backend and a compiled dictionary answer as the lexicon does.
+		string dict = bigDictionary();
+		vector<string> words, misses;
+		assert(StudentSpellCheck::readWords(dict, words));
+		for (size_t i = 0; i < words.size(); i++)
+		{
+			string w = words[i];
+			w[i % w.size()] = w[i % w.size()] == 'q' ? 'z' : 'q';
+			if (!binary_search(words.begin(), words.end(), w))
+				misses.push_back(w);
+			misses.push_back(words[i] + "zq");
+		}
+		Dawg dawg;
+		assert(dawg.build(words));
+		BloomFilter bloom;
+		bloom.build(dawg);
+		size_t through = 0;
+		for (const string& w : words)
+			assert(bloom.mayContain(w.data(), w.size()));
+		for (const string& w : misses)
+			through += bloom.mayContain(w.data(), w.size());
+		assert(through * 50 < misses.size() && !bloom.mayContain("c4t", 3));
+		string compiled = makefilename() + ".wdict";
+		assert(StudentSpellCheck::compile(dict, compiled, StudentSpellCheck::DAWG, 0, "", true, true));
+		for (int variant = 0; variant < 8; variant++)
+		{
+			StudentSpellCheck::Backend backend = variant % 2 ? StudentSpellCheck::DOUBLE_ARRAY : StudentSpellCheck::DAWG;
+			StudentSpellCheck sc(backend);
+			sc.setBloomFilter(variant & 2);
+			sc.setPerfectHash(variant & 4);
+			assert(sc.load(variant == 7 ? compiled : dict));
+			assert((sc.bloomFilterBytes() > 0) == ((variant & 2) != 0) && (sc.perfectHashBytes() > 0) == ((variant & 4) != 0));
+			for (size_t i = 0; i < words.size(); i += 7)
+			{
+				string upper = words[i];
+				for (char& c : upper)
+					c = (char)toupper(c);
+				assert(sc.contains(words[i].data(), words[i].size()) && sc.contains(upper.data(), upper.size()));
+			}
+			for (size_t i = 0; i < misses.size(); i += 7)
+				assert(!sc.contains(misses[i].data(), misses[i].size()));
+			assert(!sc.contains("", 0) && !sc.contains("c4t", 3));
+		}
+		StudentSpellCheck plain;
+		assert(plain.load(compiled) && plain.bloomFilterBytes() > 0 && plain.perfectHashBytes() > 0);
+		assert(plain.load(dict) && plain.bloomFilterBytes() == 0 && plain.perfectHashBytes() == 0);
+		remove(compiled.c_str());
+		if (dict != "dictionary.txt")
+			remove(dict.c_str());
+	} break; case BASESP + 39: {
+		// Added words are correct in any case and come back with the user file; ignored ones last
+		// the session. Accepting a word forgets only the cached answers it changes, takes it off a
+		// document's misspellings, and never holds up a checker on another thread.
+		auto sc = unique_ptr<StudentSpellCheck>(new StudentSpellCheck);
+		assert(load(sc, "cat\ndog\n"));
+		auto known = [&](const string& w) { return sc->contains(w.data(), w.size()); };
+		string user = makefilename() + ".user";
+		assert(sc->loadUserDictionary(user) && !known("zorp"));
+		vector<string> sugg;
+		assert(!sc->spellCheck("zorp", 5, sugg) && !sc->spellCheck("cta", 5, sugg));
+		const char* checked[] = { "cat zorp", "dgo dog", "cat cta" };
+		for (const char* line : checked)
+		{
+			probs.clear();
+			sc->spellCheckLine(line, probs);
+			assert(probs.size() == 1);
+		}
+		sc->resetLineCacheStats();
+		sc->resetSuggestionCacheStats();
+		assert(sc->addWord("Zorp") && sc->ignoreWord("DGO") && !sc->addWord("z0rp") && !sc->addWord(""));
+		assert(known("zorp") && known("ZoRP") && known("dgo") && !known("zor"));
+		for (const char* line : checked)
+		{
+			probs.clear();
+			sc->spellCheckLine(line, probs);
+			assert(probs.size() == (line[4] == 'c' ? 1 : 0));
+		}
+		assert(sc->lineCacheStats().hits == 1 && sc->lineCacheStats().misses == 2); // only cta's line kept
+		probs.clear();
+		sc->spellCheckLine("cat ZORPS", probs);
+		assert(probs.size() == 1);
+		assert(sc->spellCheck("ZORP", 5, sugg) && !sc->spellCheck("cta", 5, sugg));
+		assert(sc->suggestionCacheStats().hits == 1 && sc->suggestionCacheStats().misses == 0);
+		sc->addWord("zorp"); // again, and once in the file
+		sc.reset(new StudentSpellCheck);
+		assert(load(sc, "cat\ndog\n") && sc->loadUserDictionary(user));
+		assert(known("zorp") && !known("dgo"));
+		{
+			ifstream ifs(user);
+			string w;
+			int n = 0;
+			while (getline(ifs, w))
+				n += w == "zorp" || w == "Zorp";
+			assert(n == 1);
+		}
+		assert(sc->loadUserDictionary("/this/directory/does/not/exist/words")); // not written yet
+		assert(!sc->addWord("frob") && known("frob") && known("zorp"));
+
+		DocumentSpellCheck doc(sc.get());
+		vector<string> lines;
+		for (int i = 0; i < 3000; i++)
+			lines.push_back(i % 3 ? "cat blick dog" : "Blick cat frum");
+		doc.start(lines);
+		doc.wait();
+		assert(doc.stats().misspellings == 4000);
+		assert(sc->ignoreWord("blick"));
+		doc.accept("blick");
+		assert(doc.stats().misspellings == 1000);
+		int row;
+		SpellCheck::Position found;
+		assert(doc.nextMisspelling(0, 0, row, found) && row == 0 && found.start == 10);
+		doc.start(lines);
+		sc->ignoreWord("frum"); // perhaps while the worker has a batch out
+		doc.accept("frum");
+		doc.wait();
+		assert(doc.stats().misspellings == 0 && doc.stats().unchecked == 0);
+
+		vector<string> added;
+		for (int i = 0; i < 5000; i++)
+			added.push_back(string("zz") + char('a' + i % 26) + char('a' + i / 26 % 26) + char('a' + i / 676));
+		atomic<bool> done(false);
+		thread reader([&] {
+			// Once a word reads as correct it stays so, through every growth of the table.
+			size_t upTo = 0;
+			while (!done.load()) {
+				while (upTo < added.size() && known(added[upTo]))
+					upTo++;
+				for (size_t i = 0; i < upTo; i += 97)
+					assert(known(added[i]));
+			}
+		});
+		const size_t kRaced = 500; // each costs a round trip between the threads
+		atomic<size_t> ignoring(0), started(SIZE_MAX), finished(SIZE_MAX);
+		thread checker([&] {
+			// Checks the line of each of the first words once, as it is being ignored, so that some
+			// answers are still on their way into the line cache when it is.
+			vector<SpellCheck::Position> p;
+			while (!done.load()) {
+				size_t i = ignoring.load();
+				if (i == started.load()) {
+					this_thread::yield();
+					continue;
+				}
+				started = i;
+				p.clear();
+				sc->spellCheckLine("cat " + added[i], p);
+				finished = i;
+			}
+		});
+		for (size_t i = 0; i < kRaced; i++)
+		{
+			while (started.load() != i)
+				this_thread::yield();
+			assert(sc->ignoreWord(added[i]));
+			while (finished.load() != i)
+				this_thread::yield();
+			vector<SpellCheck::Position> p;
+			sc->spellCheckLine("cat " + added[i], p);
+			assert(p.empty()); // no answer from before the word was ignored was cached after it
+			ignoring = i + 1 < kRaced ? i + 1 : i;
+		}
+		for (size_t i = kRaced; i < added.size(); i++)
+			assert(sc->ignoreWord(added[i]));
+		done = true;
+		reader.join();
+		checker.join();
+		for (const string& w : added)
+			assert(known(w));
+		remove(user.c_str());
+	} break; case BASESP + 40: {
+		// Reloading swaps one whole dictionary for another while other threads go on checking:
+		// every check sees the old dictionary or the new one, never a mixture or a half-built one.
+		string big = bigDictionary();
+		vector<string> words;
+		assert(StudentSpellCheck::readWords(big, words));
+		string first = makefilename() + ".a", second = makefilename() + ".b", compiled = makefilename() + ".wdict";
+		{
+			ofstream a(first), b(second);
+			for (const string& w : words)
+			{
+				if (w != "cat" && w != "dog")
+				{
+					a << w << '\n';
+					b << w << '\n';
+				}
+			}
+			a << "cat\n";
+			b << "dog\n";
+		}
+		assert(StudentSpellCheck::compile(second, compiled, StudentSpellCheck::DOUBLE_ARRAY, 0, "", true, true));
+		StudentSpellCheck sc;
+		assert(sc.load(first) && sc.loadsConcurrently() && sc.loadProgress() == 100);
+		vector<string> lines(300, "cat dog");
+		DocumentSpellCheck doc(&sc);
+		atomic<bool> done(false);
+		atomic<int> checks(0);
+		atomic<int> version(0); // odd while a load is under way
+		atomic<bool> knowsDog(false); // in the dictionary loaded last
+		vector<thread> readers;
+		for (int t = 0; t < 3; t++)
+		{
+			readers.emplace_back([&, t] {
+				vector<SpellCheck::Position> p;
+				vector<size_t> offsets;
+				int round = 0;
+				while (!done.load())
+				{
+					if (t == 0)
+					{
+						// Empty the cache now and then, so that some checks are caught between checking
+						// the line and caching the answer when a load ends, and later ones read it back.
+						if (++round % 16 == 0)
+							sc.setLineCacheSize(LineCache::kDefaultCapacity);
+						p.clear();
+						int before = version.load();
+						bool dog = knowsDog.load();
+						sc.spellCheckLine("cat dog", p);
+						assert(p.size() == 1);
+						// Once a load has returned, every check sees its dictionary, cached or not.
+						if (before % 2 == 0 && version.load() == before)
+							assert(p[0].start == (dog ? 0 : 4));
+					}
+					else if (t == 1)
+					{
+						sc.spellCheckLines(lines.data(), lines.size(), p, offsets);
+						for (size_t i = 0; i < lines.size(); i++)
+							assert(offsets[i + 1] - offsets[i] == 1);
+					}
+					else
+					{
+						vector<string> sugg;
+						assert(sc.contains("zebra", 5) && !sc.contains("cta", 3));
+						sc.spellCheck("cta", 3, sugg);
+						assert(sc.loadProgress() >= 0 && sc.loadProgress() <= 100);
+					}
+					checks++;
+				}
+			});
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			doc.start(lines);
+			int before = checks.load();
+			version++;
+			assert(sc.load(i % 3 == 0 ? second : i % 3 == 1 ? first : compiled));
+			knowsDog = i % 3 != 1;
+			version++;
+			assert(sc.contains("dog", 3) == (i % 3 != 1) && sc.loadProgress() == 100);
+			vector<SpellCheck::Position> p;
+			sc.spellCheckLine("cat dog", p);
+			assert(p.size() == 1 && p[0].start == (i % 3 != 1 ? 0 : 4));
+			while (checks.load() < before + 3)
+				this_thread::yield();
+		}
+		assert(!sc.load("/this/file/does/not/exist") && sc.contains("dog", 3)); // the last one stays
+		done = true;
+		for (thread& t : readers)
+			t.join();
+		doc.start(lines);
+		doc.wait();
+		assert(doc.stats().misspellings == lines.size() && sc.bloomFilterBytes() > 0);
+		remove(first.c_str());
+		remove(second.c_str());
+		remove(compiled.c_str());
+		if (big != "dictionary.txt")
+			remove(big.c_str());
+	} break; case BASESP + 41: {
+		// Stacked dictionaries answer as their union, suggest by distance and then priority, come
+		// and go without disturbing the base, and are shared between spell checkers.
+		string base = makefilename() + ".base", jargon = makefilename() + ".jargon", project = makefilename() + ".project";
+		string compiled = makefilename() + ".wdict";
+		ofstream(base) << "cat\ndog\ncolour\n";
+		ofstream(jargon) << "kubectl\ndogg\n";
+		ofstream(project) << "wurd\ncats\n";
+		assert(StudentSpellCheck::compile(jargon, compiled));
+		StudentSpellCheck sc;
+		assert(sc.load(base) && sc.dictionaryCount() == 1 && sc.prefilterBytes() == 0);
+		assert(sc.addDictionary(jargon, 1) && sc.addDictionary(project, -1) && !sc.addDictionary("/no/such/file", 0));
+		assert(sc.dictionaryCount() == 3 && sc.prefilterBytes() > 0);
+		for (const char* w : { "cat", "DOG", "Kubectl", "wurd", "cats" })
+			assert(sc.contains(w, strlen(w)));
+		for (const char* w : { "ca", "kube", "wurds", "bird" })
+			assert(!sc.contains(w, strlen(w)));
+		sc.spellCheckLine("cat kubectl wurd zzz", probs);
+		assert(probs.size() == 1 && probs[0].start == 17);
+		vector<string> sugg;
+		assert(!sc.spellCheck("dogx", 5, sugg) && sugg.size() == 2 && sugg[0] == "dogg" && sugg[1] == "dog");
+		assert(!sc.spellCheck("catx", 5, sugg) && sugg.size() == 2 && sugg[0] == "cat" && sugg[1] == "cats");
+		assert(!sc.spellCheck("cax", 1, sugg) && sugg.size() == 1 && sugg[0] == "cat");
+		assert(!sc.removeDictionary(base) && !sc.removeDictionary("/no/such/file"));
+		assert(sc.removeDictionary(jargon) && sc.dictionaryCount() == 2 && !sc.contains("kubectl", 7));
+		assert(!sc.spellCheck("dogx", 5, sugg) && sugg.size() == 1 && sugg[0] == "dog");
+		assert(sc.addDictionary(compiled, 2) && sc.contains("kubectl", 7));
+		ofstream(base) << "bird\n";
+		assert(sc.load(base) && sc.dictionaryCount() == 3); // the base is replaced, the rest stay
+		assert(sc.contains("bird", 4) && !sc.contains("cat", 3) && sc.contains("wurd", 4) && sc.contains("dogg", 4));
+
+		// A second spell checker loading the same file, unchanged, uses the first one's dictionary.
+		string big = bigDictionary();
+		StudentSpellCheck first(StudentSpellCheck::TRIE);
+		assert(first.load(big));
+		long before = residentKB();
+		StudentSpellCheck second(StudentSpellCheck::TRIE);
+		assert(second.load(big) && second.contains("zebra", 5) == first.contains("zebra", 5));
+		long shared = residentKB();
+		StudentSpellCheck third(StudentSpellCheck::TRIE);
+		third.setShareDictionaries(false);
+		assert(third.load(big));
+		long separate = residentKB();
+		if (before > 0)
+			assert(shared - before < 2048 && separate - shared > 8192);
+		remove(base.c_str());
+		remove(jargon.c_str());
+		remove(project.c_str());
+		remove(compiled.c_str());
+		if (big != "dictionary.txt")
+			remove(big.c_str());
+	} break; case BASESP + 42: {
+		// Stems and affix rules: words are found through their stems (conditions, strip strings,
+		// a prefix combined with a suffix, NEEDAFFIX), derived rules give back exactly the words,
+		// and load() takes the .dic file.
+		string name = makefilename(), aff = name + ".aff", dic = name + ".dic", compiled = name + ".wdict";
+		ofstream(aff) << "NEEDAFFIX X\n\nPFX U Y 1\nPFX U 0 un .\n\n"
+			"SFX D Y 4\nSFX D 0 ed [^ey]\nSFX D y ied [^aeiou]y\nSFX D 0 ed [aeiou]y\nSFX D 0 d e\n\n"
+			"SFX S N 3\nSFX S y ies [^aeiou]y\nSFX S 0 s [aeiou]y\nSFX S 0 s [^sxzhy]\n";
+		ofstream(dic) << "5\ntry/DS\nWalk/DSU\nbake/D\nplay/DS\nlock/UXD\n";
+		vector<string> expected = { "bake", "baked", "locked", "play", "played", "plays", "tried", "tries", "try",
+			"unlock", "unlocked", "unwalk", "unwalked", "walk", "walked", "walks" };
+		AffixDictionary affixes;
+		assert(affixes.read(aff, dic) && affixes.stemCount() == 5 && affixes.ruleCount() == 8);
+		vector<string> words;
+		affixes.expand(words);
+		assert(words == expected);
+		for (const string& w : expected)
+			assert(affixes.contains(w.data(), w.size()));
+		for (const char* w : { "tryed", "lock", "unwalks", "unbake", "trys", "playd", "walkeds", "un", "" })
+			assert(!affixes.contains(w, strlen(w)));
+		assert(affixes.contains("UnWalked", 8));
+
+		vector<string> list = { "happier", "happy", "jump", "jumped", "jumps", "rework", "talk", "talked", "talks",
+			"walk", "walked", "walks", "work", "works" };
+		assert(affixes.derive(list) && affixes.stemCount() < list.size());
+		affixes.expand(words);
+		assert(words == list);
+		assert(affixes.write(aff, dic));
+		AffixDictionary reread;
+		assert(reread.read(aff, dic) && reread.stemCount() == affixes.stemCount());
+		reread.expand(words);
+		assert(words == list);
+
+		ofstream(aff) << "NEEDAFFIX X\n\nPFX U Y 1\nPFX U 0 un .\n\n"
+			"SFX D Y 4\nSFX D 0 ed [^ey]\nSFX D y ied [^aeiou]y\nSFX D 0 ed [aeiou]y\nSFX D 0 d e\n\n"
+			"SFX S N 3\nSFX S y ies [^aeiou]y\nSFX S 0 s [aeiou]y\nSFX S 0 s [^sxzhy]\n";
+		ofstream(dic) << "5\ntry/DS\nWalk/DSU\nbake/D\nplay/DS\nlock/UXD\n";
+		assert(StudentSpellCheck::readWords(dic, words) && words == expected);
+		StudentSpellCheck sc;
+		vector<string> sugg;
+		assert(sc.load(dic) && sc.spellCheck("Unlocked", 5, sugg) && sc.contains("tries", 5));
+		assert(!sc.spellCheck("wlaked", 5, sugg) && find(sugg.begin(), sugg.end(), "walked") != sugg.end());
+		vector<SpellCheck::Position> probs;
+		sc.spellCheckLine("I tried, unlocked and walkd", probs);
+		assert(probs.size() == 3 && probs[0].start == 0 && probs[1].start == 18 && probs[2].start == 22); // "I", "and", "walkd"
+		string extra = name + ".extra";
+		ofstream(extra) << "jog\n";
+		assert(sc.addDictionary(extra, 1) && sc.prefilterBytes() == 0 && sc.contains("played", 6) && sc.contains("jog", 3));
+		assert(StudentSpellCheck::compile(dic, compiled));
+		StudentSpellCheck flat;
+		assert(flat.load(compiled) && flat.contains("unwalked", 8) && !flat.contains("lock", 4));
+		remove(aff.c_str());
+		remove(dic.c_str());
+		remove(extra.c_str());
+		remove(compiled.c_str());
+	} break; case BASESP + 43: {
+		// Completions: shortest first and then alphabetically, or most common and then alphabetically
+		// once there are counts, from every stacked dictionary and in either case, and the same as
+		// sorting every word with the prefix on a full dictionary.
+		string name = makefilename(), words = name + ".txt", counts = name + ".counts", extra = name + ".extra";
+		ofstream(words) << "car\ncard\ncare\ncared\ncareful\ncart\ncarton\ncat\ndog\n";
+		vector<string> got;
+		for (StudentSpellCheck::Backend backend : { StudentSpellCheck::TRIE, StudentSpellCheck::DAWG,
+			StudentSpellCheck::DOUBLE_ARRAY }) {
+			StudentSpellCheck sc(backend);
+			sc.complete("ca", 5, got);
+			assert(got.empty());
+			assert(sc.load(words));
+			sc.complete("ca", 5, got);
+			assert(got == vector<string>({ "car", "cat", "card", "care", "cart" }));
+			sc.complete("CAR", 10, got);
+			assert(got == vector<string>({ "car", "card", "care", "cart", "cared", "carton", "careful" }));
+			sc.complete("cax", 5, got);
+			assert(got.empty());
+			sc.complete("c-", 5, got);
+			assert(got.empty());
+			sc.complete("", 2, got);
+			assert(got == vector<string>({ "car", "cat" }));
+			ofstream(counts) << "careful 1000\ncart 50\ncar 10\n";
+			assert(sc.loadFrequencies(counts));
+			sc.complete("car", 5, got);
+			assert(got == vector<string>({ "careful", "cart", "car", "card", "care" }) && sc.completionBytes() > 0);
+			sc.complete("car", 3, got, false);
+			assert(got == vector<string>({ "car", "card", "care" }));
+			ofstream(extra) << "carp\ncargo\n";
+			assert(sc.addDictionary(extra, 1));
+			sc.complete("car", 4, got, false);
+			assert(got == vector<string>({ "car", "card", "care", "carp" }));
+			sc.complete("carg", 4, got);
+			assert(got == vector<string>({ "cargo" }));
+			sc.complete("car", 3, got);
+			assert(got == vector<string>({ "careful", "cart", "car" }));
+		}
+
+		StudentSpellCheck sc;
+		vector<string> all;
+		assert(sc.load("dictionary.txt") && StudentSpellCheck::readWords("dictionary.txt", all));
+		ofstream out(counts);
+		for (size_t i = 0; i < all.size(); i += 3)
+			out << all[i] << " " << (i * 7919 % 100000) << "\n";
+		out.close();
+		assert(sc.loadFrequencies(counts));
+		WordFrequencies ranks;
+		Dawg dawg;
+		assert(dawg.build(all) && ranks.read(counts, dawg));
+		for (const char* prefix : { "a", "th", "qu", "pre", "zz", "unde" }) {
+			vector<string> expected;
+			for (const string& w : all) {
+				if (w.compare(0, strlen(prefix), prefix) == 0)
+					expected.push_back(w);
+			}
+			sort(expected.begin(), expected.end(), [](const string& a, const string& b) {
+				return a.size() != b.size() ? a.size() < b.size() : a < b; });
+			expected.resize(min<size_t>(expected.size(), 10));
+			sc.complete(prefix, 10, got, false);
+			assert(got == expected);
+			expected.clear();
+			for (const string& w : all) {
+				if (w.compare(0, strlen(prefix), prefix) == 0)
+					expected.push_back(w);
+			}
+			auto key = [](string w) { replace(w.begin(), w.end(), '\'', '{'); return w; }; // apostrophes after z
+			sort(expected.begin(), expected.end(), [&](const string& a, const string& b) {
+				int ra = ranks.rank(a.data(), a.size()), rb = ranks.rank(b.data(), b.size());
+				return ra != rb ? ra > rb : key(a) < key(b); });
+			expected.resize(min<size_t>(expected.size(), 10));
+			sc.complete(prefix, 10, got);
+			assert(got == expected);
+		}
+		remove(words.c_str());
+		remove(counts.c_str());
+		remove(extra.c_str());
+	} break; case BASESP + 44: {
+		// Compiled dictionaries: each backend's file loads back with the same words, and a file
+		// with a damaged byte, a section running past its end, or cut short is refused, leaving
+		// the dictionary that was loaded before it. Recompiling doesn't disturb one in use.
+		string name = makefilename(), words = name + ".txt", compiled = name + ".wdict", damaged = name + ".bad";
+		string old = name + ".old";
+		ofstream(words) << "apple\nbanana\ncan't\ncherry\n";
+		ofstream(old) << "zebra\n";
+		for (StudentSpellCheck::Backend backend : { StudentSpellCheck::DAWG, StudentSpellCheck::DOUBLE_ARRAY }) {
+			assert(StudentSpellCheck::compile(words, compiled, backend));
+			StudentSpellCheck sc(backend);
+			sc.setShareDictionaries(false);
+			assert(sc.load(compiled));
+			for (string w : { "apple", "Banana", "can't", "cherry" })
+				assert(sc.contains(w.data(), w.size()));
+			for (string w : { "appl", "bananas", "cant", "zebra" })
+				assert(!sc.contains(w.data(), w.size()));
+
+			ifstream in(compiled, ios::binary);
+			string image((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+			auto attempt = [&](const string& bytes) {
+				ofstream(damaged, ios::binary | ios::trunc) << bytes;
+				return sc.load(damaged);
+			};
+			assert(sc.load(old));
+			string bad = image;
+			bad[bad.size() - 1] ^= 0x5a; // fails the checksum
+			assert(!attempt(bad));
+			bad = image;
+			uint64_t huge = 1ULL << 40;
+			memcpy(&bad[56], &huge, sizeof(huge)); // the first section's size, past the end of the file
+			assert(!attempt(bad));
+			assert(!attempt(image.substr(0, image.size() / 2)));
+			assert(!attempt(image.substr(0, 20)));
+			assert(sc.contains("zebra", 5) && !sc.contains("apple", 5));
+			assert(attempt(image) && sc.contains("apple", 5) && !sc.contains("zebra", 5));
+
+			// Compiling over a file that is mapped replaces it and leaves the mapping as it was.
+			assert(sc.load(compiled) && StudentSpellCheck::compile(old, compiled, backend));
+			assert(sc.contains("apple", 5) && !sc.contains("zebra", 5) && !ifstream(compiled + ".tmp"));
+			StudentSpellCheck fresh(backend);
+			fresh.setShareDictionaries(false);
+			assert(fresh.load(compiled) && fresh.contains("zebra", 5) && !fresh.contains("apple", 5));
+		}
+		remove(words.c_str());
+		remove(old.c_str());
+		remove(compiled.c_str());
+		remove(damaged.c_str());
 	}
 	}
 }
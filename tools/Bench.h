@@ -0,0 +1,147 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+// A small benchmark harness for tools/bench.cpp. Each benchmark is a named function that sets up
+// its data and then calls BenchState::run() with the operation to time. The harness warms up,
+// picks a batch size so one repetition takes at least minTimeNs, times several repetitions and
+// summarizes the per-operation time across them. In a WURD_ALLOC_TRACK build it also reports
+// allocations and bytes per operation and the peak live bytes while the repetitions ran.
+
+#include "AllocTrack.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+	int warmup = 2;           // untimed repetitions before measuring
+	int reps = 15;            // timed repetitions
+	uint64_t minTimeNs = 2000000; // target time for one repetition
+	std::string dictionary = "dictionary.txt";
+};
+
+struct BenchStats {
+	double min = 0, median = 0, mean = 0, stddev = 0, p90 = 0, p99 = 0, max = 0;
+
+	static BenchStats of(std::vector<double> v) {
+		BenchStats s;
+		if (v.empty())
+			return s;
+		std::sort(v.begin(), v.end());
+		s.min = v.front();
+		s.max = v.back();
+		s.median = percentile(v, 50);
+		s.p90 = percentile(v, 90);
+		s.p99 = percentile(v, 99);
+		double sum = 0;
+		for (double x : v)
+			sum += x;
+		s.mean = sum / v.size();
+		double sq = 0;
+		for (double x : v)
+			sq += (x - s.mean) * (x - s.mean);
+		s.stddev = v.size() > 1 ? std::sqrt(sq / (v.size() - 1)) : 0;
+		return s;
+	}
+
+	// v must be sorted; linear interpolation between the closest ranks.
+	static double percentile(const std::vector<double>& v, double pct) {
+		if (v.empty())
+			return 0;
+		double rank = pct / 100.0 * (v.size() - 1);
+		size_t lo = (size_t)rank;
+		size_t hi = std::min(lo + 1, v.size() - 1);
+		return v[lo] + (v[hi] - v[lo]) * (rank - lo);
+	}
+};
+
+struct BenchResult {
+	std::string name;
+	long long batch = 0; // operations per repetition
+	int reps = 0;
+	BenchStats nsPerOp;
+	double bytesPerOp = 0; // for MB/s, if the benchmark set it
+	double itemsPerOp = 0; // for items/s (words, lines, ...), if the benchmark set it
+	std::map<std::string, double> counters; // anything else worth reporting
+};
+
+class BenchState {
+public:
+	BenchState(const BenchOptions& options, BenchResult& result)
+		: options_(options), result_(result) { }
+
+	const BenchOptions& options() const { return options_; }
+
+	// Time op. reset (untimed) runs before every repetition to restore the starting state;
+	// maxBatch caps the operations per repetition for benchmarks that consume their input.
+	void run(const std::function<void()>& op, const std::function<void()>& reset = nullptr,
+		long long maxBatch = 1LL << 30) {
+		typedef std::chrono::steady_clock Clock;
+		long long batch = 1;
+		// Grow the batch until one repetition takes minTimeNs; this doubles as warmup.
+		for (;;) {
+			if (reset)
+				reset();
+			Clock::time_point t0 = Clock::now();
+			for (long long i = 0; i < batch; i++)
+				op();
+			uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+			if (ns >= options_.minTimeNs || batch >= maxBatch)
+				break;
+			long long grow = ns == 0 ? batch * 10 : (long long)(batch * (double)options_.minTimeNs / ns * 1.2) + 1;
+			batch = std::min(maxBatch, std::max(batch * 2, grow));
+		}
+		for (int w = 0; w < options_.warmup; w++) {
+			if (reset)
+				reset();
+			for (long long i = 0; i < batch; i++)
+				op();
+		}
+		std::vector<double> samples;
+		uint64_t allocations = 0, allocBytes = 0;
+		int64_t peak = 0;
+		for (int r = 0; r < options_.reps; r++) {
+			if (reset)
+				reset();
+			AllocTrack::resetPeaks();
+			AllocTrack::Counts before = AllocTrack::total();
+			Clock::time_point t0 = Clock::now();
+			for (long long i = 0; i < batch; i++)
+				op();
+			double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+			samples.push_back(ns / batch);
+			AllocTrack::Counts after = AllocTrack::total();
+			allocations += after.allocations - before.allocations;
+			allocBytes += after.bytes - before.bytes;
+			peak = std::max(peak, after.peakBytes - before.liveBytes);
+		}
+		result_.batch = batch;
+		result_.reps = options_.reps;
+		result_.nsPerOp = BenchStats::of(samples);
+		if (AllocTrack::enabled()) {
+			double ops = (double)batch * options_.reps;
+			counter("allocs/op", allocations / ops);
+			counter("alloc_bytes/op", allocBytes / ops);
+			counter("peak_live_bytes", (double)peak);
+		}
+	}
+
+	void setBytesPerOp(double bytes) { result_.bytesPerOp = bytes; }
+	void setItemsPerOp(double items) { result_.itemsPerOp = items; }
+	void counter(const std::string& name, double value) { result_.counters[name] = value; }
+
+private:
+	const BenchOptions& options_;
+	BenchResult& result_;
+};
+
+struct Benchmark {
+	std::string name;
+	std::function<void(BenchState&)> fn;
+};
+
+#endif // BENCH_H_
@@ -0,0 +1,43 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+// Deterministic random numbers for the tools. Unlike the <random> distributions, which are
+// implementation defined, the same seed produces the same data on every compiler and platform.
+
+#include <cstdint>
+
+class Rng {
+public:
+	explicit Rng(uint64_t seed) {
+		// splitmix64 so that nearby seeds give unrelated streams
+		uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		s_ = (z ^ (z >> 31)) | 1;
+	}
+
+	uint64_t next() { // xorshift64
+		s_ ^= s_ << 13;
+		s_ ^= s_ >> 7;
+		s_ ^= s_ << 17;
+		return s_;
+	}
+
+	int below(int n) { return n <= 0 ? 0 : (int)(next() % (uint64_t)n); }
+	int between(int lo, int hi) { return lo + below(hi - lo + 1); } // inclusive
+	double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); } // [0, 1)
+	bool chance(double p) { return uniform() < p; }
+
+	// Approximately normal (sum of twelve uniforms), which avoids libm differences.
+	double normal(double mean, double sd) {
+		double sum = 0;
+		for (int i = 0; i < 12; i++)
+			sum += uniform();
+		return mean + (sum - 6.0) * sd;
+	}
+
+private:
+	uint64_t s_;
+};
+
+#endif // RNG_H_
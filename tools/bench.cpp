@@ -0,0 +1,1084 @@
+// Benchmarks for the text editor, undo and spell checker.
+//
+//     bench [--filter text] [--reps n] [--warmup n] [--min-time-ms n] [--dict path] [--json out.json] [--list]
+//     bench --compare base.json new.json
+//
+// Run it from the directory that holds dictionary.txt (or pass --dict). Build like the tester:
+//     g++ -std=c++17 -O2 -pthread -I. tools/bench.cpp $(ls *.cpp | grep -v main.cpp) -o bench
+
+#include "Bench.h"
+#include "Rng.h"
+#include "TextEditor.h"
+#include "Undo.h"
+#include "SpellCheck.h"
+#include "StudentSpellCheck.h"
+#include "AffixDictionary.h"
+#include "DocumentSpellCheck.h"
+#include "WordTokenizer.h"
+#include "LevenshteinAutomaton.h"
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace {
+	const char* const kDocFile = "bench_doc.tmp";
+	const char* const kSaveFile = "bench_save.tmp";
+
+	vector<string> readWords(const string& file) {
+		vector<string> words;
+		ifstream in(file);
+		string s;
+		while (getline(in, s)) {
+			if (!s.empty() && s.back() == '\r')
+				s.pop_back();
+			if (!s.empty())
+				words.push_back(s);
+		}
+		return words;
+	}
+
+	const vector<string>& dictionaryWords(const BenchOptions& opt) {
+		static vector<string> words;
+		if (words.empty()) {
+			words = readWords(opt.dictionary);
+			if (words.empty()) {
+				cerr << "Unable to read " << opt.dictionary << " (use --dict)" << endl;
+				exit(1);
+			}
+		}
+		return words;
+	}
+
+	// Every stride-th dictionary word.
+	vector<string> sampleWords(const BenchOptions& opt, size_t stride) {
+		const vector<string>& all = dictionaryWords(opt);
+		vector<string> out;
+		for (size_t i = 0; i < all.size(); i += stride)
+			out.push_back(all[i]);
+		return out;
+	}
+
+	// Words that are not in the dictionary: each sampled word with one letter replaced.
+	vector<string> misspelledWords(const BenchOptions& opt, size_t stride, SpellCheck* sc) {
+		vector<string> out;
+		Rng rng(7);
+		vector<string> none;
+		for (string w : sampleWords(opt, stride)) {
+			w[rng.below((int)w.size())] = 'a' + rng.below(26);
+			if (!sc->spellCheck(w, 0, none))
+				out.push_back(w);
+		}
+		return out;
+	}
+
+	// Misspellings made from every stride-th dictionary word by `edits` random substitutions,
+	// insertions, deletions or adjacent swaps, keeping only the ones that aren't words.
+	vector<string> misspellingCorpus(const BenchOptions& opt, size_t stride, int edits, SpellCheck* sc) {
+		vector<string> out;
+		Rng rng(19);
+		vector<string> none;
+		for (string w : sampleWords(opt, stride)) {
+			for (int e = 0; e < edits; e++) {
+				int at = rng.below((int)w.size());
+				switch (rng.below(4)) {
+				case 0: w[at] = 'a' + rng.below(26); break;
+				case 1: w.insert(w.begin() + at, (char)('a' + rng.below(26))); break;
+				case 2: if (w.size() > 1) w.erase(at, 1); break;
+				case 3: if (at + 1 < (int)w.size()) swap(w[at], w[at + 1]); break;
+				}
+			}
+			if (!sc->spellCheck(w, 0, none))
+				out.push_back(w);
+		}
+		return out;
+	}
+
+	// A line of text like the ones the GUI spell checks: dictionary words, punctuation and
+	// roughly one misspelling in eight words.
+	string makeLine(const vector<string>& words, Rng& rng, size_t length) {
+		string line;
+		while (line.size() < length) {
+			string w = words[rng.below((int)words.size())];
+			if (rng.below(8) == 0)
+				w[rng.below((int)w.size())] = 'a' + rng.below(26);
+			if (rng.below(10) == 0)
+				w[0] = (char)toupper(w[0]);
+			line += w;
+			line += rng.below(6) == 0 ? ", " : " ";
+		}
+		return line;
+	}
+
+	void writeDocument(const BenchOptions& opt, const string& file, int lines, size_t length) {
+		Rng rng(42);
+		ofstream out(file);
+		const vector<string>& words = dictionaryWords(opt);
+		for (int i = 0; i < lines; i++)
+			out << makeLine(words, rng, length) << '\n';
+	}
+
+	struct EditorFixture {
+		unique_ptr<Undo> undo;
+		unique_ptr<TextEditor> editor;
+		EditorFixture() : undo(createUndo()), editor(createTextEditor(undo.get())) { }
+	};
+
+	struct SpellFixture {
+		unique_ptr<SpellCheck> sc;
+		explicit SpellFixture(const BenchOptions& opt) : sc(createSpellCheck()) {
+			if (!sc->load(opt.dictionary)) {
+				cerr << "Unable to load " << opt.dictionary << endl;
+				exit(1);
+			}
+		}
+	};
+
+	// Place the cursor on row, col with the editor's own movement keys.
+	void moveTo(TextEditor* te, int row, int col) {
+		te->move(TextEditor::HOME);
+		int r, c;
+		te->getPos(r, c);
+		while (r < row) {
+			te->move(TextEditor::DOWN);
+			te->getPos(r, c);
+		}
+		te->move(TextEditor::HOME);
+		for (int i = 0; i < col; i++)
+			te->move(TextEditor::RIGHT);
+	}
+
+	// ---- StudentTextEditor ----
+
+	void benchEditorLoad(BenchState& s) {
+		writeDocument(s.options(), kDocFile, 20000, 60);
+		EditorFixture f;
+		ifstream in(kDocFile, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { f.editor->load(kDocFile); });
+	}
+
+	void benchEditorSave(BenchState& s) {
+		writeDocument(s.options(), kDocFile, 20000, 60);
+		EditorFixture f;
+		f.editor->load(kDocFile);
+		ifstream in(kDocFile, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { f.editor->save(kSaveFile); });
+	}
+
+	// Type characters at a fixed spot of an 80 column line; where = 0 head, 1 middle, 2 end.
+	void benchEditorInsert(BenchState& s, int where) {
+		writeDocument(s.options(), kDocFile, 200, 80);
+		EditorFixture f;
+		s.run([&] { f.editor->insert('x'); }, [&] {
+			f.editor->load(kDocFile);
+			moveTo(f.editor.get(), 100, 0);
+			if (where == 1)
+				moveTo(f.editor.get(), 100, 40);
+			else if (where == 2)
+				f.editor->move(TextEditor::END);
+		}, 20000);
+	}
+
+	void benchEditorEnter(BenchState& s) {
+		writeDocument(s.options(), kDocFile, 200, 80);
+		EditorFixture f;
+		s.run([&] {
+			f.editor->enter();
+			for (int i = 0; i < 8; i++)
+				f.editor->move(TextEditor::RIGHT);
+		}, [&] {
+			f.editor->load(kDocFile);
+			moveTo(f.editor.get(), 0, 8);
+		}, 150);
+	}
+
+	// Backspace at the start of a line joins it onto the line above.
+	void benchEditorBackspaceJoin(BenchState& s) {
+		const int kLines = 20000;
+		writeDocument(s.options(), kDocFile, kLines, 20);
+		EditorFixture f;
+		s.run([&] {
+			f.editor->move(TextEditor::HOME);
+			f.editor->backspace();
+		}, [&] {
+			f.editor->load(kDocFile);
+			moveTo(f.editor.get(), kLines - 1, 0);
+		}, kLines - 1);
+	}
+
+	void benchEditorGetLines(BenchState& s, int depth) {
+		writeDocument(s.options(), kDocFile, 100000, 60);
+		EditorFixture f;
+		f.editor->load(kDocFile);
+		vector<string> lines;
+		s.setItemsPerOp(60);
+		s.run([&] {
+			lines.clear();
+			f.editor->getLines(depth, 60, lines);
+		});
+	}
+
+	// ---- StudentUndo ----
+
+	// A 64 character typing burst followed by an enter, which ends the batch.
+	void benchUndoSubmitBatched(BenchState& s) {
+		unique_ptr<Undo> u(createUndo());
+		int row = 0;
+		s.setItemsPerOp(65);
+		s.run([&] {
+			for (int col = 1; col <= 64; col++)
+				u->submit(Undo::INSERT, row, col, 'a');
+			u->submit(Undo::SPLIT, row, 64);
+			row++;
+		}, [&] {
+			u->clear();
+			row = 0;
+		}, 2000);
+	}
+
+	// Backspacing through a line, which batches DELETEs.
+	void benchUndoSubmitDeletes(BenchState& s) {
+		unique_ptr<Undo> u(createUndo());
+		int row = 0;
+		s.setItemsPerOp(65);
+		s.run([&] {
+			for (int col = 64; col >= 1; col--)
+				u->submit(Undo::DELETE, row, col, 'a');
+			u->submit(Undo::JOIN, row, 0);
+			row++;
+		}, [&] {
+			u->clear();
+			row = 0;
+		}, 2000);
+	}
+
+	void benchUndoGet(BenchState& s) {
+		const int kDepth = 100000;
+		unique_ptr<Undo> u(createUndo());
+		int r, c, n;
+		string text;
+		s.run([&] { u->get(r, c, n, text); }, [&] {
+			u->clear();
+			for (int i = 0; i < kDepth; i++)
+				u->submit(i % 2 ? Undo::SPLIT : Undo::JOIN, i, 0);
+		}, kDepth);
+	}
+
+	void benchUndoClearDeep(BenchState& s, int depth) {
+		unique_ptr<Undo> u(createUndo());
+		s.setItemsPerOp(depth);
+		s.run([&] { u->clear(); }, [&] {
+			for (int i = 0; i < depth; i++)
+				u->submit(i % 2 ? Undo::SPLIT : Undo::JOIN, i, 0);
+		}, 1);
+	}
+
+	// ---- StudentSpellCheck ----
+
+	void benchSpellLoad(BenchState& s) {
+		unique_ptr<SpellCheck> sc(createSpellCheck());
+		ifstream in(s.options().dictionary, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { sc->load(s.options().dictionary); });
+	}
+
+	void benchSpellCheckHit(BenchState& s) {
+		SpellFixture f(s.options());
+		vector<string> words = sampleWords(s.options(), 7);
+		vector<string> suggestions;
+		size_t i = 0;
+		s.run([&] { f.sc->spellCheck(words[i++ % words.size()], 0, suggestions); });
+	}
+
+	void benchSpellCheckMiss(BenchState& s, int maxSuggestions) {
+		SpellFixture f(s.options());
+		vector<string> words = misspelledWords(s.options(), 37, f.sc.get());
+		vector<string> suggestions;
+		size_t i = 0;
+		s.run([&] {
+			suggestions.clear();
+			f.sc->spellCheck(words[i++ % words.size()], maxSuggestions, suggestions);
+		});
+	}
+
+	// The GUI's pattern: suggestions for the misspelled word under the cursor on every redraw,
+	// so each word is asked about several times in a row before the cursor moves on.
+	void benchSpellCursorWord(BenchState& s, size_t cacheEntries) {
+		StudentSpellCheck sc;
+		sc.setSuggestionCacheSize(cacheEntries);
+		sc.load(s.options().dictionary);
+		vector<string> words = misspellingCorpus(s.options(), 37, 1, &sc);
+		vector<string> suggestions;
+		size_t i = 0;
+		sc.resetSuggestionCacheStats();
+		s.run([&] { sc.spellCheck(words[i++ / 8 % words.size()], 20, suggestions); });
+		SuggestionCache::Stats st = sc.suggestionCacheStats();
+		if (st.hits + st.misses > 0)
+			s.counter("hit_rate", (double)st.hits / (st.hits + st.misses));
+	}
+
+	void benchSpellCheckLine(BenchState& s) {
+		SpellFixture f(s.options());
+		Rng rng(3);
+		vector<string> lines;
+		size_t bytes = 0;
+		for (int i = 0; i < 1000; i++) {
+			lines.push_back(makeLine(dictionaryWords(s.options()), rng, 80));
+			bytes += lines.back().size();
+		}
+		vector<SpellCheck::Position> problems;
+		size_t i = 0;
+		s.setBytesPerOp((double)bytes / lines.size());
+		s.run([&] {
+			problems.clear();
+			f.sc->spellCheckLine(lines[i++ % lines.size()], problems);
+		});
+	}
+
+	// One redraw per op while the view scrolls down a row at a time (an arrow key held at the
+	// bottom of the screen): every visible row is checked, as produceBadPattern() does, and all
+	// but one of them were on the screen the frame before.
+	void benchSpellScrollFrame(BenchState& s, size_t cachedLines) {
+		const int kRows = 60;
+		StudentSpellCheck sc;
+		sc.setLineCacheSize(cachedLines);
+		sc.load(s.options().dictionary);
+		Rng rng(5);
+		vector<string> lines;
+		for (int i = 0; i < 5000; i++)
+			lines.push_back(makeLine(dictionaryWords(s.options()), rng, 70));
+		vector<SpellCheck::Position> problems;
+		size_t top = 0;
+		sc.resetLineCacheStats();
+		s.run([&] {
+			for (int r = 0; r < kRows; r++) {
+				problems.clear();
+				sc.spellCheckLine(lines[(top + r) % lines.size()], problems);
+			}
+			top++;
+		});
+		LineCache::Stats st = sc.lineCacheStats();
+		if (st.hits + st.misses > 0)
+			s.counter("checks_avoided_per_frame", (double)st.hits * kRows / (st.hits + st.misses));
+	}
+
+	// A document of lines like the ones makeLine() writes, shared by the document benchmarks.
+	const vector<string>& documentLines(const BenchOptions& opt, size_t count) {
+		static vector<string> lines;
+		if (lines.size() < count) {
+			Rng rng(23);
+			while (lines.size() < count)
+				lines.push_back(makeLine(dictionaryWords(opt), rng, 60));
+		}
+		return lines;
+	}
+
+	// About 100 MB of text: one op splits every line into words, or with check set also looks
+	// each of them up, on one thread. Items are words.
+	void benchSpellText(BenchState& s, bool check) {
+		const size_t kLines = 1750000;
+		StudentSpellCheck sc;
+		sc.setLineCacheSize(0);
+		sc.setThreads(1);
+		sc.load(s.options().dictionary);
+		const vector<string>& lines = documentLines(s.options(), kLines);
+		size_t bytes = 0, words = 0;
+		for (size_t i = 0; i < kLines; i++) {
+			bytes += lines[i].size();
+			WordTokenizer::forEachWord(lines[i].data(), lines[i].size(), [&](size_t, size_t) { words++; });
+		}
+		vector<SpellCheck::Position> problems;
+		vector<size_t> offsets;
+		size_t found = 0;
+		s.setBytesPerOp((double)bytes);
+		s.setItemsPerOp((double)words);
+		s.run([&] {
+			if (check) {
+				sc.spellCheckLines(lines.data(), kLines, problems, offsets);
+				return;
+			}
+			found = 0;
+			for (size_t i = 0; i < kLines; i++)
+				WordTokenizer::forEachWord(lines[i].data(), lines[i].size(), [&](size_t, size_t length) { found += length; });
+		}, nullptr, 1);
+		if (!check)
+			s.counter("letters", (double)found);
+	}
+
+	// One op checks a 200,000-line (about 12 MB) document in a single spellCheckLines() batch over
+	// the given number of threads, or with threads 0, one spellCheckLine() call per line as before.
+	void benchSpellCheckLines(BenchState& s, unsigned threads) {
+		const size_t kLines = 200000;
+		StudentSpellCheck sc;
+		sc.setLineCacheSize(0);
+		sc.setThreads(threads);
+		sc.load(s.options().dictionary);
+		const vector<string>& lines = documentLines(s.options(), kLines);
+		size_t bytes = 0;
+		for (size_t i = 0; i < kLines; i++)
+			bytes += lines[i].size();
+		vector<SpellCheck::Position> problems;
+		vector<size_t> offsets;
+		s.setBytesPerOp((double)bytes);
+		s.setItemsPerOp((double)kLines);
+		s.run([&] {
+			if (threads > 0) {
+				sc.spellCheckLines(lines.data(), kLines, problems, offsets);
+				return;
+			}
+			problems.clear();
+			for (size_t i = 0; i < kLines; i++)
+				sc.spellCheckLine(lines[i], problems);
+		}, nullptr, 1);
+		s.counter("misspellings", (double)problems.size());
+	}
+
+	// The background spell check of a whole document: from start() until every line is checked.
+	void benchDocumentCheck(BenchState& s, size_t count) {
+		StudentSpellCheck sc;
+		sc.load(s.options().dictionary);
+		DocumentSpellCheck doc(&sc);
+		vector<string> lines(documentLines(s.options(), count).begin(), documentLines(s.options(), count).begin() + count);
+		vector<string> copy;
+		s.setItemsPerOp((double)count);
+		s.run([&] {
+			doc.start(move(copy));
+			doc.wait();
+		}, [&] { copy = lines; }, 1);
+		s.counter("misspellings", (double)doc.stats().misspellings);
+	}
+
+	// What loading a document costs the GUI thread before it can draw: indexing the lines and
+	// starting the worker.
+	void benchDocumentStart(BenchState& s, size_t count) {
+		StudentSpellCheck sc;
+		sc.load(s.options().dictionary);
+		DocumentSpellCheck doc(&sc);
+		vector<string> lines(documentLines(s.options(), count).begin(), documentLines(s.options(), count).begin() + count);
+		vector<string> copy;
+		s.run([&] { doc.start(move(copy)); }, [&] {
+			doc.stop();
+			copy = lines;
+		}, 1);
+	}
+
+	// Enter and then backspace in the middle of a checked document: the index inserts an entry
+	// and removes it again, and every other line keeps its result.
+	void benchDocumentSplitJoin(BenchState& s, size_t count) {
+		StudentSpellCheck sc;
+		sc.load(s.options().dictionary);
+		DocumentSpellCheck doc(&sc);
+		doc.start(vector<string>(documentLines(s.options(), count).begin(), documentLines(s.options(), count).begin() + count));
+		doc.wait();
+		int row = (int)count / 2;
+		s.run([&] {
+			doc.edited(Undo::SPLIT, row);
+			doc.edited(Undo::JOIN, row);
+		});
+	}
+
+	// Jumping to the next misspelling from rows spread over a checked document.
+	void benchDocumentNextMisspelling(BenchState& s, size_t count) {
+		StudentSpellCheck sc;
+		sc.load(s.options().dictionary);
+		DocumentSpellCheck doc(&sc);
+		doc.start(vector<string>(documentLines(s.options(), count).begin(), documentLines(s.options(), count).begin() + count));
+		doc.wait();
+		int row = 0, found;
+		SpellCheck::Position p;
+		s.run([&] {
+			doc.nextMisspelling(row, 0, found, p);
+			row = (int)((row + 7919) % count);
+		});
+	}
+
+	// Load time and size of one dictionary backend.
+	void benchSpellLoadBackend(BenchState& s, StudentSpellCheck::Backend backend) {
+		StudentSpellCheck sc(backend);
+		sc.setShareDictionaries(false); // build it every time, rather than finding the one loaded
+		ifstream in(s.options().dictionary, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { sc.load(s.options().dictionary); }, nullptr, backend == StudentSpellCheck::TRIE ? 3 : 1LL << 30);
+		s.counter("nodes", (double)sc.dictionaryNodes());
+		s.counter("bytes", (double)sc.dictionaryBytes());
+	}
+
+	// Time to ready for a dictionary compiled from the word list, with a deletion index if
+	// deletionDistance is positive.
+	void benchSpellLoadCompiled(BenchState& s, StudentSpellCheck::Backend backend, int deletionDistance = 0) {
+		const char* const kCompiled = "bench_dict.tmp";
+		if (!StudentSpellCheck::compile(s.options().dictionary, kCompiled, backend, deletionDistance)) {
+			cerr << "Unable to compile " << s.options().dictionary << endl;
+			exit(1);
+		}
+		StudentSpellCheck sc(backend);
+		sc.setShareDictionaries(false);
+		ifstream in(kCompiled, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { sc.load(kCompiled); });
+		s.counter("nodes", (double)sc.dictionaryNodes());
+		s.counter("bytes", (double)sc.dictionaryBytes());
+		if (deletionDistance > 0)
+			s.counter("index_bytes", (double)sc.deletionIndexBytes());
+		remove(kCompiled);
+	}
+
+	// Load time when the deletion index is built from the word list.
+	void benchSpellLoadDeletionIndex(BenchState& s) {
+		StudentSpellCheck sc;
+		sc.setDeletionIndex(true);
+		sc.setShareDictionaries(false);
+		ifstream in(s.options().dictionary, ios::binary | ios::ate);
+		s.setBytesPerOp((double)in.tellg());
+		s.run([&] { sc.load(s.options().dictionary); }, nullptr, 3);
+		s.counter("index_bytes", (double)sc.deletionIndexBytes());
+	}
+
+	// Membership of every dictionary word, alternating with misses. Each word is checked as a
+	// one-word line so the suggestion search for misses isn't timed (and without the line cache,
+	// which would only add a miss to each).
+	void benchSpellLookupBackend(BenchState& s, StudentSpellCheck::Backend backend) {
+		StudentSpellCheck sc(backend);
+		sc.setLineCacheSize(0);
+		sc.load(s.options().dictionary);
+		const vector<string>& hits = dictionaryWords(s.options());
+		vector<string> misses = misspelledWords(s.options(), 1, &sc);
+		vector<string> words;
+		for (size_t i = 0; i < hits.size(); i++) {
+			words.push_back(hits[i]);
+			words.push_back(misses[i % misses.size()]);
+		}
+		vector<SpellCheck::Position> problems;
+		size_t i = 0;
+		s.run([&] {
+			problems.clear();
+			sc.spellCheckLine(words[i++ % words.size()], problems);
+		});
+		s.counter("nodes", (double)sc.dictionaryNodes());
+		s.counter("bytes", (double)sc.dictionaryBytes());
+	}
+
+	// Word lookups through StudentSpellCheck::contains() on one backend, with or without the Bloom
+	// filter in front: every dictionary word (hits) or a one-letter misspelling of every third one
+	// (misses), shuffled. The ns/op figures are the mean; the p50..p999 counters are the spread
+	// over single lookups, each timed alone with the clock's own cost taken off, so they include
+	// the cache misses a cold word costs. With stacked > 0, that many word lists of 5,000 made-up
+	// words each are stacked on the dictionary, at a higher priority.
+	enum MembershipBackend { MEMBERSHIP_TRIE, MEMBERSHIP_DAWG, MEMBERSHIP_DOUBLE_ARRAY, MEMBERSHIP_PERFECT_HASH, MEMBERSHIP_AFFIX };
+	void benchMembership(BenchState& s, MembershipBackend backend, bool bloom, bool hits, int stacked = 0) {
+		typedef chrono::steady_clock Clock;
+		StudentSpellCheck sc(backend == MEMBERSHIP_TRIE ? StudentSpellCheck::TRIE :
+			backend == MEMBERSHIP_DOUBLE_ARRAY ? StudentSpellCheck::DOUBLE_ARRAY : StudentSpellCheck::DAWG);
+		sc.setBloomFilter(bloom);
+		sc.setPerfectHash(backend == MEMBERSHIP_PERFECT_HASH);
+		if (backend == MEMBERSHIP_AFFIX) { // the dictionary as the stems and rules wurdaffix derives
+			vector<string> words;
+			AffixDictionary affixes;
+			StudentSpellCheck::readWords(s.options().dictionary, words);
+			affixes.derive(words);
+			affixes.write("bench_affix.aff", "bench_affix.dic");
+			sc.load("bench_affix.dic");
+			remove("bench_affix.aff");
+			remove("bench_affix.dic");
+		}
+		else
+			sc.load(s.options().dictionary);
+		Rng words(41);
+		for (int d = 0; d < stacked; d++) {
+			const string file = "bench_stack_" + to_string(d) + ".tmp";
+			{
+				ofstream out(file);
+				for (int w = 0; w < 5000; w++) {
+					for (int length = 6 + words.below(7); length > 0; length--)
+						out << (char)('a' + words.below(26));
+					out << '\n';
+				}
+			}
+			sc.addDictionary(file, 1);
+			remove(file.c_str());
+		}
+		vector<string> queries = hits ? dictionaryWords(s.options()) : misspelledWords(s.options(), 3, &sc);
+		Rng rng(29);
+		for (size_t i = queries.size(); i > 1; i--)
+			swap(queries[i - 1], queries[rng.below((int)i)]);
+		size_t i = 0, found = 0;
+		s.run([&] {
+			const string& q = queries[i++ % queries.size()];
+			found += sc.contains(q.data(), q.size());
+		});
+		vector<double> empty, single;
+		for (int r = 0; r < 100000; r++) {
+			Clock::time_point t0 = Clock::now();
+			empty.push_back((double)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count());
+		}
+		sort(empty.begin(), empty.end());
+		double clock = BenchStats::percentile(empty, 50);
+		for (const string& q : queries) {
+			Clock::time_point t0 = Clock::now();
+			found += sc.contains(q.data(), q.size());
+			single.push_back(max(0.0, (double)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count() - clock));
+		}
+		sort(single.begin(), single.end());
+		s.setItemsPerOp(1);
+		s.counter("p50_ns", BenchStats::percentile(single, 50));
+		s.counter("p90_ns", BenchStats::percentile(single, 90));
+		s.counter("p99_ns", BenchStats::percentile(single, 99));
+		s.counter("p999_ns", BenchStats::percentile(single, 99.9));
+		s.counter("filter_bytes", (double)(sc.bloomFilterBytes() + sc.perfectHashBytes() + sc.prefilterBytes()));
+		s.counter("dictionary_bytes", (double)sc.dictionaryBytes());
+		s.counter("found", (double)found); // keeps the lookups from being optimized away
+	}
+
+	// Raw membership queries against one lexicon: every dictionary word and as many misses,
+	// interleaved so hits and misses share the branch predictor the way real text does.
+	void benchLexiconContains(BenchState& s, Lexicon& lexicon, const vector<string>& words) {
+		Rng rng(11);
+		vector<string> queries;
+		for (const string& w : words) {
+			queries.push_back(w);
+			for (;;) {
+				string miss = w;
+				miss[rng.below((int)miss.size())] = 'a' + rng.below(26);
+				if (!lexicon.contains(miss.data(), miss.size())) {
+					queries.push_back(miss);
+					break;
+				}
+			}
+		}
+		size_t i = 0, found = 0;
+		s.run([&] {
+			const string& q = queries[i++ % queries.size()];
+			found += lexicon.contains(q.data(), q.size());
+		});
+		s.counter("nodes", (double)lexicon.nodeCount());
+		s.counter("bytes", (double)lexicon.bytes());
+		if (found == 0)
+			cerr << "no hits?" << endl; // keeps the lookups from being optimized away
+	}
+
+	template <class L>
+	void benchLexiconContains(BenchState& s) {
+		vector<string> words;
+		StudentSpellCheck::readWords(s.options().dictionary, words);
+		L lexicon;
+		lexicon.build(words);
+		benchLexiconContains(s, lexicon, words);
+	}
+
+	enum SuggestMethod { TRIE_WALK, AUTOMATON, DELETION_INDEX, BRUTE_FORCE };
+
+	// Suggestion lists as the GUI asks for them (20 per word) at a given edit-distance bound,
+	// over words one or two edits from a dictionary word, from the DAWG. BRUTE_FORCE scores
+	// every dictionary word.
+	void benchSuggest(BenchState& s, SuggestMethod method, int maxDistance) {
+		StudentSpellCheck sc;
+		sc.setMaxEditDistance(maxDistance);
+		sc.setDeletionIndex(method == DELETION_INDEX);
+		sc.load(s.options().dictionary);
+		vector<string> all;
+		StudentSpellCheck::readWords(s.options().dictionary, all);
+		Dawg dawg;
+		dawg.build(all);
+		vector<string> words = misspellingCorpus(s.options(), 97, 1, &sc);
+		vector<string> twice = misspellingCorpus(s.options(), 97, 2, &sc);
+		words.insert(words.end(), twice.begin(), twice.end());
+		vector<Suggestion> suggestions;
+		vector<string> strings;
+		vector<int> rows;
+		size_t i = 0, found = 0;
+		s.run([&] {
+			const string& w = words[i++ % words.size()];
+			suggestions.clear();
+			if (method == TRIE_WALK)
+				suggestByTrieWalk(dawg, w, maxDistance, 20, suggestions);
+			else if (method == AUTOMATON)
+				suggestByAutomaton(dawg, w, maxDistance, 20, suggestions);
+			else if (method == DELETION_INDEX) {
+				sc.spellCheck(w, 20, strings);
+				found += strings.size();
+			}
+			else {
+				SuggestionList list(maxDistance, 20);
+				for (const string& d : all) {
+					int distance = boundedEditDistance(w, d.data(), d.size(), list.bound(), rows);
+					if (distance <= list.bound())
+						list.offer(d.data(), d.size(), distance);
+				}
+				list.take(suggestions);
+			}
+			found += suggestions.size();
+		}, nullptr, method == BRUTE_FORCE ? 16 : 1LL << 30);
+		s.setItemsPerOp(1); // misspelled words answered
+		s.counter("suggestions/word", (double)found / (i ? i : 1));
+		if (method == DELETION_INDEX)
+			s.counter("index_bytes", (double)sc.deletionIndexBytes());
+	}
+
+	// Suggestions ranked by word counts: every dictionary word gets a Zipf-like count, as if taken
+	// from a corpus, so ties at each distance are broken by frequency.
+	void benchSuggestRanked(BenchState& s, int maxDistance) {
+		const char* const kCounts = "bench_counts.tmp";
+		{
+			ofstream out(kCounts);
+			Rng rng(23);
+			for (const string& w : sampleWords(s.options(), 1))
+				out << w << ' ' << 1000000 / (1 + rng.below(100000)) << '\n';
+		}
+		StudentSpellCheck sc;
+		sc.setMaxEditDistance(maxDistance);
+		sc.load(s.options().dictionary);
+		sc.loadFrequencies(kCounts);
+		remove(kCounts);
+		vector<string> words = misspellingCorpus(s.options(), 97, 1, &sc);
+		vector<string> twice = misspellingCorpus(s.options(), 97, 2, &sc);
+		words.insert(words.end(), twice.begin(), twice.end());
+		vector<string> suggestions;
+		size_t i = 0;
+		s.run([&] { sc.spellCheck(words[i++ % words.size()], 20, suggestions); });
+		s.setItemsPerOp(1);
+		s.counter("frequency_bytes", (double)sc.frequencyBytes());
+	}
+
+	// Ten completions of 1-, 2- or 3-letter prefixes, as the editor's completion key asks for them:
+	// the first letters of dictionary words, shuffled, so common starts come up as often as they
+	// begin words. Ranked, the words get the Zipf-like counts of benchSuggestRanked(). With scan,
+	// the same answer by binary search of the sorted word list and a sort of every word in range,
+	// for comparison. The p50..p999 counters are the spread over single calls, as in
+	// benchMembership(); the first ranked call, which builds the index, isn't timed.
+	void benchComplete(BenchState& s, size_t length, bool ranked, bool scan = false) {
+		typedef chrono::steady_clock Clock;
+		const char* const kCounts = "bench_counts.tmp";
+		{
+			ofstream out(kCounts);
+			Rng rng(23);
+			for (const string& w : sampleWords(s.options(), 1))
+				out << w << ' ' << 1000000 / (1 + rng.below(100000)) << '\n';
+		}
+		StudentSpellCheck sc;
+		sc.load(s.options().dictionary);
+		if (ranked)
+			sc.loadFrequencies(kCounts);
+		WordFrequencies ranks;
+		Dawg dawg;
+		const vector<string>& all = dictionaryWords(s.options());
+		if (scan && ranked) {
+			dawg.build(all);
+			ranks.read(kCounts, dawg);
+		}
+		remove(kCounts);
+		vector<string> prefixes;
+		for (const string& w : all) {
+			if (w.size() >= length)
+				prefixes.push_back(w.substr(0, length));
+		}
+		Rng rng(31);
+		for (size_t i = prefixes.size(); i > 1; i--)
+			swap(prefixes[i - 1], prefixes[rng.below((int)i)]);
+		vector<string> completions;
+		size_t found = 0;
+		auto complete = [&](const string& prefix) {
+			if (!scan)
+				sc.complete(prefix, 10, completions, ranked);
+			else {
+				vector<string>::const_iterator first = lower_bound(all.begin(), all.end(), prefix), last = first;
+				while (last != all.end() && last->compare(0, prefix.size(), prefix) == 0)
+					++last;
+				completions.assign(first, last);
+				size_t n = completions.size();
+				stable_sort(completions.begin(), completions.end(), [&](const string& a, const string& b) {
+					if (ranked)
+						return ranks.rank(a.data(), a.size()) > ranks.rank(b.data(), b.size());
+					return a.size() < b.size();
+				});
+				completions.resize(min<size_t>(n, 10));
+			}
+			found += completions.size();
+		};
+		complete(prefixes[0]);
+		size_t i = 0;
+		s.run([&] { complete(prefixes[i++ % prefixes.size()]); });
+		vector<double> empty, single;
+		for (int r = 0; r < 100000; r++) {
+			Clock::time_point t0 = Clock::now();
+			empty.push_back((double)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count());
+		}
+		sort(empty.begin(), empty.end());
+		double clock = BenchStats::percentile(empty, 50);
+		for (size_t r = 0; r < min<size_t>(prefixes.size(), 20000); r++) {
+			Clock::time_point t0 = Clock::now();
+			complete(prefixes[r]);
+			single.push_back(max(0.0, (double)chrono::duration_cast<chrono::nanoseconds>(Clock::now() - t0).count() - clock));
+		}
+		sort(single.begin(), single.end());
+		s.setItemsPerOp(1);
+		s.counter("p50_ns", BenchStats::percentile(single, 50));
+		s.counter("p90_ns", BenchStats::percentile(single, 90));
+		s.counter("p99_ns", BenchStats::percentile(single, 99));
+		s.counter("p999_ns", BenchStats::percentile(single, 99.9));
+		if (ranked && !scan)
+			s.counter("index_bytes", (double)sc.completionBytes());
+		s.counter("found", (double)found); // keeps the calls from being optimized away
+	}
+
+	vector<Benchmark> allBenchmarks() {
+		vector<Benchmark> b;
+		b.push_back({ "editor/load", benchEditorLoad });
+		b.push_back({ "editor/save", benchEditorSave });
+		b.push_back({ "editor/insert_head", [](BenchState& s) { benchEditorInsert(s, 0); } });
+		b.push_back({ "editor/insert_middle", [](BenchState& s) { benchEditorInsert(s, 1); } });
+		b.push_back({ "editor/insert_end", [](BenchState& s) { benchEditorInsert(s, 2); } });
+		b.push_back({ "editor/enter", benchEditorEnter });
+		b.push_back({ "editor/backspace_join", benchEditorBackspaceJoin });
+		for (int depth : { 0, 1000, 10000, 99000 })
+			b.push_back({ "editor/getLines_depth_" + to_string(depth), [depth](BenchState& s) { benchEditorGetLines(s, depth); } });
+		b.push_back({ "undo/submit_batched", benchUndoSubmitBatched });
+		b.push_back({ "undo/submit_deletes", benchUndoSubmitDeletes });
+		b.push_back({ "undo/get", benchUndoGet });
+		for (int depth : { 10000, 100000 })
+			b.push_back({ "undo/clear_depth_" + to_string(depth), [depth](BenchState& s) { benchUndoClearDeep(s, depth); } });
+		b.push_back({ "spell/load", benchSpellLoad });
+		b.push_back({ "spell/check_hit", benchSpellCheckHit });
+		b.push_back({ "spell/check_miss", [](BenchState& s) { benchSpellCheckMiss(s, 0); } });
+		b.push_back({ "spell/suggest_20", [](BenchState& s) { benchSpellCheckMiss(s, 20); } });
+		b.push_back({ "spell/suggest_cursor_word", [](BenchState& s) {
+			benchSpellCursorWord(s, SuggestionCache::kDefaultCapacity); } });
+		b.push_back({ "spell/suggest_cursor_word_uncached", [](BenchState& s) { benchSpellCursorWord(s, 0); } });
+		b.push_back({ "spell/check_line", benchSpellCheckLine });
+		b.push_back({ "spell/scroll_frame", [](BenchState& s) { benchSpellScrollFrame(s, LineCache::kDefaultCapacity); } });
+		b.push_back({ "spell/scroll_frame_uncached", [](BenchState& s) { benchSpellScrollFrame(s, 0); } });
+		b.push_back({ "spell/tokenize_100mb", [](BenchState& s) { benchSpellText(s, false); } });
+		b.push_back({ "spell/check_text_100mb", [](BenchState& s) { benchSpellText(s, true); } });
+		b.push_back({ "spell/check_lines_single_calls", [](BenchState& s) { benchSpellCheckLines(s, 0); } });
+		unsigned cores = max(1u, thread::hardware_concurrency());
+		for (unsigned threads = 1; ; threads = min(threads * 2, cores)) {
+			b.push_back({ "spell/check_lines_threads_" + to_string(threads), [threads](BenchState& s) {
+				benchSpellCheckLines(s, threads); } });
+			if (threads == cores)
+				break;
+		}
+		for (size_t lines : { 10000, 100000, 1000000 }) {
+			b.push_back({ "document/check_" + to_string(lines) + "_lines", [lines](BenchState& s) { benchDocumentCheck(s, lines); } });
+			b.push_back({ "document/start_" + to_string(lines) + "_lines", [lines](BenchState& s) { benchDocumentStart(s, lines); } });
+			b.push_back({ "document/split_join_" + to_string(lines) + "_lines", [lines](BenchState& s) { benchDocumentSplitJoin(s, lines); } });
+			b.push_back({ "document/next_misspelling_" + to_string(lines) + "_lines", [lines](BenchState& s) { benchDocumentNextMisspelling(s, lines); } });
+		}
+		b.push_back({ "spell/load_trie", [](BenchState& s) { benchSpellLoadBackend(s, StudentSpellCheck::TRIE); } });
+		b.push_back({ "spell/load_dawg", [](BenchState& s) { benchSpellLoadBackend(s, StudentSpellCheck::DAWG); } });
+		b.push_back({ "spell/load_double_array", [](BenchState& s) { benchSpellLoadBackend(s, StudentSpellCheck::DOUBLE_ARRAY); } });
+		b.push_back({ "spell/load_compiled_dawg", [](BenchState& s) { benchSpellLoadCompiled(s, StudentSpellCheck::DAWG); } });
+		b.push_back({ "spell/load_compiled_double_array", [](BenchState& s) { benchSpellLoadCompiled(s, StudentSpellCheck::DOUBLE_ARRAY); } });
+		b.push_back({ "spell/lookup_trie", [](BenchState& s) { benchSpellLookupBackend(s, StudentSpellCheck::TRIE); } });
+		b.push_back({ "spell/lookup_dawg", [](BenchState& s) { benchSpellLookupBackend(s, StudentSpellCheck::DAWG); } });
+		b.push_back({ "spell/lookup_double_array", [](BenchState& s) { benchSpellLookupBackend(s, StudentSpellCheck::DOUBLE_ARRAY); } });
+		const pair<const char*, MembershipBackend> membership[] = { { "trie", MEMBERSHIP_TRIE }, { "dawg", MEMBERSHIP_DAWG },
+			{ "double_array", MEMBERSHIP_DOUBLE_ARRAY }, { "perfect_hash", MEMBERSHIP_PERFECT_HASH } };
+		for (const auto& m : membership) {
+			MembershipBackend backend = m.second;
+			for (bool bloom : { false, true }) {
+				string name = string("membership/") + m.first + (bloom ? "_bloom" : "");
+				b.push_back({ name + "_hit", [backend, bloom](BenchState& s) { benchMembership(s, backend, bloom, true); } });
+				b.push_back({ name + "_miss", [backend, bloom](BenchState& s) { benchMembership(s, backend, bloom, false); } });
+			}
+		}
+		b.push_back({ "membership/dawg_stack_3_hit", [](BenchState& s) { benchMembership(s, MEMBERSHIP_DAWG, false, true, 2); } });
+		b.push_back({ "membership/dawg_stack_3_miss", [](BenchState& s) { benchMembership(s, MEMBERSHIP_DAWG, false, false, 2); } });
+		b.push_back({ "membership/affix_hit", [](BenchState& s) { benchMembership(s, MEMBERSHIP_AFFIX, false, true); } });
+		b.push_back({ "membership/affix_miss", [](BenchState& s) { benchMembership(s, MEMBERSHIP_AFFIX, false, false); } });
+		for (size_t length : { 1, 2, 3 }) {
+			string n = to_string(length);
+			b.push_back({ "complete/prefix_" + n, [length](BenchState& s) { benchComplete(s, length, false); } });
+			b.push_back({ "complete/prefix_" + n + "_ranked", [length](BenchState& s) { benchComplete(s, length, true); } });
+			b.push_back({ "complete/scan_prefix_" + n, [length](BenchState& s) { benchComplete(s, length, false, true); } });
+			b.push_back({ "complete/scan_prefix_" + n + "_ranked", [length](BenchState& s) { benchComplete(s, length, true, true); } });
+		}
+		b.push_back({ "spell/load_deletion_index", benchSpellLoadDeletionIndex });
+		b.push_back({ "spell/load_compiled_deletion_index", [](BenchState& s) {
+			benchSpellLoadCompiled(s, StudentSpellCheck::DAWG, StudentSpellCheck::kDefaultMaxEditDistance); } });
+		b.push_back({ "suggest/brute_force_distance_1", [](BenchState& s) { benchSuggest(s, BRUTE_FORCE, 1); } });
+		b.push_back({ "suggest/brute_force_distance_2", [](BenchState& s) { benchSuggest(s, BRUTE_FORCE, 2); } });
+		b.push_back({ "suggest/trie_walk_distance_1", [](BenchState& s) { benchSuggest(s, TRIE_WALK, 1); } });
+		b.push_back({ "suggest/trie_walk_distance_2", [](BenchState& s) { benchSuggest(s, TRIE_WALK, 2); } });
+		b.push_back({ "suggest/automaton_distance_1", [](BenchState& s) { benchSuggest(s, AUTOMATON, 1); } });
+		b.push_back({ "suggest/automaton_distance_2", [](BenchState& s) { benchSuggest(s, AUTOMATON, 2); } });
+		b.push_back({ "suggest/automaton_ranked_distance_1", [](BenchState& s) { benchSuggestRanked(s, 1); } });
+		b.push_back({ "suggest/automaton_ranked_distance_2", [](BenchState& s) { benchSuggestRanked(s, 2); } });
+		b.push_back({ "suggest/deletion_index_distance_1", [](BenchState& s) { benchSuggest(s, DELETION_INDEX, 1); } });
+		b.push_back({ "suggest/deletion_index_distance_2", [](BenchState& s) { benchSuggest(s, DELETION_INDEX, 2); } });
+		b.push_back({ "lexicon/contains_dawg", benchLexiconContains<Dawg> });
+		b.push_back({ "lexicon/contains_double_array", benchLexiconContains<DoubleArrayTrie> });
+		return b;
+	}
+
+	string jsonEscape(const string& s) {
+		string out;
+		for (char ch : s) {
+			if (ch == '"' || ch == '\\')
+				out += '\\';
+			out += ch;
+		}
+		return out;
+	}
+
+	// One benchmark per line so --compare can read the file back without a JSON library.
+	bool writeJson(const string& file, const vector<BenchResult>& results) {
+		ofstream out(file);
+		if (!out)
+			return false;
+		out << "{\"benchmarks\":[\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const BenchResult& r = results[i];
+			const BenchStats& st = r.nsPerOp;
+			out << "{\"name\":\"" << jsonEscape(r.name) << "\",\"batch\":" << r.batch << ",\"reps\":" << r.reps
+				<< ",\"ns_per_op\":{\"min\":" << st.min << ",\"median\":" << st.median << ",\"mean\":" << st.mean
+				<< ",\"stddev\":" << st.stddev << ",\"p90\":" << st.p90 << ",\"p99\":" << st.p99 << ",\"max\":" << st.max << "}";
+			if (r.bytesPerOp > 0)
+				out << ",\"bytes_per_op\":" << r.bytesPerOp;
+			if (r.itemsPerOp > 0)
+				out << ",\"items_per_op\":" << r.itemsPerOp;
+			out << ",\"counters\":{";
+			bool first = true;
+			for (const auto& c : r.counters) {
+				out << (first ? "" : ",") << "\"" << jsonEscape(c.first) << "\":" << c.second;
+				first = false;
+			}
+			out << "}}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "]}\n";
+		return true;
+	}
+
+	// name -> median ns/op, from a file written by writeJson().
+	map<string, double> readMedians(const string& file) {
+		map<string, double> medians;
+		ifstream in(file);
+		string line;
+		while (getline(in, line)) {
+			size_t n = line.find("{\"name\":\"");
+			size_t m = line.find("\"median\":");
+			if (n == string::npos || m == string::npos)
+				continue;
+			n += 9;
+			string name = line.substr(n, line.find('"', n) - n);
+			medians[name] = atof(line.c_str() + m + 9);
+		}
+		return medians;
+	}
+
+	int compare(const string& baseFile, const string& newFile) {
+		map<string, double> base = readMedians(baseFile);
+		map<string, double> now = readMedians(newFile);
+		if (base.empty() || now.empty()) {
+			cerr << "Unable to read benchmark results" << endl;
+			return 1;
+		}
+		printf("%-32s %14s %14s %9s\n", "benchmark", "base ns/op", "new ns/op", "change");
+		for (const auto& b : base) {
+			auto it = now.find(b.first);
+			if (it == now.end())
+				continue;
+			printf("%-32s %14.1f %14.1f %+8.1f%%\n", b.first.c_str(), b.second, it->second,
+				(it->second / b.second - 1) * 100);
+		}
+		return 0;
+	}
+
+	void printResult(const BenchResult& r) {
+		const BenchStats& st = r.nsPerOp;
+		string extra;
+		char buf[64];
+		if (r.bytesPerOp > 0 && st.median > 0) {
+			snprintf(buf, sizeof buf, "%.1f MB/s", r.bytesPerOp / st.median * 1e9 / 1e6);
+			extra += buf;
+		}
+		if (r.itemsPerOp > 0 && st.median > 0) {
+			snprintf(buf, sizeof buf, "%s%.3g items/s", extra.empty() ? "" : ", ", r.itemsPerOp / st.median * 1e9);
+			extra += buf;
+		}
+		for (const auto& c : r.counters) {
+			snprintf(buf, sizeof buf, "%s%s=%g", extra.empty() ? "" : ", ", c.first.c_str(), c.second);
+			extra += buf;
+		}
+		printf("%-32s %9lld %14.1f %14.1f %7.1f%%  %s\n", r.name.c_str(), r.batch, st.median, st.p99,
+			st.mean > 0 ? st.stddev / st.mean * 100 : 0.0, extra.c_str());
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions opt;
+	string filter, jsonFile;
+	bool list = false;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		auto value = [&]() -> string {
+			if (i + 1 >= argc) {
+				cerr << arg << " needs a value" << endl;
+				exit(2);
+			}
+			return argv[++i];
+		};
+		if (arg == "--filter")
+			filter = value();
+		else if (arg == "--reps")
+			opt.reps = atoi(value().c_str());
+		else if (arg == "--warmup")
+			opt.warmup = atoi(value().c_str());
+		else if (arg == "--min-time-ms")
+			opt.minTimeNs = (uint64_t)(atof(value().c_str()) * 1e6);
+		else if (arg == "--dict")
+			opt.dictionary = value();
+		else if (arg == "--json")
+			jsonFile = value();
+		else if (arg == "--list")
+			list = true;
+		else if (arg == "--compare" && i + 2 < argc)
+			return compare(argv[i + 1], argv[i + 2]);
+		else {
+			cerr << "usage: bench [--filter text] [--reps n] [--warmup n] [--min-time-ms n] [--dict path] [--json out.json] [--list]" << endl
+				<< "       bench --compare base.json new.json" << endl;
+			return 2;
+		}
+	}
+	if (opt.reps < 1)
+		opt.reps = 1;
+
+	vector<BenchResult> results;
+	if (!list)
+		printf("%-32s %9s %14s %14s %8s\n", "benchmark", "batch", "median ns/op", "p99 ns/op", "stddev");
+	for (const Benchmark& b : allBenchmarks()) {
+		if (!filter.empty() && b.name.find(filter) == string::npos)
+			continue;
+		if (list) {
+			printf("%s\n", b.name.c_str());
+			continue;
+		}
+		BenchResult r;
+		r.name = b.name;
+		BenchState state(opt, r);
+		b.fn(state);
+		printResult(r);
+		results.push_back(r);
+	}
+	remove(kDocFile);
+	remove(kSaveFile);
+
+	if (!list && !jsonFile.empty() && !writeJson(jsonFile, results)) {
+		cerr << "Unable to write " << jsonFile << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,280 @@
+// Headless driver: runs the editor GUI against a key script with no terminal attached, so that
+// scripted or recorded sessions can be timed, traced and compared across versions.
+//
+//     headless [options] script
+//
+//     -r rows, -c cols        screen size (default 25 x 80)
+//     -d dictionary           dictionary to load (default: the one noted in a recording)
+//     -f file                 file to edit (default: the one noted in a recording)
+//     -t trace.json           write a Chrome trace of the session
+//     -o screen.txt           write the final screen
+//     --runs n                replay the script n times, accumulating the latency histograms
+//     --realtime              wait for each key's recorded time instead of replaying flat out
+//     --stats file            write the per-stage latency histograms
+//     --baseline file         compare against histograms written earlier with --stats and exit
+//                             with status 3 if any stage's p99 regressed
+//     --threshold ratio       allowed p99 growth before it counts as a regression (default 1.25)
+//     --slack-us n            absolute p99 growth that is always tolerated (default 20)
+//
+// Build with WURD_HEADLESS defined, e.g.
+//     g++ -std=c++17 -O2 -pthread -DWURD_HEADLESS -I. tools/headless.cpp <all .cpp but main.cpp>
+
+#include "EditorGui.h"
+#include "KeyScript.h"
+#include "Trace.h"
+#include "Histogram.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+#ifndef WURD_HEADLESS
+#error "tools/headless.cpp must be compiled with WURD_HEADLESS defined"
+#endif
+
+namespace {
+	struct Options {
+		int rows = 25;
+		int cols = 80;
+		int runs = 1;
+		bool realtime = false;
+		double threshold = 1.25;
+		double slackUs = 20;
+		string dictionary, file, traceFile, screenFile, statsFile, baselineFile, script;
+	};
+
+	struct StageSummary {
+		uint64_t count = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;
+	};
+
+	void usage() {
+		cerr << "usage: headless [-r rows] [-c cols] [-d dictionary] [-f file] [-t trace.json] [-o screen.txt]" << endl
+			<< "                [--runs n] [--realtime] [--stats file] [--baseline file] [--threshold ratio] [--slack-us n] script" << endl;
+	}
+
+	// Recordings note the document and dictionary the session started with.
+	void readRecordingHeader(const string& script, string& file, string& dictionary) {
+		ifstream in(script);
+		string line;
+		while (getline(in, line) && !line.empty() && line[0] == '#') {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (line.compare(0, 7, "# file ") == 0 && file.empty())
+				file = line.substr(7);
+			else if (line.compare(0, 13, "# dictionary ") == 0 && dictionary.empty())
+				dictionary = line.substr(13);
+		}
+	}
+
+	bool replay(const Options& opt, const vector<ScriptKey>& keys, size_t& processed) {
+		EditorGui gui(opt.rows, opt.cols);
+		if (!opt.dictionary.empty() && !gui.loadDictionary(opt.dictionary)) {
+			cerr << "Unable to load dictionary " << opt.dictionary << endl;
+			return false;
+		}
+		if (!opt.file.empty())
+			gui.loadFileToEdit(opt.file);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i].key == 0)
+				continue; // queued along with the key that prompts for it
+			for (size_t j = i + 1; j < keys.size() && keys[j].key == 0; j++)
+				TextIO::pushInput(keys[j].input);
+			if (opt.realtime && keys[i].timeUs >= 0)
+				this_thread::sleep_until(start + chrono::microseconds(keys[i].timeUs));
+			processed++;
+			if (!gui.processKey(keys[i].key))
+				break;
+			gui.finishLoadingDictionary(!opt.realtime); // flat out, a DICT key's load is waited for
+		}
+		gui.finishLoadingDictionary(true);
+		return true;
+	}
+
+	StageSummary summarize(const LatencyHistogram& h) {
+		StageSummary s;
+		s.count = h.count();
+		s.p50 = h.percentile(50);
+		s.p90 = h.percentile(90);
+		s.p99 = h.percentile(99);
+		s.max = h.max();
+		return s;
+	}
+
+	bool writeStats(const string& file) {
+		ofstream out(file);
+		if (!out)
+			return false;
+		out << "# Wurd latency histograms v1 (ns)\n";
+		for (int i = 0; i < Trace::NUM_STAGES; i++) {
+			const LatencyHistogram& h = Trace::histogram((Trace::Stage)i);
+			StageSummary s = summarize(h);
+			out << "stage " << Trace::stageName((Trace::Stage)i) << " count " << s.count << " p50 " << s.p50
+				<< " p90 " << s.p90 << " p99 " << s.p99 << " max " << s.max << "\n";
+			out << "buckets " << Trace::stageName((Trace::Stage)i);
+			for (int b = 0; b < LatencyHistogram::kBuckets; b++) {
+				if (h.bucketCount(b))
+					out << " " << b << ":" << h.bucketCount(b);
+			}
+			out << "\n";
+		}
+		return (bool)out;
+	}
+
+	bool readStats(const string& file, map<string, StageSummary>& stages) {
+		ifstream in(file);
+		if (!in)
+			return false;
+		string line;
+		while (getline(in, line)) {
+			istringstream ls(line);
+			string kind, name, key;
+			ls >> kind >> name;
+			if (kind != "stage")
+				continue;
+			StageSummary s;
+			uint64_t value;
+			while (ls >> key >> value) {
+				if (key == "count") s.count = value;
+				else if (key == "p50") s.p50 = value;
+				else if (key == "p90") s.p90 = value;
+				else if (key == "p99") s.p99 = value;
+				else if (key == "max") s.max = value;
+			}
+			stages[name] = s;
+		}
+		return !stages.empty();
+	}
+
+	// Returns the number of stages whose p99 grew beyond the threshold.
+	int compareWithBaseline(const Options& opt, const map<string, StageSummary>& base) {
+		const uint64_t kMinSamples = 20; // too few samples for a meaningful p99
+		int regressions = 0;
+		printf("\n%-16s %12s %12s %9s\n", "stage", "base p99 us", "new p99 us", "change");
+		for (int i = 0; i < Trace::NUM_STAGES; i++) {
+			const char* name = Trace::stageName((Trace::Stage)i);
+			auto it = base.find(name);
+			StageSummary now = summarize(Trace::histogram((Trace::Stage)i));
+			if (it == base.end() || it->second.count < kMinSamples || now.count < kMinSamples)
+				continue;
+			double b = it->second.p99 / 1000.0, n = now.p99 / 1000.0;
+			bool regressed = n > b * opt.threshold + opt.slackUs;
+			printf("%-16s %12.1f %12.1f %+8.1f%%%s\n", name, b, n, b > 0 ? (n / b - 1) * 100 : 0.0,
+				regressed ? "  REGRESSION" : "");
+			if (regressed)
+				regressions++;
+		}
+		return regressions;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--realtime")
+			opt.realtime = true;
+		else if (arg.compare(0, 2, "--") == 0 && hasValue) {
+			string value = argv[++i];
+			if (arg == "--runs") opt.runs = atoi(value.c_str());
+			else if (arg == "--stats") opt.statsFile = value;
+			else if (arg == "--baseline") opt.baselineFile = value;
+			else if (arg == "--threshold") opt.threshold = atof(value.c_str());
+			else if (arg == "--slack-us") opt.slackUs = atof(value.c_str());
+			else {
+				usage();
+				return 2;
+			}
+		}
+		else if (arg.size() == 2 && arg[0] == '-' && hasValue) {
+			string value = argv[++i];
+			switch (arg[1]) {
+			case 'r': opt.rows = atoi(value.c_str()); break;
+			case 'c': opt.cols = atoi(value.c_str()); break;
+			case 'd': opt.dictionary = value; break;
+			case 'f': opt.file = value; break;
+			case 't': opt.traceFile = value; break;
+			case 'o': opt.screenFile = value; break;
+			default: usage(); return 2;
+			}
+		}
+		else if (opt.script.empty() && arg[0] != '-')
+			opt.script = arg;
+		else {
+			usage();
+			return 2;
+		}
+	}
+	if (opt.script.empty() || opt.rows < 2 || opt.cols < 1 || opt.runs < 1) {
+		usage();
+		return 2;
+	}
+
+	vector<ScriptKey> keys;
+	if (!loadKeyScript(opt.script, keys)) {
+		cerr << "Unable to read key script " << opt.script << endl;
+		return 1;
+	}
+	readRecordingHeader(opt.script, opt.file, opt.dictionary);
+
+	if (!opt.traceFile.empty())
+		Trace::start(opt.traceFile);
+	Trace::startStats();
+
+	uint64_t startNs = Trace::nowNs();
+	size_t processed = 0;
+	for (int run = 0; run < opt.runs; run++) {
+		if (!replay(opt, keys, processed))
+			return 1;
+	}
+	uint64_t elapsedNs = Trace::nowNs() - startNs;
+	Trace::stopStats();
+	cout << "Processed " << processed << " keys in " << elapsedNs / 1000000.0 << " ms" << endl;
+
+	printf("%-16s %9s %10s %10s %10s %10s\n", "stage", "count", "p50 us", "p90 us", "p99 us", "max us");
+	for (int i = 0; i < Trace::NUM_STAGES; i++) {
+		StageSummary s = summarize(Trace::histogram((Trace::Stage)i));
+		if (s.count)
+			printf("%-16s %9llu %10.1f %10.1f %10.1f %10.1f\n", Trace::stageName((Trace::Stage)i),
+				(unsigned long long)s.count, s.p50 / 1000.0, s.p90 / 1000.0, s.p99 / 1000.0, s.max / 1000.0);
+	}
+
+	if (!opt.screenFile.empty()) {
+		ofstream out(opt.screenFile);
+		for (const string& line : TextIO::screen())
+			out << line << '\n';
+	}
+	if (!opt.traceFile.empty() && !Trace::stop()) {
+		cerr << "Unable to write trace " << opt.traceFile << endl;
+		return 1;
+	}
+	if (!opt.statsFile.empty() && !writeStats(opt.statsFile)) {
+		cerr << "Unable to write " << opt.statsFile << endl;
+		return 1;
+	}
+	if (!opt.baselineFile.empty()) {
+		map<string, StageSummary> base;
+		if (!readStats(opt.baselineFile, base)) {
+			cerr << "Unable to read baseline " << opt.baselineFile << endl;
+			return 1;
+		}
+		int regressions = compareWithBaseline(opt, base);
+		if (regressions) {
+			printf("%d stage(s) regressed beyond %.2fx + %.0f us\n", regressions, opt.threshold, opt.slackUs);
+			return 3;
+		}
+		printf("No p99 regressions.\n");
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+// Affix compressor: derives stems and affix rules from a word list and writes them as a
+// Hunspell-style .aff and .dic pair (see AffixDictionary.h) that StudentSpellCheck::load() reads
+// when given the .dic file.
+//
+//     wurdaffix [--rules n] dictionary.txt out
+//
+//     --rules n    keep the n rules that make the most words (default 26)
+//
+// Writes out.aff and out.dic, checks that they give back exactly the listed words, and compares
+// their memory and lookup time with the word list's.
+//
+// Build like the other tools:
+//     g++ -std=c++17 -O2 -pthread -I. tools/wurdaffix.cpp $(ls *.cpp | grep -v main.cpp) -o wurdaffix
+
+#include "StudentSpellCheck.h"
+#include "AffixDictionary.h"
+#include "Rng.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+	void usage() {
+		cerr << "usage: wurdaffix [--rules n] dictionary.txt out" << endl;
+	}
+
+	double msSince(chrono::steady_clock::time_point t0) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	}
+
+	long long fileSize(const string& file) {
+		ifstream in(file, ios::binary | ios::ate);
+		return in ? (long long)in.tellg() : -1;
+	}
+
+	// Mean ns per contains() over queries, best of three passes.
+	double lookupNs(const StudentSpellCheck& sc, const vector<string>& queries, size_t& found) {
+		double best = 1e18;
+		for (int pass = 0; pass < 3; pass++) {
+			chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+			for (const string& q : queries)
+				found += sc.contains(q.data(), q.size());
+			best = min(best, msSince(t0) * 1e6 / queries.size());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t rules = 26;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--rules" && i + 1 < argc)
+			rules = (size_t)atoi(argv[++i]);
+		else if (arg.compare(0, 2, "--") == 0) {
+			usage();
+			return 2;
+		}
+		else
+			files.push_back(arg);
+	}
+	if (files.size() != 2) {
+		usage();
+		return 2;
+	}
+
+	vector<string> words;
+	if (!StudentSpellCheck::readWords(files[0], words)) {
+		cerr << "Unable to read " << files[0] << endl;
+		return 1;
+	}
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	AffixDictionary affixes;
+	string affFile = files[1] + ".aff", dicFile = files[1] + ".dic";
+	if (!affixes.derive(words, rules) || !affixes.write(affFile, dicFile)) {
+		cerr << "Unable to write " << affFile << " and " << dicFile << endl;
+		return 1;
+	}
+	cout << "Derived " << affixes.stemCount() << " stems and " << affixes.ruleCount() << " rules from "
+		<< words.size() << " words in " << msSince(t0) << " ms" << endl;
+
+	StudentSpellCheck flat, affixed;
+	flat.setShareDictionaries(false);
+	affixed.setShareDictionaries(false);
+	if (!flat.load(files[0]) || !affixed.load(dicFile)) {
+		cerr << "Unable to load " << files[0] << " or " << dicFile << endl;
+		return 1;
+	}
+	vector<string> expanded;
+	StudentSpellCheck::readWords(dicFile, expanded);
+	if (expanded != words) {
+		cerr << "verify: " << dicFile << " gives " << expanded.size() << " words, not the " << words.size() << " listed" << endl;
+		return 1;
+	}
+	cout << "files: " << fileSize(files[0]) << " bytes listed, " << fileSize(affFile) + fileSize(dicFile)
+		<< " bytes as stems and rules" << endl;
+	cout << "memory: " << flat.dictionaryBytes() << " bytes as a DAWG of the words, " << affixed.dictionaryBytes()
+		<< " bytes as stems and rules" << endl;
+
+	// Every word, shuffled, then as many one-letter misspellings.
+	vector<string> hits = words, misses;
+	Rng rng(7);
+	for (size_t i = hits.size(); i > 1; i--)
+		swap(hits[i - 1], hits[rng.below((int)i)]);
+	for (const string& w : hits) {
+		string miss = w;
+		miss[rng.below((int)miss.size())] = (char)('a' + rng.below(26));
+		if (!binary_search(words.begin(), words.end(), miss))
+			misses.push_back(miss);
+	}
+	size_t found = 0;
+	double flatHit = lookupNs(flat, hits, found), affixedHit = lookupNs(affixed, hits, found);
+	double flatMiss = lookupNs(flat, misses, found), affixedMiss = lookupNs(affixed, misses, found);
+	cout << "lookup: hit " << flatHit << " ns listed, " << affixedHit << " ns as stems and rules; miss " << flatMiss
+		<< " ns listed, " << affixedMiss << " ns as stems and rules" << endl;
+	return found == 6 * hits.size() ? 0 : 1; // every hit in each of the three passes both ways, and no miss
+}
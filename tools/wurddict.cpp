@@ -0,0 +1,115 @@
+// Dictionary compiler: turns a word list into a compiled dictionary (see DictionaryFile.h) that
+// StudentSpellCheck::load() maps and uses in place instead of parsing the list on every start.
+//
+//     wurddict [--double-array] [--deletion-index] [--frequencies counts.txt] [--bloom-filter]
+//              [--perfect-hash] [--verify] dictionary.txt dictionary.wdict
+//
+//     --double-array     store a double-array trie instead of the (smaller) DAWG
+//     --deletion-index   add a deletion index for suggestions within two edits (see DeletionIndex.h)
+//     --frequencies      add word frequencies from a "word count" list or a text corpus
+//     --bloom-filter     add a Bloom filter that turns most misspellings away (see BloomFilter.h)
+//     --perfect-hash     add a perfect hash of the words for lookups (see PerfectHashSet.h)
+//     --verify           load the result and check that it holds exactly the listed words
+//
+// Build like the other tools:
+//     g++ -std=c++17 -O2 -pthread -I. tools/wurddict.cpp $(ls *.cpp | grep -v main.cpp) -o wurddict
+
+#include "StudentSpellCheck.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+namespace {
+	void usage() {
+		cerr << "usage: wurddict [--double-array] [--deletion-index] [--frequencies counts.txt] [--bloom-filter] [--perfect-hash] "
+			"[--verify] "
+			"dictionary.txt dictionary.wdict" << endl;
+	}
+
+	double msSince(chrono::steady_clock::time_point t0) {
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	StudentSpellCheck::Backend backend = StudentSpellCheck::DAWG;
+	bool verify = false;
+	int deletionDistance = 0;
+	string frequencyFile;
+	bool bloomFilter = false, perfectHash = false;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--double-array")
+			backend = StudentSpellCheck::DOUBLE_ARRAY;
+		else if (arg == "--deletion-index")
+			deletionDistance = StudentSpellCheck::kDefaultMaxEditDistance;
+		else if (arg == "--frequencies" && i + 1 < argc)
+			frequencyFile = argv[++i];
+		else if (arg == "--bloom-filter")
+			bloomFilter = true;
+		else if (arg == "--perfect-hash")
+			perfectHash = true;
+		else if (arg == "--verify")
+			verify = true;
+		else if (arg.compare(0, 2, "--") == 0) {
+			usage();
+			return 2;
+		}
+		else
+			files.push_back(arg);
+	}
+	if (files.size() != 2) {
+		usage();
+		return 2;
+	}
+
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	if (!StudentSpellCheck::compile(files[0], files[1], backend, deletionDistance, frequencyFile, bloomFilter, perfectHash)) {
+		cerr << "Unable to compile " << files[0] << " into " << files[1] << endl;
+		return 1;
+	}
+	cout << "Compiled " << files[0] << " in " << msSince(t0) << " ms" << endl;
+
+	StudentSpellCheck text(backend), compiled(backend);
+	t0 = chrono::steady_clock::now();
+	text.load(files[0]);
+	double textMs = msSince(t0);
+	t0 = chrono::steady_clock::now();
+	if (!compiled.load(files[1])) {
+		cerr << "Unable to load " << files[1] << endl;
+		return 1;
+	}
+	double compiledMs = msSince(t0);
+	cout << compiled.dictionaryNodes() << " nodes, " << compiled.dictionaryBytes() << " bytes" << endl;
+	if (deletionDistance > 0)
+		cout << "deletion index: " << compiled.deletionIndexBytes() << " bytes" << endl;
+	if (!frequencyFile.empty())
+		cout << "frequencies: " << compiled.frequencyBytes() << " bytes" << endl;
+	if (bloomFilter)
+		cout << "bloom filter: " << compiled.bloomFilterBytes() << " bytes" << endl;
+	if (perfectHash)
+		cout << "perfect hash: " << compiled.perfectHashBytes() << " bytes" << endl;
+	cout << "load: word list " << textMs << " ms, compiled " << compiledMs << " ms" << endl;
+
+	if (verify) {
+		vector<string> words;
+		StudentSpellCheck::readWords(files[0], words);
+		vector<string> none;
+		size_t missing = 0, extra = 0;
+		for (const string& w : words) {
+			if (!compiled.spellCheck(w, 0, none))
+				missing++;
+			if (compiled.spellCheck(w + "q'", 0, none) != text.spellCheck(w + "q'", 0, none))
+				extra++;
+		}
+		cout << "verify: " << words.size() << " words, " << missing << " missing, " << extra << " mismatched misses" << endl;
+		if (missing || extra)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,276 @@
+// Synthetic workload generator: large documents built from dictionary words (with a controllable
+// share of misspellings) and matching keystroke traces for tools/headless.cpp. Everything is
+// derived from --seed, so the same command line always produces the same files.
+//
+//     wurdgen [--seed n] [--dict path] [--doc file] [--keys file] [options]
+//
+// Document options:
+//     --lines n          number of lines (default 10000)
+//     --bytes n          approximate size instead of a line count
+//     --line-dist d      normal, uniform or exponential line lengths (default normal)
+//     --line-mean n      mean line length in characters (default 60)
+//     --line-sd n        spread: standard deviation, or half width for uniform (default 20)
+//     --blank p          probability of an empty line (default 0.05)
+//     --misspell p       probability that a word is misspelled (default 0.05)
+//     --long-lines p     probability of a long outlier line (default 0.001)
+//     --long-length n    length of an outlier line (default 4000)
+// Key trace options:
+//     --num-keys n       number of keystrokes (default 10000)
+//     --undo-storms p    weight of undo storms relative to typing (default 0.05)
+
+#include "Rng.h"
+#include "KeyScript.h"
+#include "TextIO.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+
+using namespace std;
+
+namespace {
+	struct Options {
+		uint64_t seed = 1;
+		string dictionary = "dictionary.txt";
+		string docFile;
+		string keysFile;
+		long long lines = 10000;
+		long long bytes = 0;
+		string lineDist = "normal";
+		double lineMean = 60;
+		double lineSd = 20;
+		double blank = 0.05;
+		double misspell = 0.05;
+		double longLines = 0.001;
+		int longLength = 4000;
+		long long numKeys = 10000;
+		double undoStorms = 0.05;
+	};
+
+	class Words {
+	public:
+		bool load(const string& file) {
+			ifstream in(file);
+			string s;
+			while (getline(in, s)) {
+				if (!s.empty() && s.back() == '\r')
+					s.pop_back();
+				if (s.empty())
+					continue;
+				words_.push_back(s);
+				set_.insert(s);
+			}
+			return !words_.empty();
+		}
+
+		const string& pick(Rng& rng) const { return words_[rng.below((int)words_.size())]; }
+
+		// A word within edit distance one of a dictionary word that is not itself in the
+		// dictionary: a substitution, insertion, deletion or transposition.
+		string misspelled(Rng& rng) const {
+			for (int attempt = 0; attempt < 20; attempt++) {
+				string w = pick(rng);
+				int i = rng.below((int)w.size());
+				char letter = (char)('a' + rng.below(26));
+				switch (rng.below(4)) {
+				case 0: w[i] = letter; break;
+				case 1: w.insert(w.begin() + i, letter); break;
+				case 2: if (w.size() > 1) w.erase(w.begin() + i); break;
+				case 3: if (i + 1 < (int)w.size()) swap(w[i], w[i + 1]); break;
+				}
+				if (!set_.count(w))
+					return w;
+			}
+			return "xqzv"; // practically never reached
+		}
+
+	private:
+		vector<string> words_;
+		unordered_set<string> set_;
+	};
+
+	int lineLength(const Options& opt, Rng& rng) {
+		if (rng.chance(opt.longLines))
+			return opt.longLength;
+		if (rng.chance(opt.blank))
+			return 0;
+		double len;
+		if (opt.lineDist == "uniform")
+			len = opt.lineMean - opt.lineSd + rng.uniform() * 2 * opt.lineSd;
+		else if (opt.lineDist == "exponential") {
+			len = -opt.lineMean * log(1.0 - rng.uniform()); // inverse CDF
+		}
+		else
+			len = rng.normal(opt.lineMean, opt.lineSd);
+		return len < 1 ? 1 : (int)len;
+	}
+
+	// Sentences of dictionary words with punctuation, capitals and some misspellings.
+	string makeLine(const Options& opt, const Words& words, Rng& rng, int length, bool& sentenceStart) {
+		string line;
+		while ((int)line.size() < length) {
+			string w = rng.chance(opt.misspell) ? words.misspelled(rng) : words.pick(rng);
+			if (sentenceStart && isalpha((unsigned char)w[0]))
+				w[0] = (char)toupper(w[0]);
+			sentenceStart = false;
+			line += w;
+			if (rng.chance(0.08)) {
+				line += '.';
+				sentenceStart = true;
+			}
+			else if (rng.chance(0.06))
+				line += ',';
+			if ((int)line.size() < length)
+				line += ' ';
+		}
+		return line;
+	}
+
+	bool writeDocument(const Options& opt, const Words& words, Rng& rng) {
+		ofstream out(opt.docFile, ios::binary);
+		if (!out)
+			return false;
+		bool sentenceStart = true;
+		long long written = 0;
+		for (long long i = 0; opt.bytes > 0 ? written < opt.bytes : i < opt.lines; i++) {
+			string line = makeLine(opt, words, rng, lineLength(opt, rng), sentenceStart);
+			out << line << '\n';
+			written += line.size() + 1;
+		}
+		return (bool)out;
+	}
+
+	class KeyWriter {
+	public:
+		KeyWriter(ostream& out, long long limit) : out_(out), time_(0), count_(0), limit_(limit) { }
+
+		void key(int key, int delayMs) {
+			if (count_ >= limit_)
+				return; // the last burst is cut short at exactly --num-keys keys
+			time_ += delayMs * 1000LL;
+			out_ << formatScriptKey({ time_, key, "" }) << '\n';
+			count_++;
+		}
+
+		long long count() const { return count_; }
+
+	private:
+		ostream& out_;
+		long long time_;
+		long long count_;
+		long long limit_;
+	};
+
+	// A mix of typing bursts, navigation, backspace runs, new lines and undo storms, with
+	// human-like gaps between the keys.
+	bool writeKeys(const Options& opt, const Words& words, Rng& rng) {
+		ofstream out(opt.keysFile, ios::binary);
+		if (!out)
+			return false;
+		out << "# wurdgen --seed " << opt.seed << " --num-keys " << opt.numKeys << '\n';
+		KeyWriter k(out, opt.numKeys);
+		const int kArrows[] = { KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT };
+		while (k.count() < opt.numKeys) {
+			double what = rng.uniform() * (1.0 + opt.undoStorms);
+			if (what < 0.55) { // typing burst of a few words
+				int n = rng.between(1, 6);
+				for (int i = 0; i < n; i++) {
+					string w = rng.chance(opt.misspell) ? words.misspelled(rng) : words.pick(rng);
+					for (char ch : w)
+						k.key((unsigned char)ch, rng.between(60, 220));
+					k.key(' ', rng.between(80, 250));
+				}
+			}
+			else if (what < 0.80) { // navigation
+				int kind = rng.below(10);
+				if (kind < 7) {
+					int key = kArrows[rng.below(4)];
+					for (int i = rng.between(1, 25); i > 0; i--)
+						k.key(key, rng.between(25, 60)); // auto-repeat
+				}
+				else if (kind < 9)
+					k.key(rng.chance(0.5) ? KEY_HOME : KEY_END, rng.between(150, 600));
+				else
+					k.key(rng.chance(0.5) ? KEY_PPAGE : KEY_NPAGE, rng.between(200, 900));
+			}
+			else if (what < 0.92) { // backspace run
+				for (int i = rng.between(1, 15); i > 0; i--)
+					k.key(KEY_BACKSPACE, rng.between(40, 120));
+			}
+			else if (what < 1.0) // new line
+				k.key(KEY_ENTER, rng.between(150, 500));
+			else { // undo storm
+				for (int i = rng.between(5, 40); i > 0; i--)
+					k.key(CTRL_Z, rng.between(40, 150));
+			}
+		}
+		return (bool)out;
+	}
+
+	void usage() {
+		cerr << "usage: wurdgen [--seed n] [--dict path] [--doc file] [--keys file] [options]" << endl
+			<< "see the comment at the top of tools/wurdgen.cpp for the options" << endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options opt;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (i + 1 >= argc || arg.compare(0, 2, "--") != 0) {
+			usage();
+			return 2;
+		}
+		string v = argv[++i];
+		if (arg == "--seed") opt.seed = strtoull(v.c_str(), nullptr, 10);
+		else if (arg == "--dict") opt.dictionary = v;
+		else if (arg == "--doc") opt.docFile = v;
+		else if (arg == "--keys") opt.keysFile = v;
+		else if (arg == "--lines") opt.lines = atoll(v.c_str());
+		else if (arg == "--bytes") opt.bytes = atoll(v.c_str());
+		else if (arg == "--line-dist") opt.lineDist = v;
+		else if (arg == "--line-mean") opt.lineMean = atof(v.c_str());
+		else if (arg == "--line-sd") opt.lineSd = atof(v.c_str());
+		else if (arg == "--blank") opt.blank = atof(v.c_str());
+		else if (arg == "--misspell") opt.misspell = atof(v.c_str());
+		else if (arg == "--long-lines") opt.longLines = atof(v.c_str());
+		else if (arg == "--long-length") opt.longLength = atoi(v.c_str());
+		else if (arg == "--num-keys") opt.numKeys = atoll(v.c_str());
+		else if (arg == "--undo-storms") opt.undoStorms = atof(v.c_str());
+		else {
+			usage();
+			return 2;
+		}
+	}
+	if (opt.docFile.empty() && opt.keysFile.empty()) {
+		usage();
+		return 2;
+	}
+	if (opt.lineDist != "normal" && opt.lineDist != "uniform" && opt.lineDist != "exponential") {
+		cerr << "Unknown line length distribution " << opt.lineDist << endl;
+		return 2;
+	}
+
+	Words words;
+	if (!words.load(opt.dictionary)) {
+		cerr << "Unable to read " << opt.dictionary << endl;
+		return 1;
+	}
+	// Separate streams so that changing the key options does not change the document.
+	Rng docRng(opt.seed);
+	Rng keyRng(opt.seed ^ 0x6B6579735EEDULL);
+	if (!opt.docFile.empty() && !writeDocument(opt, words, docRng)) {
+		cerr << "Unable to write " << opt.docFile << endl;
+		return 1;
+	}
+	if (!opt.keysFile.empty() && !writeKeys(opt, words, keyRng)) {
+		cerr << "Unable to write " << opt.keysFile << endl;
+		return 1;
+	}
+	return 0;
+}